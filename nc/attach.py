@@ -5,25 +5,188 @@
 #
 
 import recreator
-import ocl
-import ocl_funcs
 import nc
+import math
+import os
+import sys
+import ctypes
+import ctypes.util
+
+try:
+    import ocl
+    import ocl_funcs
+except ImportError:
+    # not needed if the attach library is found
+    ocl = None
 
 attached = False
 units = 1.0
 
+# the path is dropped at points no more than max_step apart, then each span is halved where the height at its middle
+# is more than tolerance from the straight line between its ends, down to spans of min_step
+sampling_max_step = 1.0
+sampling_min_step = 0.01
+sampling_tolerance = 0.005
+
+# the attach library, HeeksCNC's DropCutter on its own, see src/SurfaceAttach.h
+# when it is found, the moves are queued, with the calls around them, and dropped onto the surface in batches of about this many points
+# when it isn't, each path and plunge is dropped with OpenCamLib as it comes
+batch_size = 100000
+
+def load_native():
+    names = ['heekscnc_attach.dll', 'libheekscnc_attach.so', 'libheekscnc_attach.dylib']
+    here = os.path.dirname(os.path.abspath(__file__))
+    paths = []
+    if 'HEEKSCNC_ATTACH_LIBRARY' in os.environ: paths.append(os.environ['HEEKSCNC_ATTACH_LIBRARY'])
+    for folder in [here, os.path.join(here, '..', 'bin'), os.path.join(here, '..')]:
+        for name in names:
+            path = os.path.join(folder, name)
+            if os.path.exists(path): paths.append(path)
+    found = ctypes.util.find_library('heekscnc_attach')
+    if found != None: paths.append(found)
+
+    for path in paths:
+        try:
+            lib = ctypes.CDLL(path)
+        except OSError:
+            continue
+        c_double_p = ctypes.POINTER(ctypes.c_double)
+        lib.attach_set_tolerance.argtypes = [ctypes.c_double]
+        lib.attach_set_tolerance.restype = None
+        lib.attach_open_surface.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_int, ctypes.c_double, ctypes.c_int, ctypes.c_int]
+        lib.attach_open_surface.restype = ctypes.c_void_p
+        lib.attach_close_surface.argtypes = [ctypes.c_void_p]
+        lib.attach_close_surface.restype = None
+        lib.attach_begin.argtypes = [ctypes.c_void_p] + [ctypes.c_double] * 4 + [ctypes.c_int] + [ctypes.c_double] * 5
+        lib.attach_begin.restype = ctypes.c_void_p
+        lib.attach_end.argtypes = [ctypes.c_void_p]
+        lib.attach_end.restype = None
+        lib.attach_add_path.argtypes = [ctypes.c_void_p, c_double_p, ctypes.c_int, ctypes.c_double]
+        lib.attach_add_path.restype = ctypes.c_int
+        lib.attach_num_points.argtypes = [ctypes.c_void_p]
+        lib.attach_num_points.restype = ctypes.c_int
+        lib.attach_run.argtypes = [ctypes.c_void_p]
+        lib.attach_run.restype = ctypes.c_int
+        lib.attach_result_size.argtypes = [ctypes.c_void_p, ctypes.c_int]
+        lib.attach_result_size.restype = ctypes.c_int
+        lib.attach_result.argtypes = [ctypes.c_void_p, ctypes.c_int, c_double_p]
+        lib.attach_result.restype = None
+        lib.attach_report.argtypes = []
+        lib.attach_report.restype = ctypes.c_char_p
+        return lib
+    return None
+
+native = load_native()
+
+def c_string(s):
+    if isinstance(s, bytes): return s
+    return s.encode('utf-8')
+
+################################################################################
+class Surface:
+    # a surface to attach to, from the file written by CSurfaceMesh::WriteToFile, and the surface's saved GTriMesh, if it has one
+    # it is opened by the attach library if there is one, or else given to OpenCamLib
+    # levels lets the library drop roughing cutters onto coarser triangles, see MeshPyramid.h
+    # cache_heights keeps a height map for each cutter, which later ops on the surface look up, see ZMap.h
+    def __init__(self, path, tree = '', compact = False, tile_memory_budget = 0.0, tolerance = 0.001, levels = False, cache_heights = False):
+        self.handle = None
+        self.stl = None
+        if native != None:
+            native.attach_set_tolerance(tolerance)
+            self.handle = native.attach_open_surface(c_string(path), c_string(tree), int(compact), tile_memory_budget, int(levels), int(cache_heights))
+        if self.handle == None:
+            self.stl = ocl_funcs.STLSurfFromMesh(path)
+
+    def __del__(self):
+        if self.handle != None and native != None:
+            native.attach_close_surface(self.handle)
+
+################################################################################
+class Cutter:
+    # a cutter, with the same sizes as DropCutter's Cutter, made by CTool::AttachDefinition
+    # a cone cutter has flat_radius and half_angle, in radians from the axis, instead of r
+    def __init__(self, R, r = 0.0, flat_radius = None, half_angle = None):
+        self.R = R
+        self.r = r
+        self.flat_radius = flat_radius
+        self.half_angle = half_angle
+        self.cone = (half_angle != None)
+
+    def ocl_cutter(self):
+        # the same cutter for OpenCamLib, whose cutters are made from diameters
+        if self.cone:
+            return ocl.CylConeCutter(float(self.flat_radius * 2), float(self.R * 2), float(self.half_angle))
+        if self.r >= self.R:
+            return ocl.BallCutter(float(self.R * 2), 1000)
+        if self.r > 0.000000001:
+            return ocl.BullCutter(float(self.R * 2), float(self.r), 1000)
+        return ocl.CylCutter(float(self.R * 2), 1000)
+
+################################################################################
+class Height:
+    # the height of a plunge, which isn't known until its batch has been dropped
+    def __init__(self, creator, path, scale = 1.0):
+        self.creator = creator
+        self.path = path
+        self.scale = scale
+
+    def __truediv__(self, d):
+        return Height(self.creator, self.path, self.scale / d)
+
+    __div__ = __truediv__
+
+    def value(self):
+        return self.creator.results[self.path][0][2] * self.scale
+
+def resolve(a):
+    if isinstance(a, Height): return a.value()
+    return a
+
+################################################################################
+class Deferred:
+    # stands in for the creator being attached, so that, while moves are being batched, the calls to it wait in order with the moves
+    # calls which return something can't wait, so the batch is dropped first
+
+    queries = ['get_fixture', 'use_CRC', 'pattern_uses_subroutine']
+
+    def __init__(self, creator):
+        self.creator = creator
+
+    def __getattr__(self, name):
+        attr = getattr(self.creator.output, name)
+        if not callable(attr):
+            return attr
+        if name in Deferred.queries:
+            self.creator.drop_batch()
+            return attr
+        creator = self.creator
+        def call(*args, **kwargs):
+            creator.queue_call(attr, args, kwargs)
+        return call
+
 ################################################################################
 class Creator(recreator.Redirector):
 
     def __init__(self, original):
         recreator.Redirector.__init__(self, original)
 
+        # the calls to the creator being attached go through a Deferred
+        self.output = original
+        self.original = Deferred(self)
+
+        self.surface = None
+        self.attach_cutter = None
+        self.native_attach = None # from attach_begin in the attach library, made when the first path is added
+        self.queue = [] # the calls and paths waiting for their batch to be dropped, in order
+        self.batch_paths = 0
+        self.results = [] # the points of the paths of the batch being output
         self.stl = None
         self.cutter = None
         self.minz = None
         self.path = None
         self.pdcf = None
         self.material_allowance = 0.0
+        self.num_drops = 0
 
     ############################################################################
     ##  Shift in Z
@@ -37,6 +200,9 @@ class Creator(recreator.Redirector):
             self.pdcf.setZ(self.minz/units)
                     
     def z2(self, z):
+        if self.batching():
+            # dropped with the rest of the batch
+            return Height(self, self.add_path([(self.x, self.y)], self.floor()))
         path = ocl.Path()
         # use a line with no length
         path.append(ocl.Line(ocl.Point(self.x, self.y, self.z), ocl.Point(self.x, self.y, self.z)))
@@ -51,36 +217,163 @@ class Creator(recreator.Redirector):
         p = plist[0]
         return p.z + self.material_allowance/units
         
-    def cut_path(self):
-        if self.path == None: return
-        self.setPdcfIfNotSet()
-        
-        if (self.z>self.minz):
-            self.pdcf.setZ(self.z)  # Adjust Z if we have gotten a higher limit (Fix pocketing loosing steps when using attach?)
+    def drop_points(self, xy, minz):
+        # drops the cutter at a list of (x, y), all in one batch, and returns the heights
+        bdc = ocl.BatchDropCutter()
+        bdc.setSTL(self.stl)
+        bdc.setCutter(self.cutter)
+        for x, y in xy:
+            bdc.appendPoint(ocl.CLPoint(x, y, minz))
+        bdc.run()
+        self.num_drops = self.num_drops + len(xy)
+        return [p.z for p in bdc.getCLPoints()]
+
+    def drop_path(self, xy, minz):
+        # drops the cutter along a list of (x, y), sampling flat areas coarsely and halving spans only where the height isn't straight
+        # returns a list of (x, y, z), already simplified, like DropCutter::DropPath
+        samples = [xy[0]]
+        for i in range(1, len(xy)):
+            x0, y0 = xy[i - 1]
+            x1, y1 = xy[i]
+            length = math.sqrt((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0))
+            if length <= 0.0: continue
+            steps = int(math.ceil(length / sampling_max_step))
+            for j in range(1, steps + 1):
+                samples.append((x0 + (x1 - x0) * j / steps, y0 + (y1 - y0) * j / steps))
+
+        # the points are a linked list, so middles can be put in without moving the others
+        z = self.drop_points(samples, minz)
+        points = [[samples[i][0], samples[i][1], z[i], i + 1] for i in range(0, len(samples))]
+        points[-1][3] = -1
+        spans = range(0, len(points) - 1)
+
+        # halve a round of spans at a time, so each round is one batch of drops
+        min_length = sampling_min_step * 2
+        while len(spans) > 0:
+            spans = [s for s in spans if math.hypot(points[points[s][3]][0] - points[s][0], points[points[s][3]][1] - points[s][1]) >= min_length]
+            if len(spans) == 0: break
+            mids = [((points[s][0] + points[points[s][3]][0]) * 0.5, (points[s][1] + points[points[s][3]][1]) * 0.5) for s in spans]
+            mid_z = self.drop_points(mids, minz)
+            next_spans = []
+            for i in range(0, len(spans)):
+                first = spans[i]
+                next = points[first][3]
+                line_z = (points[first][2] + points[next][2]) * 0.5
+                # the middle is kept even if the span is straight enough, so that leaving points out below can't go far from it
+                points.append([mids[i][0], mids[i][1], mid_z[i], next])
+                points[first][3] = len(points) - 1
+                if math.fabs(mid_z[i] - line_z) > sampling_tolerance:
+                    next_spans.append(first)
+                    next_spans.append(len(points) - 1)
+            spans = next_spans
+
+        # leave out points which are within tolerance of the line from the last point kept to the next point
+        result = [points[0][0:3]]
+        last_kept = 0
+        left_out = []
+        i = points[0][3]
+        while i != -1 and points[i][3] != -1:
+            next = points[i][3]
+            left_out.append(i)
+            for j in left_out:
+                if distance_to_line(points[last_kept], points[next], points[j]) > sampling_tolerance:
+                    result.append(points[i][0:3])
+                    last_kept = i
+                    left_out = []
+                    break
+            i = next
+        if i != -1 and i != 0: result.append(points[i][0:3])
+        return result
+
+    ############################################################################
+    ##  Batches, for the attach library
+
+    def batching(self):
+        return native != None and self.surface != None and self.surface.handle != None and self.attach_cutter != None
+
+    def add_path(self, xy, floor):
+        # adds a list of (x, y) to the batch, and returns its index in the results
+        if self.native_attach == None:
+            cu = self.attach_cutter
+            self.native_attach = native.attach_begin(self.surface.handle, cu.R, cu.r, cu.flat_radius or 0.0, cu.half_angle or 0.0, int(cu.cone), self.minz/units, self.material_allowance, sampling_max_step, sampling_min_step, sampling_tolerance)
+            if self.native_attach == None:
+                raise Exception("couldn't attach to the surface with this cutter")
+        n = len(xy)
+        a = (ctypes.c_double * (n * 2))()
+        for i in range(0, n):
+            a[i * 2] = xy[i][0]
+            a[i * 2 + 1] = xy[i][1]
+        self.batch_paths = self.batch_paths + 1
+        return native.attach_add_path(self.native_attach, a, n, floor)
+
+    def queue_call(self, f, args, kwargs):
+        if len(self.queue) == 0 and not self.batching():
+            f(*args, **kwargs)
         else:
-            self.pdcf.setZ(self.minz/units) # Else use minz
-            
-       # get the points on the surface
-        self.pdcf.setPath(self.path)
-        
-        self.pdcf.run()
-        plist = self.pdcf.getCLPoints()
-        
-        #refine the points
-        f = ocl.LineCLFilter()
-        f.setTolerance(0.005)
-        for p in plist:
-            f.addCLPoint(p)
-        f.run()
-        plist = f.getCLPoints()
-        
+            self.queue.append((f, args, kwargs))
+
+    def drop_batch(self):
+        # drops the batch onto the surface, then makes the calls which were waiting for it, with the heights filled in
+        if self.native_attach != None:
+            self.num_drops = self.num_drops + native.attach_run(self.native_attach)
+            report = native.attach_report()
+            if report: sys.stderr.write(report.decode('utf-8') if isinstance(report, bytes) else report)
+            self.results = []
+            for path in range(0, self.batch_paths):
+                n = native.attach_result_size(self.native_attach, path)
+                a = (ctypes.c_double * (n * 3))()
+                native.attach_result(self.native_attach, path, a)
+                self.results.append([(a[i * 3], a[i * 3 + 1], a[i * 3 + 2]) for i in range(0, n)])
+        self.batch_paths = 0
+        queue = self.queue
+        self.queue = []
+        for f, args, kwargs in queue:
+            if f == None:
+                # a path, whose first point is where the cutter already is
+                for p in self.results[args][1:]:
+                    self.output.feed(p[0]/units, p[1]/units, p[2]/units)
+            else:
+                f(*[resolve(a) for a in args], **dict([(k, resolve(v)) for k, v in kwargs.items()]))
+        self.results = []
+
+    def end_batches(self):
+        self.drop_batch()
+        if self.native_attach != None:
+            native.attach_end(self.native_attach)
+            self.native_attach = None
+
+    def floor(self):
+        if (self.z>self.minz):
+            return self.z  # Adjust Z if we have gotten a higher limit (Fix pocketing loosing steps when using attach?)
+        return self.minz/units # Else use minz
+
+    ############################################################################
+    ##  Paths
+
+    def cut_path(self):
+        if self.path == None or len(self.path) < 2:
+            self.path = None
+            return
+
+        minz = self.floor()
+
+        if self.batching():
+            # the points on the surface are fed when the batch has been dropped
+            self.queue.append((None, self.add_path(self.path, minz), None))
+            self.path = None
+            if native.attach_num_points(self.native_attach) >= batch_size: self.drop_batch()
+            return
+
+        # get the points on the surface
+        plist = self.drop_path(self.path, minz)
+
         i = 0
         for p in plist:
             if i > 0:
-                self.original.feed(p.x/units, p.y/units, p.z/units + self.material_allowance/units)
+                self.original.feed(p[0]/units, p[1]/units, p[2]/units + self.material_allowance/units)
             i = i + 1
-            
-        self.path = ocl.Path()
+
+        self.path = None
         
     def rapid(self, x=None, y=None, z=None, a=None, b=None, c=None ):
         if z != None:
@@ -99,8 +392,8 @@ class Creator(recreator.Redirector):
             return
             
         # add a line to the path
-        if self.path == None: self.path = ocl.Path()
-        self.path.append(ocl.Line(ocl.Point(px, py, pz), ocl.Point(self.x, self.y, self.z)))
+        if self.path == None: self.path = [(px, py)]
+        self.path.append((self.x, self.y))
         
     def arc(self, x=None, y=None, z=None, i=None, j=None, k=None, r=None, ccw = True):
         px = self.x
@@ -108,15 +401,58 @@ class Creator(recreator.Redirector):
         pz = self.z
         recreator.Redirector.arc(self, x, y, z, i, j, k, r, ccw)
         
-        # add an arc to the path
-        if self.path == None: self.path = ocl.Path()
-        self.path.append(ocl.Arc(ocl.Point(px, py, pz), ocl.Point(self.x, self.y, self.z), ocl.Point(i, j, pz), ccw))
+        # add an arc to the path, as lines within tolerance of it
+        if self.path == None: self.path = [(px, py)]
+        radius = math.hypot(px - i, py - j)
+        start_angle = math.atan2(py - j, px - i)
+        end_angle = math.atan2(self.y - j, self.x - i)
+        if ccw:
+            if end_angle <= start_angle: end_angle = end_angle + 2 * math.pi
+        else:
+            if end_angle >= start_angle: end_angle = end_angle - 2 * math.pi
+        if radius > sampling_tolerance:
+            step_angle = 2 * math.acos(1 - sampling_tolerance / radius)
+        else:
+            step_angle = math.pi / 2
+        steps = int(math.ceil(math.fabs(end_angle - start_angle) / step_angle))
+        for s in range(1, steps):
+            a = start_angle + (end_angle - start_angle) * s / steps
+            self.path.append((i + radius * math.cos(a), j + radius * math.sin(a)))
+        self.path.append((self.x, self.y))
         
+    def set_surface(self, surface):
+        self.end_batches()
+        self.surface = surface
+        self.stl = surface.stl
+        self.pdcf = None
+
+    def set_cutter(self, cutter):
+        # the heights waiting to be dropped are for the old cutter
+        self.end_batches()
+        self.attach_cutter = cutter
+        self.pdcf = None
+        if not self.batching(): self.cutter = cutter.ocl_cutter()
+
     def set_ocl_cutter(self, cutter):
+        self.end_batches()
+        self.attach_cutter = None
         self.cutter = cutter
+        self.pdcf = None
 
 ################################################################################
 
+def distance_to_line(p0, p1, p):
+    # the distance from p to the line from p0 to p1, in 3D
+    v = [p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]]
+    w = [p[0] - p0[0], p[1] - p0[1], p[2] - p0[2]]
+    vv = v[0] * v[0] + v[1] * v[1] + v[2] * v[2]
+    t = 0.0
+    if vv > 0.0: t = (v[0] * w[0] + v[1] * w[1] + v[2] * w[2]) / vv
+    if t < 0.0: t = 0.0
+    if t > 1.0: t = 1.0
+    d = [w[0] - v[0] * t, w[1] - v[1] * t, w[2] - v[2] * t]
+    return math.sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2])
+
 def attach_begin():
     global attached
     if attached == True:
@@ -130,5 +466,6 @@ def attach_begin():
 def attach_end():
     global attached
     nc.creator.cut_path()
-    nc.creator = nc.creator.original
+    nc.creator.end_batches()
+    nc.creator = nc.creator.output
     attached = False
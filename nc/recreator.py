@@ -298,3 +298,6 @@ class Redirector(nc.Creator):
         
     def set_ocl_cutter(self, cutter):
         self.original.set_ocl_cutter(cutter)
+
+    def set_cutter(self, cutter):
+        self.original.set_cutter(cutter)
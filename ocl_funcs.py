@@ -8,6 +8,27 @@ def STLSurfFromFile(filepath):
     ocl.STLReader(filepath, s)
     return s
 
+def STLSurfFromMesh(filepath):
+    # reads the triangles which HeeksCNC wrote with CSurfaceMesh::WriteToFile
+    # a header, then nine doubles for each triangle
+    import mmap
+    import struct
+    s = ocl.STLSurf()
+    f = open(filepath, 'rb')
+    m = mmap.mmap(f.fileno(), 0, access = mmap.ACCESS_READ)
+    magic, version, header_size, num_triangles = struct.unpack_from('<8sIIQ', m, 0)
+    if magic != b'HCNCMESH' or version != 1:
+        m.close()
+        f.close()
+        raise ValueError('not a HeeksCNC surface mesh file: ' + filepath)
+    tri = struct.Struct('<9d')
+    for i in range(0, num_triangles):
+        p = tri.unpack_from(m, header_size + i * tri.size)
+        s.addTriangle(ocl.Triangle(ocl.Point(p[0], p[1], p[2]), ocl.Point(p[3], p[4], p[5]), ocl.Point(p[6], p[7], p[8])))
+    m.close()
+    f.close()
+    return s
+
 def cut_path(path, dcf, z1, mat_allowance, mm, units, rapid_to, incremental_rapid_to):
     dcf.setPath(path)
     dcf.setSampling(0.1) # FIXME: this should be adjustable by the (advanced) user
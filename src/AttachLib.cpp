@@ -0,0 +1,86 @@
+// AttachLib.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+// the functions of the attach library, which nc/attach.py loads with ctypes
+// the library is built with DROPCUTTER_ONLY, from the DropCutter kernel and SurfaceAttach, without wx or HeeksCAD
+
+#include "stdafx.h"
+#include "SurfaceAttach.h"
+#include "ThreadPool.h"
+
+#ifdef WIN32
+#define ATTACH_API extern "C" __declspec(dllexport)
+#else
+#define ATTACH_API extern "C"
+#endif
+
+// the tolerance of the tests, which HeeksCNC gets from HeeksCAD
+ATTACH_API void attach_set_tolerance(double tol)
+{
+	DropCutter::SetTolerance(tol);
+}
+
+// see AttachSurface::Open; tile_memory_budget is in MB, 0 for no tiles
+ATTACH_API void* attach_open_surface(const char* mesh_path, const char* tree_path, int compact, double tile_memory_budget, int levels, int cache_heights)
+{
+	return AttachSurface::Open(mesh_path, tree_path ? tree_path : "", compact != 0, (size_t)(tile_memory_budget * 1048576), levels != 0, cache_heights != 0);
+}
+
+ATTACH_API void attach_close_surface(void* surface)
+{
+	delete (AttachSurface*)surface;
+}
+
+// starts attaching to a surface with a cutter, made as by the Cutter constructors; cone is non-zero for a cone cutter, which uses flat_radius and half_angle, not r
+// returns NULL if the surface can't be dropped onto with the cutter
+ATTACH_API void* attach_begin(void* surface, double R, double r, double flat_radius, double half_angle, int cone, double minz, double material_allowance, double max_step, double min_step, double tolerance)
+{
+	PointDropper* dropper = ((AttachSurface*)surface)->Dropper(cone ? Cutter(R, flat_radius, half_angle) : Cutter(R, r), minz, material_allowance, tolerance);
+	if(dropper == NULL)return NULL;
+	return new SurfaceAttach(dropper, material_allowance, max_step, min_step, tolerance);
+}
+
+ATTACH_API void attach_end(void* attach)
+{
+	delete (SurfaceAttach*)attach;
+
+	// join the worker threads now, while it is safe to, rather than when the library is unloaded
+	ThreadPool::Shutdown();
+}
+
+ATTACH_API int attach_add_path(void* attach, const double* xy, int n, double floor)
+{
+	return ((SurfaceAttach*)attach)->AddPath(xy, n, floor);
+}
+
+ATTACH_API int attach_num_points(void* attach)
+{
+	return ((SurfaceAttach*)attach)->NumPoints();
+}
+
+ATTACH_API int attach_run(void* attach)
+{
+	return ((SurfaceAttach*)attach)->Run();
+}
+
+ATTACH_API int attach_result_size(void* attach, int path)
+{
+	return ((SurfaceAttach*)attach)->ResultSize(path);
+}
+
+// xyz needs room for attach_result_size(attach, path) * 3 doubles
+ATTACH_API void attach_result(void* attach, int path, double* xyz)
+{
+	SurfaceAttach* a = (SurfaceAttach*)attach;
+	int n = a->ResultSize(path);
+	if(n > 0)memcpy(xyz, a->Result(path), n * 3 * sizeof(double));
+}
+
+// the errors found by the tests since the last call, as DropCutterDiagnostics::Report, or an empty string
+ATTACH_API const char* attach_report()
+{
+	static std::string report;
+	report = DropCutterDiagnostics::Report();
+	DropCutterDiagnostics::Reset();
+	return report.c_str();
+}
@@ -23,6 +23,7 @@
 #include "PythonStuff.h"
 #include "Program.h"
 #include "Surface.h"
+#include "DropCutter.h"
 
 #include <sstream>
 #include <string>
@@ -1093,36 +1094,68 @@ TopoDS_Shape CTool::GetShape() const
    } // End catch
 } // End GetShape() method
 
-Python CTool::OCLDefinition(CSurface* surface) const
+Python CTool::AttachDefinition(CSurface* surface) const
 {
+	// nc/attach.py makes its OpenCamLib cutter from this, if it hasn't got the attach library
 	Python python;
 
+	double radius = m_params.m_diameter/2 + surface->m_material_allowance;
+
 	switch (m_params.m_type)
 	{
 		case CToolParams::eBallEndMill:
-			python << _T("ocl.BallCutter(float(") << m_params.m_diameter + surface->m_material_allowance * 2 << _T("), 1000)\n");
+			python << _T("attach.Cutter(") << radius << _T(", ") << radius << _T(")");
 			break;
 
 		case CToolParams::eChamfer:
 		case CToolParams::eEngravingTool:
-			python << _T("ocl.CylConeCutter(float(") << m_params.m_flat_radius * 2 + surface->m_material_allowance << _T("), float(") << m_params.m_diameter + surface->m_material_allowance * 2 << _T("), float(") << m_params.m_cutting_edge_angle * M_PI/360 << _T("))\n");
+			python << _T("attach.Cutter(") << radius << _T(", flat_radius = ") << m_params.m_flat_radius + surface->m_material_allowance << _T(", half_angle = ") << m_params.m_cutting_edge_angle * M_PI/360 << _T(")");
 			break;
 
 		default:
 			if(this->m_params.m_corner_radius > 0.000000001)
 			{
-				python << _T("ocl.BullCutter(float(") << m_params.m_diameter + surface->m_material_allowance * 2 << _T("), float(") << m_params.m_corner_radius << _T("), 1000)\n");
+				python << _T("attach.Cutter(") << radius << _T(", ") << m_params.m_corner_radius + surface->m_material_allowance << _T(")");
 			}
 			else
 			{
-				python << _T("ocl.CylCutter(float(") << m_params.m_diameter + surface->m_material_allowance * 2 << _T("), 1000)\n");
+				python << _T("attach.Cutter(") << radius << _T(", 0.0)");
 			}
 			break;
 	} // End switch
 
 	return python;
+}
+
+Cutter CTool::DropCutterDefinition(CSurface* surface) const
+{
+	return DropCutterDefinition(surface->m_material_allowance);
+}
+
+Cutter CTool::DropCutterDefinition(double material_allowance) const
+{
+	double radius = m_params.m_diameter/2 + material_allowance;
+
+	switch (m_params.m_type)
+	{
+		case CToolParams::eBallEndMill:
+			return Cutter(radius, radius);
 
-} 
+		case CToolParams::eChamfer:
+		case CToolParams::eEngravingTool:
+			return Cutter(radius, m_params.m_flat_radius + material_allowance, m_params.m_cutting_edge_angle * M_PI/360);
+
+		default:
+			if(this->m_params.m_corner_radius > 0.000000001)
+			{
+				return Cutter(radius, m_params.m_corner_radius + material_allowance);
+			}
+			else
+			{
+				return Cutter(radius, 0.0);
+			}
+	} // End switch
+}
 
 Python CTool::VoxelcutDefinition()const
 {
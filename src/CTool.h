@@ -16,6 +16,7 @@
 
 class CTool;
 class CSurface;
+class Cutter;
 
 class CToolParams{
 
@@ -104,7 +105,9 @@ public:
 
 	// program whose job is to generate RS-274 GCode.
 	Python AppendTextToProgram();
-	Python OCLDefinition(CSurface* surface)const;
+	Python AttachDefinition(CSurface* surface)const; // an attach.Cutter, for nc/attach.py, with the same sizes as DropCutterDefinition
+	Cutter DropCutterDefinition(CSurface* surface)const;
+	Cutter DropCutterDefinition(double material_allowance)const; // made bigger all round by material_allowance
 
 	void GetProperties(std::list<Property *> *list);
 	void CopyFrom(const HeeksObj* object);
@@ -0,0 +1,222 @@
+// CompactMesh.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "stdafx.h"
+#include "CompactMesh.h"
+
+static void get_box(const double *t, double *box)
+{
+	box[0] = box[2] = t[0];
+	box[1] = box[3] = t[1];
+	for(int v = 1; v<3; v++)
+	{
+		if(t[v * 3] < box[0])box[0] = t[v * 3];
+		if(t[v * 3 + 1] < box[1])box[1] = t[v * 3 + 1];
+		if(t[v * 3] > box[2])box[2] = t[v * 3];
+		if(t[v * 3 + 1] > box[3])box[3] = t[v * 3 + 1];
+	}
+}
+
+class CompactTriCentreLess
+{
+	const double *m_p;
+	int m_axis;
+public:
+	CompactTriCentreLess(const double *p, int axis):m_p(p), m_axis(axis){}
+	double Centre(int t)const
+	{
+		double box[4];
+		get_box(&m_p[t * 9], box);
+		return box[m_axis] + box[m_axis + 2];
+	}
+	bool operator()(int t1, int t2)const
+	{
+		return Centre(t1) < Centre(t2);
+	}
+};
+
+CompactMesh::CompactMesh(const double *p, size_t num_triangles):m_max_error(0.0)
+{
+	if(num_triangles == 0)return;
+
+	std::vector<int> tris((size_t)num_triangles);
+	for(size_t i = 0; i<num_triangles; i++)tris[i] = (int)i;
+
+	m_nodes.reserve(2 * (num_triangles / max_triangles_in_leaf) + 1);
+	m_indices.reserve(num_triangles * 3);
+	m_nodes.push_back(Node());
+	Split(p, tris, 0, 0, (int)num_triangles);
+
+	// the number of vertices wasn't known in advance, so give back what the vector grew by
+	std::vector<float>(m_vertices).swap(m_vertices);
+
+	SetBounds();
+}
+
+void CompactMesh::Split(const double *p, std::vector<int> &tris, int node_index, int first, int count)
+{
+	if(count <= max_triangles_in_leaf)
+	{
+		m_nodes[node_index].m_first = NumTriangles();
+		m_nodes[node_index].m_count = count;
+		AddLeaf(p, &tris[first], count, node_index);
+		return;
+	}
+
+	// split at the median centre, along the longer side of the box of the centres, as GTriMesh does
+	CompactTriCentreLess x_less(p, 0), y_less(p, 1);
+	double centre_box[4] = {x_less.Centre(tris[first]), y_less.Centre(tris[first]), x_less.Centre(tris[first]), y_less.Centre(tris[first])};
+	for(int i = first + 1; i < first + count; i++)
+	{
+		double cx = x_less.Centre(tris[i]);
+		double cy = y_less.Centre(tris[i]);
+		if(cx < centre_box[0])centre_box[0] = cx;
+		if(cy < centre_box[1])centre_box[1] = cy;
+		if(cx > centre_box[2])centre_box[2] = cx;
+		if(cy > centre_box[3])centre_box[3] = cy;
+	}
+	int axis = (centre_box[2] - centre_box[0] >= centre_box[3] - centre_box[1]) ? 0 : 1;
+	int half = count / 2;
+	std::nth_element(tris.begin() + first, tris.begin() + first + half, tris.begin() + first + count, CompactTriCentreLess(p, axis));
+
+	int child = (int)m_nodes.size();
+	m_nodes.push_back(Node());
+	m_nodes.push_back(Node());
+	m_nodes[node_index].m_first = child;
+	m_nodes[node_index].m_count = 0;
+	m_nodes[node_index].m_first_vertex = 0;
+	m_nodes[node_index].m_vertex_count = 0;
+
+	Split(p, tris, child, first, half);
+	Split(p, tris, child + 1, first + half, count - half);
+}
+
+void CompactMesh::AddLeaf(const double *p, const int *tris, int count, int node_index)
+{
+	// the origin is at the lowest x and y, and the highest z, of the tile
+	double origin[3] = {p[tris[0] * 9], p[tris[0] * 9 + 1], p[tris[0] * 9 + 2]};
+	for(int i = 0; i<count; i++)
+	{
+		const double* t = &p[tris[i] * 9];
+		for(int v = 0; v<3; v++)
+		{
+			if(t[v * 3] < origin[0])origin[0] = t[v * 3];
+			if(t[v * 3 + 1] < origin[1])origin[1] = t[v * 3 + 1];
+			if(t[v * 3 + 2] > origin[2])origin[2] = t[v * 3 + 2];
+		}
+	}
+
+	Node &node = m_nodes[node_index];
+	memcpy(node.m_origin, origin, 3 * sizeof(double));
+	node.m_first_vertex = NumVertices();
+	node.m_vertex_count = 0;
+
+	for(int i = 0; i<count; i++)
+	{
+		const double* t = &p[tris[i] * 9];
+		for(int v = 0; v<3; v++)
+		{
+			float f[3];
+			for(int j = 0; j<3; j++)
+			{
+				f[j] = (float)(t[v * 3 + j] - origin[j]);
+				double error = fabs(origin[j] + (double)f[j] - t[v * 3 + j]);
+				if(error > m_max_error)m_max_error = error;
+			}
+
+			// the same point, used by another triangle of this tile, only gets stored once
+			int index = 0;
+			for(; index < node.m_vertex_count; index++)
+			{
+				const float* tile_vertex = &m_vertices[(node.m_first_vertex + index) * 3];
+				if(tile_vertex[0] == f[0] && tile_vertex[1] == f[1] && tile_vertex[2] == f[2])break;
+			}
+			if(index == node.m_vertex_count)
+			{
+				m_vertices.insert(m_vertices.end(), f, f + 3);
+				node.m_vertex_count++;
+			}
+			m_indices.push_back((unsigned char)index);
+		}
+	}
+}
+
+void CompactMesh::GetVertex(const Node &leaf, int index, double *v)const
+{
+	const float* f = &m_vertices[(leaf.m_first_vertex + index) * 3];
+	for(int j = 0; j<3; j++)v[j] = leaf.m_origin[j] + (double)f[j];
+}
+
+void CompactMesh::SetBounds()
+{
+	// from the points as they are stored, not the points they were made from, so that DropCutter's bounds hold for the stored triangles
+	// children come after their parents, so going backwards does the children first
+	for(int n = (int)m_nodes.size() - 1; n >= 0; n--)
+	{
+		Node &node = m_nodes[n];
+		if(node.m_count == 0)
+		{
+			const Node &c0 = m_nodes[node.m_first];
+			const Node &c1 = m_nodes[node.m_first + 1];
+			node.m_box[0] = (c0.m_box[0] < c1.m_box[0]) ? c0.m_box[0] : c1.m_box[0];
+			node.m_box[1] = (c0.m_box[1] < c1.m_box[1]) ? c0.m_box[1] : c1.m_box[1];
+			node.m_box[2] = (c0.m_box[2] > c1.m_box[2]) ? c0.m_box[2] : c1.m_box[2];
+			node.m_box[3] = (c0.m_box[3] > c1.m_box[3]) ? c0.m_box[3] : c1.m_box[3];
+			node.m_max_z = (c0.m_max_z > c1.m_max_z) ? c0.m_max_z : c1.m_max_z;
+			node.m_max_slope = (c0.m_max_slope > c1.m_max_slope) ? c0.m_max_slope : c1.m_max_slope;
+			continue;
+		}
+
+		bool first = true;
+		node.m_max_slope = 0.0;
+		for(int i = node.m_first; i < node.m_first + node.m_count; i++)
+		{
+			double t[9];
+			for(int v = 0; v<3; v++)GetVertex(node, m_indices[i * 3 + v], &t[v * 3]);
+
+			double box[4];
+			get_box(t, box);
+			if(first)
+			{
+				memcpy(node.m_box, box, 4 * sizeof(double));
+				node.m_max_z = t[2];
+				first = false;
+			}
+			if(box[0] < node.m_box[0])node.m_box[0] = box[0];
+			if(box[1] < node.m_box[1])node.m_box[1] = box[1];
+			if(box[2] > node.m_box[2])node.m_box[2] = box[2];
+			if(box[3] > node.m_box[3])node.m_box[3] = box[3];
+
+			for(int j = 0; j<3; j++)
+			{
+				const double* p0 = &t[j * 3];
+				const double* p1 = &t[((j + 1) % 3) * 3];
+				if(p0[2] > node.m_max_z)node.m_max_z = p0[2];
+				double length = sqrt((p1[0] - p0[0]) * (p1[0] - p0[0]) + (p1[1] - p0[1]) * (p1[1] - p0[1]));
+				if(length < 0.000000001)continue; // the edge tests leave out vertical edges
+				double slope = fabs(p1[2] - p0[2]) / length;
+				if(slope > node.m_max_slope)node.m_max_slope = slope;
+			}
+		}
+	}
+}
+
+int CompactMesh::GetTriangles(const Node &leaf, const double *box, double *p)const
+{
+	int n = 0;
+	for(int i = leaf.m_first; i < leaf.m_first + leaf.m_count; i++)
+	{
+		double* t = &p[n * 9];
+		for(int v = 0; v<3; v++)GetVertex(leaf, m_indices[i * 3 + v], &t[v * 3]);
+
+		double tri_box[4];
+		get_box(t, tri_box);
+		if(boxes_overlap(tri_box, box))n++;
+	}
+	return n;
+}
+
+size_t CompactMesh::MemoryUsed()const
+{
+	return sizeof(CompactMesh) + m_nodes.capacity() * sizeof(Node) + m_vertices.capacity() * sizeof(float) + m_indices.capacity();
+}
@@ -0,0 +1,96 @@
+// CompactMesh.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+// triangles for DropCutter, for surfaces with too many triangles to keep as a GTriMesh
+// the tree is like GTriMesh's, but each leaf is a tile with its own vertices, stored as floats relative to the tile's origin,
+// and each triangle is three indices into the tile's vertices, so a vertex shared by several triangles of a tile is only stored once
+// normals, boxes and edges aren't stored; DropCutter works them out for a tile's triangles when it tests them
+// a float relative to the origin of a tile is nearer than a micron for any sensible size of part,
+// and the largest difference from the triangles it was made from is kept, see MaxError
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+class CompactMesh
+{
+public:
+	class Node{
+	public:
+		double m_box[4]; // minx miny maxx maxy, of all the triangles below this node
+		int m_first; // index of first child node ( second is m_first + 1 ), or first triangle for a leaf
+		int m_count; // number of triangles in a leaf, 0 for a branch
+		int m_first_vertex; // a leaf's vertices are m_first_vertex to m_first_vertex + m_vertex_count - 1
+		int m_vertex_count;
+		double m_max_z; // the highest point of all the triangles below this node
+		double m_max_slope; // the steepest of their edges, dz over xy length, as in GTriMesh::Node
+		double m_origin[3]; // a leaf's vertices are relative to this
+	};
+
+	// the indices are unsigned chars, so a tile can't have more than 256 vertices
+	static const int max_triangles_in_leaf = 16;
+
+	// p has nine doubles for each triangle, as in the tessellation cache, or a mapped HCNCMESH file
+	CompactMesh(const double *p, size_t num_triangles);
+
+	// like GTriMesh::VisitLeavesBestFirst
+	template<class Visitor> void VisitLeavesBestFirst(const double *box, Visitor &visitor, std::vector< std::pair<double, int> > &heap)const
+	{
+		heap.clear();
+		if(m_nodes.size() == 0)return;
+
+		if(boxes_overlap(m_nodes[0].m_box, box))heap.push_back(std::make_pair(visitor.Bound(m_nodes[0]), 0));
+		while(heap.size() > 0)
+		{
+			std::pop_heap(heap.begin(), heap.end());
+			std::pair<double, int> top = heap.back();
+			heap.pop_back();
+			if(top.first <= visitor.Best())break;
+
+			const Node &node = m_nodes[top.second];
+			if(node.m_count > 0)
+			{
+				visitor(node);
+			}
+			else
+			{
+				for(int i = 0; i<2; i++)
+				{
+					const Node &child = m_nodes[node.m_first + i];
+					if(!boxes_overlap(child.m_box, box))continue;
+					heap.push_back(std::make_pair(visitor.Bound(child), node.m_first + i));
+					std::push_heap(heap.begin(), heap.end());
+				}
+			}
+		}
+	}
+
+	// copies the points of a leaf's triangles whose boxes overlap box to p ( nine doubles each, room for max_triangles_in_leaf ), and returns how many
+	int GetTriangles(const Node &leaf, const double *box, double *p)const;
+
+	int NumTriangles()const{return (int)(m_indices.size() / 3);}
+	int NumVertices()const{return (int)(m_vertices.size() / 3);}
+
+	// the largest difference between a point and the point it was made from, in any direction
+	double MaxError()const{return m_max_error;}
+
+	// bytes of memory used by the mesh
+	size_t MemoryUsed()const;
+
+	static bool boxes_overlap(const double *b1, const double *b2)
+	{
+		return !(b1[0] > b2[2] || b1[1] > b2[3] || b1[2] < b2[0] || b1[3] < b2[1]);
+	}
+
+private:
+	std::vector<Node> m_nodes;
+	std::vector<float> m_vertices; // x y z, relative to the origin of the leaf they belong to
+	std::vector<unsigned char> m_indices; // three for each triangle, into its leaf's vertices
+	double m_max_error;
+
+	void Split(const double *p, std::vector<int> &tris, int node_index, int first, int count);
+	void AddLeaf(const double *p, const int *tris, int count, int node_index);
+	void SetBounds();
+	void GetVertex(const Node &leaf, int index, double *v)const;
+};
@@ -214,6 +214,43 @@ void CDepthOp::ReadDefaultValues()
 	config.Read(_T("RapidDown"), &m_depth_op_params.m_rapid_safety_space, 2.0);
 }
 
+void CDepthOpParams::GetDepths(std::vector<double> &depths)const
+{
+	depths.clear();
+
+	if(m_user_depths.Len() > 0)
+	{
+		// the user depths are in the program's units, as they are written to the python program
+		wxString str = m_user_depths;
+		while(str.Len() > 0)
+		{
+			double depth;
+			if(str.BeforeFirst(_T(',')).Trim().Trim(false).ToDouble(&depth))depths.push_back(depth * theApp.m_program->m_units);
+			str = str.AfterFirst(_T(','));
+		}
+		return;
+	}
+
+	double depth = m_final_depth - m_z_thru_depth;
+	depths.push_back(depth);
+	depth += m_z_finish_depth;
+	if(depth + 0.0000001 < m_start_depth)
+	{
+		if(m_z_finish_depth > 0.0000001)depths.insert(depths.begin(), depth);
+		depth += m_z_thru_depth;
+		int layer_count = (m_step_down > 0.0) ? ((int)((m_start_depth - depth) / m_step_down - 0.0000001) + 1) : 1;
+		if(layer_count > 0)
+		{
+			double layer_depth = (m_start_depth - depth) / layer_count;
+			for(int i = 1; i < layer_count; i++)
+			{
+				depth += layer_depth;
+				depths.insert(depths.begin(), depth);
+			}
+		}
+	}
+}
+
 Python CDepthOp::AppendTextToProgram()
 {
 	Python python;
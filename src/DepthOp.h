@@ -12,6 +12,7 @@
 
 #include "SpeedOp.h"
 #include <list>
+#include <vector>
 
 class CDepthOp;
 
@@ -35,6 +36,9 @@ public:
 	void GetProperties(CDepthOp* parent, std::list<Property *> *list);
 	void WriteXMLAttributes(TiXmlNode* pElem);
 	void ReadFromXMLElement(TiXmlElement* pElem);
+
+	// the depths depth_params.get_depths gives the python program, from the top down, in mm
+	void GetDepths(std::vector<double> &depths)const;
 };
 
 class CDepthOp : public CSpeedOp
@@ -19,9 +19,131 @@
 #include "stdafx.h"
 #include "DropCutter.h"
 #include "GTri.h"
+#include "GTriMesh.h"
+#include "CompactMesh.h"
+#include "ThreadPool.h"
 
+#include <atomic>
+#include <mutex>
+#include <sstream>
 
-Cutter::Cutter(double Rset, double rset)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DROPCUTTER_SSE2
+#include <emmintrin.h>
+#endif
+
+
+class DropCutterSample
+{
+public:
+	double m_values[DropCutterDiagnostics::max_sample_values];
+	int m_num_values;
+};
+
+static std::atomic<long> error_counts[DropCutterDiagnostics::eNumErrors];
+static std::mutex samples_mutex;
+static DropCutterSample samples[DropCutterDiagnostics::eNumErrors][DropCutterDiagnostics::max_samples];
+
+void DropCutterDiagnostics::Record(eError error, const double *values, int num_values)
+{
+	long n = ++error_counts[error];
+	if(n > max_samples)return; // already got enough samples, so don't take the lock
+
+	if(num_values > max_sample_values)num_values = max_sample_values;
+	std::unique_lock<std::mutex> lock(samples_mutex);
+	DropCutterSample &sample = samples[error][n - 1];
+	for(int i = 0; i<num_values; i++)sample.m_values[i] = values[i];
+	sample.m_num_values = num_values;
+}
+
+long DropCutterDiagnostics::Count(eError error)
+{
+	return error_counts[error];
+}
+
+long DropCutterDiagnostics::TotalCount()
+{
+	long total = 0;
+	for(int i = 0; i<eNumErrors; i++)total += error_counts[i];
+	return total;
+}
+
+void DropCutterDiagnostics::Reset()
+{
+	std::unique_lock<std::mutex> lock(samples_mutex);
+	for(int i = 0; i<eNumErrors; i++)error_counts[i] = 0;
+}
+
+std::string DropCutterDiagnostics::Report()
+{
+	std::unique_lock<std::mutex> lock(samples_mutex);
+	std::ostringstream report;
+	for(int i = 0; i<eNumErrors; i++)
+	{
+		long count = error_counts[i];
+		if(count == 0)continue;
+
+		report << "DropCutter: " << Description((eError)i) << ": " << count << (count == 1 ? " time\n" : " times\n");
+		for(int j = 0; j < count && j < max_samples; j++)
+		{
+			const DropCutterSample &sample = samples[i][j];
+			report << "    (";
+			for(int k = 0; k<sample.m_num_values; k++)
+			{
+				if(k > 0)report << ", ";
+				report << sample.m_values[k];
+			}
+			report << ")\n";
+		}
+	}
+	return report.str();
+}
+
+const char* DropCutterDiagnostics::Description(eError error)
+{
+	switch(error)
+	{
+	case eCutterRadius:
+		return "cutter radius is not more than 0 (R)";
+	case eCutterCornerRadius:
+		return "corner radius is less than 0 or more than the cutter radius (R, r)";
+	case eCutterFlatRadius:
+		return "flat radius is less than 0 or more than the cutter radius (R, flat radius)";
+	case eCutterAngle:
+		return "cone angle is not between 0 and 90 degrees (half angle in radians)";
+	case eFacetNotInPlane:
+		return "FacetTest contact point not in plane (x, y, distance)";
+	case eFacetTooHigh:
+		return "FacetTest height more than 100000 (x, y, z)";
+	case eEdgeNoCase:
+		return "EdgeTest found no case (x, y, edge start, edge end)";
+	case eTilePadding:
+		return "cutter radius is more than the padding of the surface's tiles (R, padding)";
+	default:
+		return "unknown error";
+	}
+}
+
+#ifdef DROPCUTTER_ONLY
+static double library_tolerance = 0.001;
+
+double DropCutter::Tolerance()
+{
+	return library_tolerance;
+}
+
+void DropCutter::SetTolerance(double tol)
+{
+	library_tolerance = tol;
+}
+#else
+double DropCutter::Tolerance()
+{
+	return heeksCAD->GetTolerance();
+}
+#endif
+
+Cutter::Cutter(double Rset, double rset):Rf(0.0), h(0.0), m_cone(false)
 {
 	if (Rset > 0)
 	{
@@ -29,7 +151,7 @@ Cutter::Cutter(double Rset, double rset)
 	}
 	else
 	{
-		wxMessageBox(_T("Cutter: ERROR R<0!"));
+		DropCutterDiagnostics::Record(DropCutterDiagnostics::eCutterRadius, &Rset, 1);
 		R = 1;
 	}
 
@@ -39,15 +161,69 @@ Cutter::Cutter(double Rset, double rset)
 	}
 	else
 	{
-		// ERROR!
-		// Throw an exception or something
-		wxMessageBox(_T("Cutter: ERROR r<0 or r>R!"));
+		double values[2] = {Rset, rset};
+		DropCutterDiagnostics::Record(DropCutterDiagnostics::eCutterCornerRadius, values, 2);
 		r = 0;
 	}
 }
 
-// static member functions
-double DropCutter::VertexTest(const Cutter &c, const double *e, const double *p)
+Cutter::Cutter(double Rset, double flat_radius, double half_angle):r(0.0), m_cone(true)
+{
+	if (Rset > 0)
+	{
+		R = Rset;
+	}
+	else
+	{
+		DropCutterDiagnostics::Record(DropCutterDiagnostics::eCutterRadius, &Rset, 1);
+		R = 1;
+	}
+
+	if ((flat_radius >= 0) && (flat_radius <= R))
+	{
+		Rf = flat_radius;
+	}
+	else
+	{
+		double values[2] = {Rset, flat_radius};
+		DropCutterDiagnostics::Record(DropCutterDiagnostics::eCutterFlatRadius, values, 2);
+		Rf = 0;
+	}
+
+	if ((half_angle > 0) && (half_angle < 1.5707963267948966))
+	{
+		h = (R - Rf) / tan(half_angle);
+	}
+	else
+	{
+		DropCutterDiagnostics::Record(DropCutterDiagnostics::eCutterAngle, &half_angle, 1);
+		h = 0;
+	}
+}
+
+Cutter::eShape Cutter::Shape(double tol)const
+{
+	if(m_cone)
+	{
+		// a cone which is nearly a cylinder, or nearly flat, is done as a flat cutter
+		if(R - Rf < tol || h < tol)return eFlat;
+		return eCone;
+	}
+	if(fabs(r) < tol)return eFlat;
+	if(r == R)return eBall; // only when exactly equal, so that R - r is exactly zero and the ball tests match the bull tests
+	return eBull;
+}
+
+// the tests, specialised for each shape of cutter, with the tolerance passed in
+// the shape is a template parameter, so "if(S == Cutter::eFlat)" gets decided by the compiler
+
+template<int S> static inline double corner_offset(const Cutter &cu)
+{
+	// R - r, which is zero for a ball cutter
+	return (S == Cutter::eBall) ? 0.0 : (cu.R - cu.r);
+}
+
+template<int S> static double vertex_test(const Cutter &c, const double *e, const double *p, double tol)
 {
 	// c.R and c.r define the cutter
 	// e.x and e.y is the xy-position of the cutter (e.z is ignored)
@@ -56,12 +232,25 @@ double DropCutter::VertexTest(const Cutter &c, const double *e, const double *p)
 	// q is the distance along xy-plane from e to vertex
 	double q = sqrt(pow(e[0] - p[0], 2) + pow((e[1] - p[1]), 2));
 
-	if (q > c.R + heeksCAD->GetTolerance())
+	if (q > c.R + tol)
 	{
 		// vertex is outside cutter. no need to do anything!
 		return -10000000.0;
 	}
-	else if (q <= (c.R - c.r) + heeksCAD->GetTolerance())
+
+	if(S == Cutter::eFlat)
+	{
+		return p[2];
+	}
+
+	if(S == Cutter::eCone)
+	{
+		if (q <= c.Rf + tol)return p[2];
+		if(q > c.R)q = c.R;
+		return p[2] - (q - c.Rf) * c.h / (c.R - c.Rf);
+	}
+
+	if (q <= corner_offset<S>(c) + tol)
 	{
 		// vertex is in the cylindical/flat part of the cutter
 		return p[2];
@@ -70,183 +259,187 @@ double DropCutter::VertexTest(const Cutter &c, const double *e, const double *p)
 	{
 		if(q > c.R)q = c.R;
 		// vertex is in the toroidal part of the cutter
-		double h2 = sqrt(pow(c.r, 2) - pow((q - (c.R - c.r)), 2));
+		double h2 = sqrt(pow(c.r, 2) - pow((q - corner_offset<S>(c)), 2));
 		double h1 = c.r - h2;
 		return p[2] - h1;
 	}
 }
 
-double DropCutter::FacetTest(const Cutter &cu, const double *e, const GTri &t)
+static bool isinrange(double start, double end, double x, double tol)
 {
-	// local copy of the surface normal
+	// order input
+	double s_tmp = start;
+	//double e_tmp = end;
+	if (start > end)
+	{
+		start = end;
+		end = s_tmp;
+	}
 
-	//t.calculate_normal(); // don't trust the pre-calculated normal! calculate it separately here.
-	// make sure to use calculate_normal whenever the triangle is made or modified
+	if ((x >= start - tol) && (x <= end + tol))
+		return true;
+	else
+		return false;
+}
 
-	double n[3] = {t.m_n[0], t.m_n[1], t.m_n[2]};
-	double cc[3];
+// the cone cutter's height above its tip at distance q from its axis
+static inline double cone_profile(const Cutter &cu, double q)
+{
+	if(q <= cu.Rf)return 0.0;
+	if(q > cu.R)q = cu.R;
+	return (q - cu.Rf) * cu.h / (cu.R - cu.Rf);
+}
 
-	if (fabs(n[2]) < 0.000000000001)
+// the bull nose cutter's height above its tip at distance d from its axis, with its first and second derivatives
+static inline double bull_profile(const Cutter &cu, double d, double &slope, double &curvature)
+{
+	double t = d - (cu.R - cu.r); // out from where the corner starts
+	if(t <= 0.0)
 	{
-		// vertical plane, can't touch cutter against that!
-		return -10000000.0;
+		slope = 0.0;
+		curvature = 0.0;
+		return 0.0;
 	}
-	else if (n[2] < 0)
+	double s2 = cu.r * cu.r - t * t;
+	if(s2 <= 0.000000000001)
 	{
-		// flip the normal so it points up (? is this always required?)
-		for(int i = 0; i<3; i++)n[i] = -1*n[i];
+		slope = 1.0e12; // the side of the cutter
+		curvature = 1.0e12;
+		return cu.r;
 	}
+	double s = sqrt(s2);
+	slope = t / s;
+	curvature = cu.r * cu.r / (s2 * s);
+	return cu.r - s;
+}
 
-	// define plane containing facet
-	double a = n[0];
-	double b = n[1];
-	double c = n[2];
-	double d = - n[0] * t.m_p[0] - n[1] * t.m_p[1] - n[2] * t.m_p[2];
+static const int max_bull_edge_iterations = 64;
 
-	// the z-direction normal is a special case (?required?)
-	// in debug phase, see if this is a useful case!
-	if ((fabs(a) < heeksCAD->GetTolerance()) && (fabs(b) < heeksCAD->GetTolerance()))
+// the edge test for a bull nose cutter, in edge_test's frame, where the edge runs along x from start to end, at distance l from the cutter's axis
+// the cutter touches where the edge's height less the cutter's profile under it is highest
+// that is concave along x, so its slope goes down from +infinity to -infinity across the cutter, and is zero at the contact
+// this finds the zero with Newton's method, halving the range it must be in whenever a step would go outside it
+static double bull_edge_test(const Cutter &cu, const double *start, const double *end, double l, double tol)
+{
+	double w = (l < cu.R) ? sqrt(cu.R * cu.R - l * l) : 0.0;
+	double m = (end[2] - start[2]) / (end[0] - start[0]);
+
+	double lo = -w;
+	double hi = w;
+	double x = 0.0;
+	double slope, curvature;
+	for(int i = 0; i<max_bull_edge_iterations && hi - lo > 0.0000000001; i++)
 	{
-		// System.Console.WriteLine("facet-test:z-dir normal case!");
-		cc[0] = e[0];
-		cc[1] = e[1];
-		cc[2] = t.m_p[2];
-		if (isinside(t, cc))
+		// the slope of the edge's height less the profile, and its derivative
+		double d = sqrt(x * x + l * l);
+		bull_profile(cu, d, slope, curvature);
+		double g1 = m;
+		double g2 = 0.0;
+		if(d > 0.0)
 		{
-			// System.Console.WriteLine("facet-test:z-dir normal case!, returning {0}",e.z);
-			// System.Console.ReadKey();
-			return cc[2];
+			g1 -= slope * x / d;
+			g2 = -(curvature * x * x / (d * d) + slope * l * l / (d * d * d));
 		}
-		else
-			return -10000000.0;
-	}
-
-	// System.Console.WriteLine("facet-test:general case!");
-	// facet test general case
-	// uses trigonometry, so might be too slow?
-
-	// flat endmill and ballnose should be simple to do without trig
-	// toroidal case might require offset-ellipse idea?
-
-	/*
-	theta = asin(c);
-	zf= -d/c - (a*xe+b*ye)/c+ (R-r)/tan(theta) + r/sin(theta) -r;
-	e=[xe ye zf];
-	u=[0  0  1];
-	rc=e + ((R-r)*tan(theta)+r)*u - ((R-r)/cos(theta) + r)*n;
-	t=isinside(p1,p2,p3,rc);
-	*/
-
-	double theta = asin(c);
-	double zf = -d/c - (a*e[0]+b*e[1])/c + (cu.R-cu.r)/tan(theta) + cu.r/sin(theta) - cu.r;
-	double ve[3] = {e[0],e[1],zf};
-	double u[3] = {0,0,1};
-	double rc[3] = {ve[0], ve[1], ve[2]};
-	for(int i = 0; i<3; i++)rc[i] = ve[i] + ((cu.R-cu.r)*tan(theta)+cu.r)*u[i] - ((cu.R-cu.r)/cos(theta)+cu.r)*n[i];
-
-	/*
-	if (rc.z > 1000)
-	System.Console.WriteLine("z>1000 !");
-	*/
-
-	cc[0] = rc[0];
-	cc[1] = rc[1];
-	cc[2] = rc[2];
-
-	// check that CC lies in plane:
-	// a*rc(1)+b*rc(2)+c*rc(3)+d
-	double test = a * cc[0] + b * cc[1] + c * cc[2] + d;
-	if (test > 0.000001)
-		wxMessageBox(_T("FacetTest ERROR! CC point not in plane"));
+		if(g1 > 0.0)lo = x;
+		else hi = x;
 
-	if (isinside(t, cc))
-	{
-		if (fabs(zf) > 100000)
+		double next = (g2 < 0.0) ? (x - g1 / g2) : lo - 1.0;
+		if(next <= lo || next >= hi)next = (lo + hi) * 0.5;
+		if(fabs(next - x) < 0.0000000001)
 		{
-			wxMessageBox(wxString::Format(_T("serious problem... at %lf,%lf"), e[0], e[1]));
+			x = next;
+			break;
 		}
-		return zf;
+		x = next;
 	}
-	else
-		return -10000000.0;
+
+	if(!isinrange(start[0], end[0], x, tol))return -10000000.0; // the vertex tests do the ends
+	return start[2] + (x - start[0]) * m - bull_profile(cu, sqrt(x * x + l * l), slope, curvature);
 }
 
-static bool isinrange(double start, double end, double x)
+static double cone_edge_test(const Cutter &cu, const double *e, const double *p1, const double *p2, double ux, double uy, double len, double tol)
 {
-	// order input
-	double s_tmp = start;
-	//double e_tmp = end;
-	if (start > end)
+	// the edge in a frame where it runs along x, at distance l from the cutter's axis
+	if(len < 0.000000001)return -10000000.0; // vertical edge, the vertex tests do this
+	double sx = p1[0] - e[0];
+	double sy = p1[1] - e[1];
+	double xs = sx * ux + sy * uy; // start of edge
+	double l = fabs(sx * uy - sy * ux);
+
+	if (l > cu.R + tol)return -10000000.0; // edge is outside of the cutter
+	double w = (l < cu.R) ? sqrt(cu.R * cu.R - l * l) : 0.0;
+
+	// the part of the edge under the cutter
+	double x0 = xs;
+	double x1 = xs + len;
+	if(x0 < -w - tol)x0 = -w - tol;
+	if(x1 > w + tol)x1 = w + tol;
+	if(x0 > x1)return -10000000.0;
+
+	// height of edge minus height of cutter profile; the highest of these is where they touch
+	// it is greatest at the ends of the part under the cutter, at the edge of the flat bottom, or where its slope matches the cone's
+	double m = (p2[2] - p1[2]) / len;
+	double k = cu.h / (cu.R - cu.Rf);
+	double candidates[5] = {x0, x1, 0.0, 0.0, 0.0};
+	int num_candidates = 2;
+	if(l < cu.Rf)
 	{
-		start = end;
-		end = s_tmp;
+		double xf = sqrt(cu.Rf * cu.Rf - l * l);
+		candidates[num_candidates++] = xf;
+		candidates[num_candidates++] = -xf;
+	}
+	if(fabs(m) < k)
+	{
+		double t = m / k;
+		candidates[num_candidates++] = l * t / sqrt(1 - t * t);
 	}
 
-	if ((x >= start - heeksCAD->GetTolerance()) && (x <= end + heeksCAD->GetTolerance()))
-		return true;
-	else
-		return false;
+	double z = -10000000.0;
+	for(int i = 0; i<num_candidates; i++)
+	{
+		double x = candidates[i];
+		if(x < x0 || x > x1)continue;
+		double ze = p1[2] + (x - xs) * m - cone_profile(cu, sqrt(x * x + l * l));
+		if(ze > z)z = ze;
+	}
+	return z;
 }
 
-double DropCutter::EdgeTest(const Cutter &cu, const double *e, const double *p1, const double *p2)
+template<int S> static double edge_test(const Cutter &cu, const double *e, const double *p1, const double *p2, double ux, double uy, double len, double tol)
 {
-	// contact cutter against edge from p1 to p2
-
-	// translate segment so that cutter is at (0,0)
-	double start[3] = {p1[0] - e[0], p1[1] - e[1], p1[2]};
-	double end[3] = {p2[0] - e[0], p2[1] - e[1], p2[2]};
+	if(S == Cutter::eCone)return cone_edge_test(cu, e, p1, p2, ux, uy, len, tol);
 
-	// find angle btw. segment and X-axis
-	double dx = end[0] - start[0];
-	double dy = end[1] - start[1];
-	double alfa;
-	if (fabs(dx) > 0.0000000000001)
-		alfa = atan(dy / dx);
-	else
-		alfa = 1.5707963267948966;
+	// contact cutter against edge from p1 to p2
+	// ux uy is the edge's unit direction in xy and len is its length in xy, so no trig is needed here
 
-	//alfa = -alfa;
-	// rotation matrix for rotation around z-axis:
-	// should probably implement a matrix class later
+	if(len < 0.000000001)return -10000000.0; // vertical edge, the vertex tests do this
 
-	// rotate by angle alfa
-	// need copy of data that does not change as we go through each line:
-	double sx = start[0], sy = start[1], ex = end[0], ey = end[1];
-	start[0] = sx * cos(alfa) + sy * sin(alfa);
-	start[1] = -sx * sin(alfa) + sy * cos(alfa);
-	end[0] = ex * cos(alfa) + ey * sin(alfa);
-	end[1] = -ex * sin(alfa) + ey * cos(alfa);
+	// translate segment so that cutter is at (0,0), and rotate it so that it runs along x
+	double sx = p1[0] - e[0], sy = p1[1] - e[1];
+	double start[3] = {sx * ux + sy * uy, sy * ux - sx * uy, p1[2]};
+	double end[3] = {start[0] + len, start[1], p2[2]};
 
 	// check if segment is below cutter
-
 	if (start[1] > 0)
 	{
-		alfa = alfa+3.1415926535897932;
-		start[0] = sx * cos(alfa) + sy * sin(alfa);
-		start[1] = -sx * sin(alfa) + sy * cos(alfa);
-		end[0] = ex * cos(alfa) + ey * sin(alfa);
-		end[1] = -ex * sin(alfa) + ey * cos(alfa);
-	}
-
-	if (fabs(start[1]-end[1])>0.0000000001)
-	{
-		wxMessageBox(wxString::Format(_T("EdgeTest ERROR! (start.y - end.y) = %lf"), start[1]-end[1]));
-		return -10000000.0;
+		// turn it round by 180 degrees
+		start[0] = -start[0];
+		start[1] = -start[1];
+		end[0] = -end[0];
+		end[1] = start[1];
 	}
 
 	double l = -start[1]; // distance from cutter to edge
-	if (l < -heeksCAD->GetTolerance())
-		wxMessageBox(_T("EdgeTest ERROR! l<0 !"));
 
 	// System.Console.WriteLine("l=" + l+" start.y="+start.y+" end.y="+end.y);
 
 
 	// now we have two different algorithms depending on the cutter:
-	if (fabs(cu.r) < heeksCAD->GetTolerance())
+	if (S == Cutter::eFlat)
 	{
 		// this is the flat endmill case
 		// it is easier and faster than the general case, so we handle it separately
-		if (l > cu.R + heeksCAD->GetTolerance()) // edge is outside of the cutter
+		if (l > cu.R + tol) // edge is outside of the cutter
 			return -10000000.0;
 		else // we are inside the cutter
 		{
@@ -272,12 +465,10 @@ double DropCutter::EdgeTest(const Cutter &cu, const double *e, const double *p1,
 			}
 
 			// now that we have a CC point, check if it's in the edge
-			if ((start[0] > xc + heeksCAD->GetTolerance()) && (xc + heeksCAD->GetTolerance()< end[0]))
-				return -10000000.0;
-			else if ((end[0] < xc - heeksCAD->GetTolerance()) && (xc + heeksCAD->GetTolerance() > start[0]))
-				return -10000000.0;
-			else
+			if (isinrange(start[0], end[0], xc, tol))
 				return zc;
+			else
+				return -10000000.0;
 
 		}
 		// unreachable place (according to compiler)
@@ -287,48 +478,59 @@ double DropCutter::EdgeTest(const Cutter &cu, const double *e, const double *p1,
 		// System.Console.WriteLine("edgetest r>0 case!");
 
 		// this is the general case (r>0)   ball-nose or bull-nose (spherical or toroidal)
-		// later a separate case for the ball-cutter might be added (for performance)
 
+		double Rr = corner_offset<S>(cu);
 		double xd=0, w=0, h=0, xd1=0, xd2=0, xc=0 , ze=0, zc=0;
 
-		if (l > cu.R + heeksCAD->GetTolerance()) // edge is outside of the cutter
+		if (l > cu.R + tol) // edge is outside of the cutter
 			return -10000000.0;
-		else if (((cu.R-cu.r)<l - heeksCAD->GetTolerance())&&(l<=cu.R + heeksCAD->GetTolerance()))
+		else if ((Rr<l - tol)&&(l<=cu.R + tol))
 		{    // toroidal case
 			xd=0; // center of ellipse
 			w=sqrt(pow(cu.R,2)-pow(l,2)); // width of ellipse
-			h=sqrt(pow(cu.r,2)-pow((l-(cu.R-cu.r)),2)); // height of ellipse
+			h=sqrt(pow(cu.r,2)-pow((l-Rr),2)); // height of ellipse
 		}
-		else if ((cu.R-cu.r)>=l)
+		else if (Rr>=l - tol)
 		{
 			// quarter ellipse case
-			xd1=sqrt( pow((cu.R-cu.r),2)-pow(l,2));
+			// this includes l up to the tolerance past Rr, the same as in the tests below, so no edge falls between the two cases
+			double rr_l = (Rr > l) ? sqrt( pow(Rr,2)-pow(l,2)) : 0.0;
+			xd1=rr_l;
 			xd2=-xd1;
 			h=cu.r; // ellipse height
-			w=sqrt( pow(cu.R,2)-pow(l,2) )- sqrt( pow((cu.R-cu.r),2)-pow(l,2) ); // ellipse height
+			w=sqrt( pow(cu.R,2)-pow(l,2) )- rr_l; // ellipse width
+		}
+		else
+		{
+			// only if l isn't a number, from points which aren't numbers
+			double values[8] = {e[0], e[1], p1[0], p1[1], p1[2], p2[0], p2[1], p2[2]};
+			DropCutterDiagnostics::Record(DropCutterDiagnostics::eEdgeNoCase, values, 8);
+			return -10000000.0;
 		}
 
 		// now there is a special case where the theta calculation will fail if
 		// the segment is horziontal, i.e. start.z==end.z  so we need to catch that here
-		if (fabs(start[2] - end[2]) < heeksCAD->GetTolerance())
+		if (fabs(start[2] - end[2]) < tol)
 		{
-			if ((cu.R-cu.r)<l - heeksCAD->GetTolerance())
+			// the higher end is used, so the height doesn't depend on which way round the edge is, and the cutter is never below the edge
+			double edge_z = (start[2] > end[2]) ? start[2] : end[2];
+			if (Rr<l - tol)
 			{
 				// half-ellipse case
 				xc=0;
-				h=sqrt(pow(cu.r,2)-pow((l-(cu.R-cu.r)),2));
-				ze = start[2] + h - cu.r;
+				h=sqrt(pow(cu.r,2)-pow((l-Rr),2));
+				ze = edge_z + h - cu.r;
 			}
 			else
 			{
 				// quarter ellipse case
 				xc = 0;
-				ze = start[2];
+				ze = edge_z;
 			}
 
 			// now we have a CC point
 			// so we need to check if the CC point is in the edge
-			if (isinrange(start[0], end[0], xc))
+			if (isinrange(start[0], end[0], xc, tol))
 				return ze;
 			else
 				return -10000000.0;
@@ -336,17 +538,29 @@ double DropCutter::EdgeTest(const Cutter &cu, const double *e, const double *p1,
 		} // end horizontal edge special case
 
 
-		// now the general case where the theta calculation works
-		double theta = atan( h*(start[0]-end[0])/(w*(start[2]-end[2])) );
-
 		if(fabs(end[0] - start[0]) < 0.000000001)return -10000000.0; // instead of maths error below
 
+		// the torus isn't cut in an ellipse by the edge's plane, so the ellipse below would put a bull nose cutter too low on a sloping edge
+		if (S == Cutter::eBull)return bull_edge_test(cu, start, end, l, tol);
+
+		// now the general case where the theta calculation works
+		// theta = atan( h*(start.x-end.x)/(w*(start.z-end.z)) ), but only the sizes of its cos and sin are needed
+		double tan_num = h*(start[0]-end[0]);
+		double tan_den = w*(start[2]-end[2]);
+		double tan_len = sqrt(tan_num*tan_num + tan_den*tan_den);
+		double cos_theta = 1.0, sin_theta = 0.0;
+		if (tan_len > 0)
+		{
+			cos_theta = fabs(tan_den) / tan_len;
+			sin_theta = fabs(tan_num) / tan_len;
+		}
+
 		// based on this calculate the CC point
-		if (((cu.R - cu.r) < l - heeksCAD->GetTolerance()) && (cu.R <= l + heeksCAD->GetTolerance()))
+		if ((Rr < l - tol) && (cu.R <= l + tol))
 		{
 			// half-ellipse case
-			double xc1 = xd + fabs(w * cos(theta));
-			double xc2 = xd - fabs(w * cos(theta));
+			double xc1 = xd + w * cos_theta;
+			double xc2 = xd - w * cos_theta;
 			double zc1 = ((xc1 - start[0]) / (end[0] - start[0])) * (end[2] - start[2]) + start[2];
 			double zc2 = ((xc2 - start[0]) / (end[0] - start[0])) * (end[2] - start[2]) + start[2];
 			// select the higher point:
@@ -365,8 +579,8 @@ double DropCutter::EdgeTest(const Cutter &cu, const double *e, const double *p1,
 		else
 		{
 			// quarter ellipse case
-			double xc1 = xd1 + fabs(w * cos(theta));
-			double xc2 = xd2 - fabs(w * cos(theta));
+			double xc1 = xd1 + w * cos_theta;
+			double xc2 = xd2 - w * cos_theta;
 			double zc1 = ((xc1 - start[0]) / (end[0] - start[0])) * (end[2] - start[2]) + start[2];
 			double zc2 = ((xc2 - start[0]) / (end[0] - start[0])) * (end[2] - start[2]) + start[2];
 			// select the higher point:
@@ -383,61 +597,294 @@ double DropCutter::EdgeTest(const Cutter &cu, const double *e, const double *p1,
 		}
 
 		// now we have a valid xc value, so calculate the ze value:
-		ze = zc + fabs(h * sin(theta)) - cu.r;
+		ze = zc + h * sin_theta - cu.r;
 
 		// finally, check that the CC point is in the edge
-		if (isinrange(start[0],end[0],xc))
+		if (isinrange(start[0],end[0],xc,tol))
 			return ze;
 		else
 			return -10000000.0;
+	} // end of toroidal/spherical case
+}
 
+// the same, for an edge which isn't in a mesh
+template<int S> static double edge_test(const Cutter &cu, const double *e, const double *p1, const double *p2, double tol)
+{
+	double dx = p2[0] - p1[0];
+	double dy = p2[1] - p1[1];
+	double len = sqrt(dx * dx + dy * dy);
+	if(len < 0.000000001)return -10000000.0;
+	return edge_test<S>(cu, e, p1, p2, dx / len, dy / len, len, tol);
+}
 
-		// this line is unreachable (according to compiler)
-
-	} // end of toroidal/spherical case
+// the facet test for a cone cutter
+// a b c is the upward normal of the plane, z_at_e is the height of the plane under the cutter's axis
+static double cone_facet_test(const Cutter &cu, const double *e, double a, double b, double c, double z_at_e, const double *p1, const double *p2, const double *p3, double z0, double tol)
+{
+	double cc[2] = {e[0], e[1]};
+	double z;
 
+	if ((fabs(a) < tol) && (fabs(b) < tol))
+	{
+		// z-direction normal
+		z = z0;
+	}
+	else
+	{
+		// the plane touches either the rim of the flat bottom, or the top of the cone, on the uphill side
+		double m = sqrt(a * a + b * b);
+		double slope = m / c;
+		double zb = z_at_e + cu.Rf * slope;
+		double zt = z_at_e + cu.R * slope - cu.h;
+		double radius = cu.Rf;
+		z = zb;
+		if(zt > zb)
+		{
+			z = zt;
+			radius = cu.R;
+		}
+		cc[0] = e[0] - radius * a / m;
+		cc[1] = e[1] - radius * b / m;
+	}
 
-	// if we ever get here it is probably a serious error!
-	wxMessageBox(_T("EdgeTest: ERROR: no case returned a valid ze!"));
+	bool b1 = DropCutter::isright(p1, p2, cc);
+	bool b2 = DropCutter::isright(p3, p1, cc);
+	bool b3 = DropCutter::isright(p2, p3, cc);
+	if((b1 && b2 && b3) || (!b1 && !b2 && !b3))return z;
 	return -10000000.0;
 }
 
-bool DropCutter::isinside(const GTri &t, const double *p)
+// the facet test, using the mesh's precalculated plane, doing the same sums as FacetTest
+template<int S> static double facet_test(const Cutter &cu, const double *e, const GTriMesh &mesh, int i, double tol)
 {
-	// point in triangle test
-
-	// a new Tri projected onto the xy plane:
-	double p1[3] = {t.m_p[0], t.m_p[1], 0};
-	double p2[3] = {t.m_p[3], t.m_p[4], 0};
-	double p3[3] = {t.m_p[6], t.m_p[7], 0};
-	double pt[3] = {p[0], p[1], 0};
+	double c = mesh.m_n[2][i];
+	if (fabs(c) < 0.000000000001)return -10000000.0; // vertical plane
 
-	bool b1 = isright(p1, p2, pt);
-	bool b2 = isright(p3, p1, pt);
-	bool b3 = isright(p2, p3, pt);
+	double a = mesh.m_n[0][i];
+	double b = mesh.m_n[1][i];
+	double p1[2] = {mesh.m_p[0][i], mesh.m_p[1][i]};
+	double p2[2] = {mesh.m_p[3][i], mesh.m_p[4][i]};
+	double p3[2] = {mesh.m_p[6][i], mesh.m_p[7][i]};
 
-	if ((b1) && (b2) && (b3))
+	if(S == Cutter::eCone)
 	{
-		return true;
+		return cone_facet_test(cu, e, a, b, c, mesh.m_neg_d_over_c[i] - (a*e[0]+b*e[1])/c, p1, p2, p3, mesh.m_p[2][i], tol);
 	}
-	else if ((!b1) && (!b2) && (!b3))
+
+	double cc[2] = {e[0], e[1]};
+	double z;
+
+	if ((fabs(a) < tol) && (fabs(b) < tol))
 	{
-		return true;
+		// z-direction normal
+		z = mesh.m_p[2][i];
 	}
 	else
 	{
-		return false;
+		double Rr = corner_offset<S>(cu);
+		z = mesh.m_neg_d_over_c[i] - (a*e[0]+b*e[1])/c + Rr/mesh.m_tan_theta[i] + cu.r/mesh.m_sin_theta[i] - cu.r;
+		double k = Rr/mesh.m_cos_theta[i]+cu.r;
+		cc[0] = e[0] - k * a;
+		cc[1] = e[1] - k * b;
 	}
 
+	bool b1 = DropCutter::isright(p1, p2, cc);
+	bool b2 = DropCutter::isright(p3, p1, cc);
+	bool b3 = DropCutter::isright(p2, p3, cc);
+	if((b1 && b2 && b3) || (!b1 && !b2 && !b3))return z;
+	return -10000000.0;
 }
 
-bool DropCutter::isright(const double *p1, const double *p2, const double *p)
+// static member functions
+double DropCutter::VertexTest(const Cutter &c, const double *e, const double *p)
 {
-	// is point p right of line through points p1 and p2 ?
+	double tol = DropCutter::Tolerance();
+	switch(c.Shape(tol))
+	{
+	case Cutter::eFlat:
+		return vertex_test<Cutter::eFlat>(c, e, p, tol);
+	case Cutter::eBall:
+		return vertex_test<Cutter::eBall>(c, e, p, tol);
+	case Cutter::eCone:
+		return vertex_test<Cutter::eCone>(c, e, p, tol);
+	default:
+		return vertex_test<Cutter::eBull>(c, e, p, tol);
+	}
+}
 
-	// this is an ugly way of doing a determinant
-	// should be prettyfied sometime...
-	double a1 = p2[0] - p1[0];
+// the facet test for one triangle, with the cutter's shape and the tolerance already worked out
+template<int S> static double facet_test(const Cutter &cu, const double *e, const GTri &t, double tol)
+{
+	// local copy of the surface normal
+
+	//t.calculate_normal(); // don't trust the pre-calculated normal! calculate it separately here.
+	// make sure to use calculate_normal whenever the triangle is made or modified
+
+	double n[3] = {t.m_n[0], t.m_n[1], t.m_n[2]};
+	double cc[3];
+
+	if (fabs(n[2]) < 0.000000000001)
+	{
+		// vertical plane, can't touch cutter against that!
+		return -10000000.0;
+	}
+	else if (n[2] < 0)
+	{
+		// flip the normal so it points up (? is this always required?)
+		for(int i = 0; i<3; i++)n[i] = -1*n[i];
+	}
+
+	// define plane containing facet
+	double a = n[0];
+	double b = n[1];
+	double c = n[2];
+	double d = - n[0] * t.m_p[0] - n[1] * t.m_p[1] - n[2] * t.m_p[2];
+
+	if(S == Cutter::eCone)
+	{
+		return cone_facet_test(cu, e, a, b, c, -d/c - (a*e[0]+b*e[1])/c, &t.m_p[0], &t.m_p[3], &t.m_p[6], t.m_p[2], tol);
+	}
+
+	// the z-direction normal is a special case (?required?)
+	// in debug phase, see if this is a useful case!
+	if ((fabs(a) < tol) && (fabs(b) < tol))
+	{
+		// System.Console.WriteLine("facet-test:z-dir normal case!");
+		cc[0] = e[0];
+		cc[1] = e[1];
+		cc[2] = t.m_p[2];
+		if (DropCutter::isinside(t, cc))
+		{
+			// System.Console.WriteLine("facet-test:z-dir normal case!, returning {0}",e.z);
+			// System.Console.ReadKey();
+			return cc[2];
+		}
+		else
+			return -10000000.0;
+	}
+
+	// System.Console.WriteLine("facet-test:general case!");
+	// facet test general case
+	// uses trigonometry, so might be too slow?
+
+	// flat endmill and ballnose should be simple to do without trig
+	// toroidal case might require offset-ellipse idea?
+
+	/*
+	theta = asin(c);
+	zf= -d/c - (a*xe+b*ye)/c+ (R-r)/tan(theta) + r/sin(theta) -r;
+	e=[xe ye zf];
+	u=[0  0  1];
+	rc=e + ((R-r)*tan(theta)+r)*u - ((R-r)/cos(theta) + r)*n;
+	t=isinside(p1,p2,p3,rc);
+	*/
+
+	double theta = asin(c);
+	double zf = -d/c - (a*e[0]+b*e[1])/c + (cu.R-cu.r)/tan(theta) + cu.r/sin(theta) - cu.r;
+	double ve[3] = {e[0],e[1],zf};
+	double u[3] = {0,0,1};
+	double rc[3] = {ve[0], ve[1], ve[2]};
+	for(int i = 0; i<3; i++)rc[i] = ve[i] + ((cu.R-cu.r)*tan(theta)+cu.r)*u[i] - ((cu.R-cu.r)/cos(theta)+cu.r)*n[i];
+
+	/*
+	if (rc.z > 1000)
+	System.Console.WriteLine("z>1000 !");
+	*/
+
+	cc[0] = rc[0];
+	cc[1] = rc[1];
+	cc[2] = rc[2];
+
+	// check that CC lies in plane:
+	// a*rc(1)+b*rc(2)+c*rc(3)+d
+	double test = a * cc[0] + b * cc[1] + c * cc[2] + d;
+	if (test > 0.000001)
+	{
+		double values[3] = {e[0], e[1], test};
+		DropCutterDiagnostics::Record(DropCutterDiagnostics::eFacetNotInPlane, values, 3);
+	}
+
+	if (DropCutter::isinside(t, cc))
+	{
+		if (fabs(zf) > 100000)
+		{
+			double values[3] = {e[0], e[1], zf};
+			DropCutterDiagnostics::Record(DropCutterDiagnostics::eFacetTooHigh, values, 3);
+		}
+		return zf;
+	}
+	else
+		return -10000000.0;
+}
+
+double DropCutter::FacetTest(const Cutter &cu, const double *e, const GTri &t)
+{
+	double tol = DropCutter::Tolerance();
+	switch(cu.Shape(tol))
+	{
+	case Cutter::eFlat:
+		return facet_test<Cutter::eFlat>(cu, e, t, tol);
+	case Cutter::eBall:
+		return facet_test<Cutter::eBall>(cu, e, t, tol);
+	case Cutter::eCone:
+		return facet_test<Cutter::eCone>(cu, e, t, tol);
+	default:
+		return facet_test<Cutter::eBull>(cu, e, t, tol);
+	}
+}
+
+double DropCutter::EdgeTest(const Cutter &cu, const double *e, const double *p1, const double *p2)
+{
+	double tol = DropCutter::Tolerance();
+	switch(cu.Shape(tol))
+	{
+	case Cutter::eFlat:
+		return edge_test<Cutter::eFlat>(cu, e, p1, p2, tol);
+	case Cutter::eBall:
+		return edge_test<Cutter::eBall>(cu, e, p1, p2, tol);
+	case Cutter::eCone:
+		return edge_test<Cutter::eCone>(cu, e, p1, p2, tol);
+	default:
+		return edge_test<Cutter::eBull>(cu, e, p1, p2, tol);
+	}
+}
+
+bool DropCutter::isinside(const GTri &t, const double *p)
+{
+	// point in triangle test
+
+	// a new Tri projected onto the xy plane:
+	double p1[3] = {t.m_p[0], t.m_p[1], 0};
+	double p2[3] = {t.m_p[3], t.m_p[4], 0};
+	double p3[3] = {t.m_p[6], t.m_p[7], 0};
+	double pt[3] = {p[0], p[1], 0};
+
+	bool b1 = isright(p1, p2, pt);
+	bool b2 = isright(p3, p1, pt);
+	bool b3 = isright(p2, p3, pt);
+
+	if ((b1) && (b2) && (b3))
+	{
+		return true;
+	}
+	else if ((!b1) && (!b2) && (!b3))
+	{
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+
+}
+
+bool DropCutter::isright(const double *p1, const double *p2, const double *p)
+{
+	// is point p right of line through points p1 and p2 ?
+
+	// this is an ugly way of doing a determinant
+	// should be prettyfied sometime...
+	double a1 = p2[0] - p1[0];
 	double a2 = p2[1] - p1[1];
 	double t1 = a2;
 	double t2 = -a1;
@@ -451,7 +898,7 @@ bool DropCutter::isright(const double *p1, const double *p2, const double *p)
 		return false;
 }
 
-double DropCutter::TriTest(const Cutter &cu, const double *e, const GTri &t, double minz)
+template<int S> static double tri_test(const Cutter &cu, const double *e, const GTri &t, double minz, double tol)
 {
 	// does all the tests
 	if(e[0] + cu.R < t.m_box[0])return minz;
@@ -462,34 +909,811 @@ double DropCutter::TriTest(const Cutter &cu, const double *e, const GTri &t, dou
 	double z = minz;
 
 	double temp_z;
-	temp_z = DropCutter::FacetTest(cu, e, t);
+	temp_z = facet_test<S>(cu, e, t, tol);
 	if(temp_z > z)z = temp_z;
-	temp_z = DropCutter::EdgeTest(cu, e, &(t.m_p[0]), &(t.m_p[3]));
+	temp_z = edge_test<S>(cu, e, &(t.m_p[0]), &(t.m_p[3]), tol);
 	if(temp_z > z)z = temp_z;
-	temp_z = DropCutter::EdgeTest(cu, e, &(t.m_p[3]), &(t.m_p[6]));
+	temp_z = edge_test<S>(cu, e, &(t.m_p[3]), &(t.m_p[6]), tol);
 	if(temp_z > z)z = temp_z;
-	temp_z = DropCutter::EdgeTest(cu, e, &(t.m_p[6]), &(t.m_p[0]));
+	temp_z = edge_test<S>(cu, e, &(t.m_p[6]), &(t.m_p[0]), tol);
 	if(temp_z > z)z = temp_z;
-	temp_z = DropCutter::VertexTest(cu, e, &(t.m_p[0]));
+	temp_z = vertex_test<S>(cu, e, &(t.m_p[0]), tol);
 	if(temp_z > z)z = temp_z;
-	temp_z = DropCutter::VertexTest(cu, e, &(t.m_p[3]));
+	temp_z = vertex_test<S>(cu, e, &(t.m_p[3]), tol);
 	if(temp_z > z)z = temp_z;
-	temp_z = DropCutter::VertexTest(cu, e, &(t.m_p[6]));
+	temp_z = vertex_test<S>(cu, e, &(t.m_p[6]), tol);
 	if(temp_z > z)z = temp_z;
 
 	return z;
 }
 
-double DropCutter::TriTest(const Cutter &cu, const double *e, const std::list<GTri> &tri_list, double minz)
+double DropCutter::TriTest(const Cutter &cu, const double *e, const GTri &t, double minz)
+{
+	double tol = DropCutter::Tolerance();
+	switch(cu.Shape(tol))
+	{
+	case Cutter::eFlat:
+		return tri_test<Cutter::eFlat>(cu, e, t, minz, tol);
+	case Cutter::eBall:
+		return tri_test<Cutter::eBall>(cu, e, t, minz, tol);
+	case Cutter::eCone:
+		return tri_test<Cutter::eCone>(cu, e, t, minz, tol);
+	default:
+		return tri_test<Cutter::eBull>(cu, e, t, minz, tol);
+	}
+}
+
+template<int S> static double tri_list_test(const Cutter &cu, const double *e, const std::list<GTri> &tri_list, double minz, double tol)
 {
 	double z = minz;
 	for(std::list<GTri>::const_iterator It = tri_list.begin(); It != tri_list.end(); It++)
 	{
 		const GTri& tri = *It;
-		double temp_z = TriTest(cu, e, tri, minz);
+		double temp_z = tri_test<S>(cu, e, tri, minz, tol);
 		if(temp_z > z)z = temp_z;
 	}
 
 	return z;
 }
 
+double DropCutter::TriTest(const Cutter &cu, const double *e, const std::list<GTri> &tri_list, double minz)
+{
+	double tol = DropCutter::Tolerance();
+	switch(cu.Shape(tol))
+	{
+	case Cutter::eFlat:
+		return tri_list_test<Cutter::eFlat>(cu, e, tri_list, minz, tol);
+	case Cutter::eBall:
+		return tri_list_test<Cutter::eBall>(cu, e, tri_list, minz, tol);
+	case Cutter::eCone:
+		return tri_list_test<Cutter::eCone>(cu, e, tri_list, minz, tol);
+	default:
+		return tri_list_test<Cutter::eBull>(cu, e, tri_list, minz, tol);
+	}
+}
+
+#ifdef DROPCUTTER_SSE2
+static inline __m128d abs_pd(__m128d x)
+{
+	return _mm_andnot_pd(_mm_set1_pd(-0.0), x);
+}
+
+static inline __m128d select_pd(__m128d mask, __m128d a, __m128d b)
+{
+	// a where mask is set, else b
+	return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+}
+
+static inline __m128d isright_pd(__m128d p1x, __m128d p1y, __m128d p2x, __m128d p2y, __m128d px, __m128d py)
+{
+	// the same sums as DropCutter::isright
+	__m128d t1 = _mm_sub_pd(p2y, p1y);
+	__m128d t2 = _mm_sub_pd(_mm_setzero_pd(), _mm_sub_pd(p2x, p1x));
+	__m128d t = _mm_add_pd(_mm_mul_pd(t1, _mm_sub_pd(px, p1x)), _mm_mul_pd(t2, _mm_sub_pd(py, p1y)));
+	return _mm_cmpgt_pd(t, _mm_set1_pd(0.00000000000001));
+}
+#endif
+
+template<int S> static void vertex_tests(const Cutter &cu, const double *e, const GTriMesh &mesh, int first, int count, double *z, double tol)
+{
+	int i = first;
+
+#ifdef DROPCUTTER_SSE2
+	const __m128d ex = _mm_set1_pd(e[0]);
+	const __m128d ey = _mm_set1_pd(e[1]);
+	const __m128d outside = _mm_set1_pd(cu.R + tol);
+	const __m128d R = _mm_set1_pd(cu.R);
+	const __m128d none = _mm_set1_pd(-10000000.0);
+
+	// cone cutter
+	const __m128d cone_flat = _mm_set1_pd(cu.Rf + tol);
+	const __m128d Rf = _mm_set1_pd(cu.Rf);
+	const __m128d cone_h = _mm_set1_pd(cu.h);
+	const __m128d cone_w = _mm_set1_pd(cu.R - cu.Rf);
+
+	// ball and bull cutters
+	const __m128d flat = _mm_set1_pd(corner_offset<S>(cu) + tol);
+	const __m128d r = _mm_set1_pd(cu.r);
+	const __m128d Rr = _mm_set1_pd(corner_offset<S>(cu));
+	const __m128d r2 = _mm_set1_pd(cu.r * cu.r);
+
+	for(; i + 1 < first + count; i += 2)
+	{
+		__m128d zi = _mm_loadu_pd(&z[i - first]);
+		for(int v = 0; v<3; v++)
+		{
+			__m128d px = _mm_loadu_pd(&mesh.m_p[v*3][i]);
+			__m128d py = _mm_loadu_pd(&mesh.m_p[v*3+1][i]);
+			__m128d pz = _mm_loadu_pd(&mesh.m_p[v*3+2][i]);
+			__m128d dx = _mm_sub_pd(ex, px);
+			__m128d dy = _mm_sub_pd(ey, py);
+			__m128d q = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)));
+			__m128d vz;
+
+			if(S == Cutter::eFlat)
+			{
+				vz = pz;
+			}
+			else if(S == Cutter::eCone)
+			{
+				__m128d qq = _mm_min_pd(q, R);
+				vz = _mm_sub_pd(pz, _mm_div_pd(_mm_mul_pd(_mm_sub_pd(qq, Rf), cone_h), cone_w));
+				vz = select_pd(_mm_cmple_pd(q, cone_flat), pz, vz);
+			}
+			else
+			{
+				// toroidal part
+				__m128d qq = _mm_min_pd(q, R);
+				__m128d d = _mm_sub_pd(qq, Rr);
+				__m128d h2 = _mm_sqrt_pd(_mm_sub_pd(r2, _mm_mul_pd(d, d)));
+				vz = _mm_sub_pd(pz, _mm_sub_pd(r, h2));
+				vz = select_pd(_mm_cmple_pd(q, flat), pz, vz);
+			}
+
+			vz = select_pd(_mm_cmpgt_pd(q, outside), none, vz);
+			zi = _mm_max_pd(vz, zi);
+		}
+		_mm_storeu_pd(&z[i - first], zi);
+	}
+#endif
+
+	for(; i < first + count; i++)
+	{
+		for(int v = 0; v<3; v++)
+		{
+			double p[3] = {mesh.m_p[v*3][i], mesh.m_p[v*3+1][i], mesh.m_p[v*3+2][i]};
+			double temp_z = vertex_test<S>(cu, e, p, tol);
+			if(temp_z > z[i - first])z[i - first] = temp_z;
+		}
+	}
+}
+
+template<int S> static void facet_tests(const Cutter &cu, const double *e, const GTriMesh &mesh, int first, int count, double *z, double tol)
+{
+	int i = first;
+
+#ifdef DROPCUTTER_SSE2
+	if(S != Cutter::eCone)
+	{
+		const __m128d ex = _mm_set1_pd(e[0]);
+		const __m128d ey = _mm_set1_pd(e[1]);
+		const __m128d tol2 = _mm_set1_pd(tol);
+		const __m128d vertical = _mm_set1_pd(0.000000000001);
+		const __m128d Rr = _mm_set1_pd(corner_offset<S>(cu));
+		const __m128d r = _mm_set1_pd(cu.r);
+		const __m128d none = _mm_set1_pd(-10000000.0);
+
+		for(; i + 1 < first + count; i += 2)
+		{
+			__m128d a = _mm_loadu_pd(&mesh.m_n[0][i]);
+			__m128d b = _mm_loadu_pd(&mesh.m_n[1][i]);
+			__m128d c = _mm_loadu_pd(&mesh.m_n[2][i]);
+
+			__m128d zdir = _mm_and_pd(_mm_cmplt_pd(abs_pd(a), tol2), _mm_cmplt_pd(abs_pd(b), tol2));
+
+			// general case
+			__m128d zf = _mm_sub_pd(_mm_loadu_pd(&mesh.m_neg_d_over_c[i]), _mm_div_pd(_mm_add_pd(_mm_mul_pd(a, ex), _mm_mul_pd(b, ey)), c));
+			zf = _mm_add_pd(zf, _mm_div_pd(Rr, _mm_loadu_pd(&mesh.m_tan_theta[i])));
+			zf = _mm_add_pd(zf, _mm_div_pd(r, _mm_loadu_pd(&mesh.m_sin_theta[i])));
+			zf = _mm_sub_pd(zf, r);
+			__m128d k = _mm_add_pd(_mm_div_pd(Rr, _mm_loadu_pd(&mesh.m_cos_theta[i])), r);
+			__m128d ccx = select_pd(zdir, ex, _mm_sub_pd(ex, _mm_mul_pd(k, a)));
+			__m128d ccy = select_pd(zdir, ey, _mm_sub_pd(ey, _mm_mul_pd(k, b)));
+			zf = select_pd(zdir, _mm_loadu_pd(&mesh.m_p[2][i]), zf);
+
+			__m128d p1x = _mm_loadu_pd(&mesh.m_p[0][i]);
+			__m128d p1y = _mm_loadu_pd(&mesh.m_p[1][i]);
+			__m128d p2x = _mm_loadu_pd(&mesh.m_p[3][i]);
+			__m128d p2y = _mm_loadu_pd(&mesh.m_p[4][i]);
+			__m128d p3x = _mm_loadu_pd(&mesh.m_p[6][i]);
+			__m128d p3y = _mm_loadu_pd(&mesh.m_p[7][i]);
+			__m128d b1 = isright_pd(p1x, p1y, p2x, p2y, ccx, ccy);
+			__m128d b2 = isright_pd(p3x, p3y, p1x, p1y, ccx, ccy);
+			__m128d b3 = isright_pd(p2x, p2y, p3x, p3y, ccx, ccy);
+			__m128d all_right = _mm_and_pd(_mm_and_pd(b1, b2), b3);
+			__m128d all_left = _mm_andnot_pd(_mm_or_pd(_mm_or_pd(b1, b2), b3), _mm_castsi128_pd(_mm_set1_epi32(-1)));
+			__m128d inside = _mm_andnot_pd(_mm_cmplt_pd(abs_pd(c), vertical), _mm_or_pd(all_right, all_left));
+
+			__m128d fz = select_pd(inside, zf, none);
+			_mm_storeu_pd(&z[i - first], _mm_max_pd(fz, _mm_loadu_pd(&z[i - first])));
+		}
+	}
+#endif
+
+	for(; i < first + count; i++)
+	{
+		double temp_z = facet_test<S>(cu, e, mesh, i, tol);
+		if(temp_z > z[i - first])z[i - first] = temp_z;
+	}
+}
+
+template<int S> static void edge_tests(const Cutter &cu, const double *e, const GTriMesh &mesh, int first, int count, double *z, double tol)
+{
+	for(int i = first; i < first + count; i++)
+	{
+		double p1[3] = {mesh.m_edge_p[0][i], mesh.m_edge_p[1][i], mesh.m_edge_p[2][i]};
+		double p2[3] = {mesh.m_edge_p[3][i], mesh.m_edge_p[4][i], mesh.m_edge_p[5][i]};
+		double temp_z = edge_test<S>(cu, e, p1, p2, mesh.m_edge_u[0][i], mesh.m_edge_u[1][i], mesh.m_edge_length[i], tol);
+		if(temp_z > z[i - first])z[i - first] = temp_z;
+	}
+}
+
+void DropCutter::VertexTests(const Cutter &cu, const double *e, const GTriMesh &mesh, int first, int count, double *z)
+{
+	double tol = DropCutter::Tolerance();
+	switch(cu.Shape(tol))
+	{
+	case Cutter::eFlat:
+		vertex_tests<Cutter::eFlat>(cu, e, mesh, first, count, z, tol);
+		break;
+	case Cutter::eBall:
+		vertex_tests<Cutter::eBall>(cu, e, mesh, first, count, z, tol);
+		break;
+	case Cutter::eCone:
+		vertex_tests<Cutter::eCone>(cu, e, mesh, first, count, z, tol);
+		break;
+	default:
+		vertex_tests<Cutter::eBull>(cu, e, mesh, first, count, z, tol);
+		break;
+	}
+}
+
+void DropCutter::FacetTests(const Cutter &cu, const double *e, const GTriMesh &mesh, int first, int count, double *z)
+{
+	double tol = DropCutter::Tolerance();
+	switch(cu.Shape(tol))
+	{
+	case Cutter::eFlat:
+		facet_tests<Cutter::eFlat>(cu, e, mesh, first, count, z, tol);
+		break;
+	case Cutter::eBall:
+		facet_tests<Cutter::eBall>(cu, e, mesh, first, count, z, tol);
+		break;
+	case Cutter::eCone:
+		facet_tests<Cutter::eCone>(cu, e, mesh, first, count, z, tol);
+		break;
+	default:
+		facet_tests<Cutter::eBull>(cu, e, mesh, first, count, z, tol);
+		break;
+	}
+}
+
+void DropCutter::EdgeTests(const Cutter &cu, const double *e, const GTriMesh &mesh, int first, int count, double *z)
+{
+	double tol = DropCutter::Tolerance();
+	switch(cu.Shape(tol))
+	{
+	case Cutter::eFlat:
+		edge_tests<Cutter::eFlat>(cu, e, mesh, first, count, z, tol);
+		break;
+	case Cutter::eBall:
+		edge_tests<Cutter::eBall>(cu, e, mesh, first, count, z, tol);
+		break;
+	case Cutter::eCone:
+		edge_tests<Cutter::eCone>(cu, e, mesh, first, count, z, tol);
+		break;
+	default:
+		edge_tests<Cutter::eBull>(cu, e, mesh, first, count, z, tol);
+		break;
+	}
+}
+
+// how far the cutter's tip is below the height where it touches something at distance q from its axis
+// q should be no more than the real distance, so the answer is never more than the real amount
+template<int S> static double profile_height(const Cutter &cu, double q, double tol)
+{
+	if(S == Cutter::eFlat)return 0.0;
+
+	q -= tol; // the tests allow this much
+	if(S == Cutter::eCone)return (q <= 0.0) ? 0.0 : cone_profile(cu, q);
+
+	double Rr = corner_offset<S>(cu);
+	if(q <= Rr)return 0.0;
+	if(q > cu.R)q = cu.R;
+	return cu.r - sqrt(cu.r * cu.r - (q - Rr) * (q - Rr));
+}
+
+// the highest the cutter could get from a node's triangles; their highest point, lowered by the cutter's shape at the nearest point of the node's box
+// this works for the nodes of a GTriMesh or a CompactMesh
+template<int S, class N> static double node_bound(const Cutter &cu, const double *e, const N &node, double tol)
+{
+	double max_z = node.m_max_z + node.m_max_slope * tol;
+	if(S == Cutter::eFlat)return max_z;
+
+	double dx = 0.0, dy = 0.0;
+	if(e[0] < node.m_box[0])dx = node.m_box[0] - e[0];
+	else if(e[0] > node.m_box[2])dx = e[0] - node.m_box[2];
+	if(e[1] < node.m_box[1])dy = node.m_box[1] - e[1];
+	else if(e[1] > node.m_box[3])dy = e[1] - node.m_box[3];
+	return max_z - profile_height<S>(cu, sqrt(dx * dx + dy * dy), tol);
+}
+
+// working space for the drops, so each worker only allocates it once
+class DropScratch
+{
+public:
+	std::vector< std::pair<double, int> > m_heap;
+	GTriMesh m_tile; // the triangles of a CompactMesh's tile, with their normals and edges worked out
+	double m_p[CompactMesh::max_triangles_in_leaf * 9];
+};
+
+// tests triangles first to first + count - 1, and edges first_edge to first_edge + edge_count - 1, of mesh, raising z to any height found
+// triangles and edges whose boxes don't overlap box are left out
+template<int S> static void test_triangles_and_edges(const Cutter &cu, const double *e, const GTriMesh &mesh, int first, int count, int first_edge, int edge_count, const double *box, double minz, double tol, double &z)
+{
+	// a CompactMesh's tiles are bigger than a GTriMesh's leaves
+	double tri_z[CompactMesh::max_triangles_in_leaf];
+	double edge_z[CompactMesh::max_triangles_in_leaf * 3];
+
+	for(int i = 0; i<count; i++)tri_z[i] = minz;
+
+	facet_tests<S>(cu, e, mesh, first, count, tri_z, tol);
+	vertex_tests<S>(cu, e, mesh, first, count, tri_z, tol);
+
+	for(int i = 0; i<count; i++)
+	{
+		if(tri_z[i] > z && mesh.TriangleOverlaps(first + i, box))z = tri_z[i];
+	}
+
+	for(int i = 0; i<edge_count; i++)edge_z[i] = minz;
+
+	edge_tests<S>(cu, e, mesh, first_edge, edge_count, edge_z, tol);
+
+	for(int i = 0; i<edge_count; i++)
+	{
+		if(edge_z[i] > z && mesh.EdgeOverlaps(first_edge + i, box))z = edge_z[i];
+	}
+}
+
+template<int S> class LeafTester
+{
+	const Cutter &m_cu;
+	const double *m_e;
+	const GTriMesh &m_mesh;
+	const double *m_box;
+	double m_minz;
+	double m_tol;
+public:
+	double m_z;
+	LeafTester(const Cutter &cu, const double *e, const GTriMesh &mesh, const double *box, double minz, double tol):m_cu(cu), m_e(e), m_mesh(mesh), m_box(box), m_minz(minz), m_tol(tol), m_z(minz){}
+
+	double Bound(const GTriMesh::Node &node)const{return node_bound<S>(m_cu, m_e, node, m_tol);}
+
+	double Best()const{return m_z;}
+
+	void operator()(const GTriMesh::Node &node)
+	{
+		// each edge is only kept in one leaf, so it is only tested once, even if two triangles share it
+		test_triangles_and_edges<S>(m_cu, m_e, m_mesh, node.m_first, node.m_count, node.m_first_edge, node.m_edge_count, m_box, m_minz, m_tol, m_z);
+	}
+};
+
+template<int S> class CompactLeafTester
+{
+	const Cutter &m_cu;
+	const double *m_e;
+	const CompactMesh &m_mesh;
+	const double *m_box;
+	double m_minz;
+	double m_tol;
+	DropScratch &m_scratch;
+public:
+	double m_z;
+	CompactLeafTester(const Cutter &cu, const double *e, const CompactMesh &mesh, const double *box, double minz, double tol, DropScratch &scratch):m_cu(cu), m_e(e), m_mesh(mesh), m_box(box), m_minz(minz), m_tol(tol), m_scratch(scratch), m_z(minz){}
+
+	double Bound(const CompactMesh::Node &node)const{return node_bound<S>(m_cu, m_e, node, m_tol);}
+
+	double Best()const{return m_z;}
+
+	void operator()(const CompactMesh::Node &node)
+	{
+		// put the tile's triangles under the cutter into a little GTriMesh, and test them the same way
+		// an edge shared with a triangle in another tile gets tested twice, which doesn't change the answer
+		int count = m_mesh.GetTriangles(node, m_box, m_scratch.m_p);
+		if(count == 0)return;
+		m_scratch.m_tile.Set(m_scratch.m_p, count);
+		test_triangles_and_edges<S>(m_cu, m_e, m_scratch.m_tile, 0, count, 0, m_scratch.m_tile.NumEdges(), m_box, m_minz, m_tol, m_z);
+	}
+};
+
+// the cutter's footprint
+static void footprint(const Cutter &cu, const double *e, double *box)
+{
+	box[0] = e[0] - cu.R;
+	box[1] = e[1] - cu.R;
+	box[2] = e[0] + cu.R;
+	box[3] = e[1] + cu.R;
+}
+
+template<int S> static double mesh_test(const Cutter &cu, const double *e, const GTriMesh &mesh, double minz, double tol, DropScratch &scratch)
+{
+	double box[4];
+	footprint(cu, e, box);
+
+	// highest nodes first, so that once the cutter is sitting on something, the lower nodes can be left out
+	LeafTester<S> tester(cu, e, mesh, box, minz, tol);
+	mesh.VisitLeavesBestFirst(box, tester, scratch.m_heap);
+
+	return tester.m_z;
+}
+
+template<int S> static double mesh_test(const Cutter &cu, const double *e, const CompactMesh &mesh, double minz, double tol, DropScratch &scratch)
+{
+	double box[4];
+	footprint(cu, e, box);
+
+	CompactLeafTester<S> tester(cu, e, mesh, box, minz, tol, scratch);
+	mesh.VisitLeavesBestFirst(box, tester, scratch.m_heap);
+
+	return tester.m_z;
+}
+
+template<class Mesh> static double tri_test(const Cutter &cu, const double *e, const Mesh &mesh, double minz)
+{
+	double tol = DropCutter::Tolerance();
+	DropScratch scratch;
+	switch(cu.Shape(tol))
+	{
+	case Cutter::eFlat:
+		return mesh_test<Cutter::eFlat>(cu, e, mesh, minz, tol, scratch);
+	case Cutter::eBall:
+		return mesh_test<Cutter::eBall>(cu, e, mesh, minz, tol, scratch);
+	case Cutter::eCone:
+		return mesh_test<Cutter::eCone>(cu, e, mesh, minz, tol, scratch);
+	default:
+		return mesh_test<Cutter::eBull>(cu, e, mesh, minz, tol, scratch);
+	}
+}
+
+double DropCutter::TriTest(const Cutter &cu, const double *e, const GTriMesh &mesh, double minz)
+{
+	return tri_test(cu, e, mesh, minz);
+}
+
+double DropCutter::TriTest(const Cutter &cu, const double *e, const CompactMesh &mesh, double minz)
+{
+	return tri_test(cu, e, mesh, minz);
+}
+
+// how many points each worker takes at a time
+static const int drop_chunk_size = 64;
+
+template<int S, class Mesh> class DropPointsTask: public ParallelTask
+{
+	const Cutter &m_cu;
+	const Mesh &m_mesh;
+	const double *m_xy;
+	double m_minz;
+	double *m_z;
+	double m_tol;
+public:
+	DropPointsTask(const Cutter &cu, const Mesh &mesh, const double *xy, double minz, double *z, double tol):m_cu(cu), m_mesh(mesh), m_xy(xy), m_minz(minz), m_z(z), m_tol(tol){}
+	void Run(int first, int count)
+	{
+		DropScratch scratch;
+		for(int i = first; i < first + count; i++)
+		{
+			double e[3] = {m_xy[i*2], m_xy[i*2+1], 0.0};
+			m_z[i] = mesh_test<S>(m_cu, e, m_mesh, m_minz, m_tol, scratch);
+		}
+	}
+};
+
+template<int S, class Mesh> class DropGridTask: public ParallelTask
+{
+	const Cutter &m_cu;
+	const Mesh &m_mesh;
+	double m_x0, m_y0, m_dx, m_dy;
+	int m_nx;
+	double m_minz;
+	double *m_z;
+	double m_tol;
+public:
+	DropGridTask(const Cutter &cu, const Mesh &mesh, double x0, double y0, double dx, double dy, int nx, double minz, double *z, double tol):m_cu(cu), m_mesh(mesh), m_x0(x0), m_y0(y0), m_dx(dx), m_dy(dy), m_nx(nx), m_minz(minz), m_z(z), m_tol(tol){}
+	void Run(int first, int count)
+	{
+		DropScratch scratch;
+		for(int k = first; k < first + count; k++)
+		{
+			int i = k % m_nx;
+			int j = k / m_nx;
+			double e[3] = {m_x0 + i * m_dx, m_y0 + j * m_dy, 0.0};
+			m_z[k] = mesh_test<S>(m_cu, e, m_mesh, m_minz, m_tol, scratch);
+		}
+	}
+};
+
+template<int S, class Mesh> static void drop_points(const Cutter &cu, const Mesh &mesh, const double *xy, int n, double minz, double *z, double tol)
+{
+	DropPointsTask<S, Mesh> task(cu, mesh, xy, minz, z, tol);
+	ThreadPool::Get().Run(task, n, drop_chunk_size);
+}
+
+template<int S, class Mesh> static void drop_grid(const Cutter &cu, const Mesh &mesh, double x0, double y0, double dx, double dy, int nx, int ny, double minz, double *z, double tol)
+{
+	DropGridTask<S, Mesh> task(cu, mesh, x0, y0, dx, dy, nx, minz, z, tol);
+	ThreadPool::Get().Run(task, nx * ny, drop_chunk_size);
+}
+
+template<class Mesh> static void drop_points_any_shape(const Cutter &cu, const Mesh &mesh, const double *xy, int n, double minz, double *z)
+{
+	double tol = DropCutter::Tolerance();
+	switch(cu.Shape(tol))
+	{
+	case Cutter::eFlat:
+		drop_points<Cutter::eFlat>(cu, mesh, xy, n, minz, z, tol);
+		break;
+	case Cutter::eBall:
+		drop_points<Cutter::eBall>(cu, mesh, xy, n, minz, z, tol);
+		break;
+	case Cutter::eCone:
+		drop_points<Cutter::eCone>(cu, mesh, xy, n, minz, z, tol);
+		break;
+	default:
+		drop_points<Cutter::eBull>(cu, mesh, xy, n, minz, z, tol);
+		break;
+	}
+}
+
+template<class Mesh> static void drop_grid_any_shape(const Cutter &cu, const Mesh &mesh, double x0, double y0, double dx, double dy, int nx, int ny, double minz, double *z)
+{
+	if(nx <= 0 || ny <= 0)return;
+
+	double tol = DropCutter::Tolerance();
+	switch(cu.Shape(tol))
+	{
+	case Cutter::eFlat:
+		drop_grid<Cutter::eFlat>(cu, mesh, x0, y0, dx, dy, nx, ny, minz, z, tol);
+		break;
+	case Cutter::eBall:
+		drop_grid<Cutter::eBall>(cu, mesh, x0, y0, dx, dy, nx, ny, minz, z, tol);
+		break;
+	case Cutter::eCone:
+		drop_grid<Cutter::eCone>(cu, mesh, x0, y0, dx, dy, nx, ny, minz, z, tol);
+		break;
+	default:
+		drop_grid<Cutter::eBull>(cu, mesh, x0, y0, dx, dy, nx, ny, minz, z, tol);
+		break;
+	}
+}
+
+void DropCutter::DropPoints(const Cutter &cu, const GTriMesh &mesh, const double *xy, int n, double minz, double *z)
+{
+	drop_points_any_shape(cu, mesh, xy, n, minz, z);
+}
+
+void DropCutter::DropPoints(const Cutter &cu, const CompactMesh &mesh, const double *xy, int n, double minz, double *z)
+{
+	drop_points_any_shape(cu, mesh, xy, n, minz, z);
+}
+
+void DropCutter::DropGrid(const Cutter &cu, const GTriMesh &mesh, double x0, double y0, double dx, double dy, int nx, int ny, double minz, double *z)
+{
+	drop_grid_any_shape(cu, mesh, x0, y0, dx, dy, nx, ny, minz, z);
+}
+
+void DropCutter::DropGrid(const Cutter &cu, const CompactMesh &mesh, double x0, double y0, double dx, double dy, int nx, int ny, double minz, double *z)
+{
+	drop_grid_any_shape(cu, mesh, x0, y0, dx, dy, nx, ny, minz, z);
+}
+
+// a point of a path being refined; the points are a linked list, so points can be put in the middle of a span without moving the others
+class PathPoint
+{
+public:
+	double m_p[3];
+	int m_next; // -1 for the last point of its path
+	int m_path; // which path it is on, for DropCutter::DropPaths
+};
+
+// the distance from p to the line from p0 to p1
+static double distance_to_line(const double *p0, const double *p1, const double *p)
+{
+	double v[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+	double w[3] = {p[0] - p0[0], p[1] - p0[1], p[2] - p0[2]};
+	double vv = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+	double t = (vv > 0.0) ? (v[0] * w[0] + v[1] * w[1] + v[2] * w[2]) / vv : 0.0;
+	if(t < 0.0)t = 0.0;
+	if(t > 1.0)t = 1.0;
+	double d[3] = {w[0] - v[0] * t, w[1] - v[1] * t, w[2] - v[2] * t};
+	return sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+}
+
+int DropCutter::DropPath(PointDropper &dropper, const double *xy, int n, double max_step, double min_step, double tolerance, std::vector<double> &result)
+{
+	std::vector<int> result_sizes;
+	return DropPaths(dropper, xy, &n, 1, NULL, max_step, min_step, tolerance, result, result_sizes);
+}
+
+// drops a batch of points, raising each one to the floor of the path it is on
+static void drop_on_paths(PointDropper &dropper, const double *xy, int n, const std::vector<int> &point_paths, const double *floors, double *z)
+{
+	if(n == 0)return;
+	dropper.Drop(xy, n, z);
+	if(floors == NULL)return;
+	for(int i = 0; i<n; i++)
+	{
+		double floor = floors[point_paths[i]];
+		if(z[i] < floor)z[i] = floor;
+	}
+}
+
+int DropCutter::DropPaths(PointDropper &dropper, const double *xy, const int *sizes, int num_paths, const double *floors, double max_step, double min_step, double tolerance, std::vector<double> &result, std::vector<int> &result_sizes)
+{
+	if(max_step <= 0.0)max_step = 1.0;
+	if(min_step <= 0.0 || min_step > max_step)min_step = max_step;
+
+	// sample each span no more than max_step apart
+	std::vector<double> sample_xy;
+	std::vector<int> sample_paths;
+	std::vector<int> path_first(num_paths, -1); // the first sample of each path, -1 for a path with no points
+	for(int path = 0; path < num_paths; xy += sizes[path] * 2, path++)
+	{
+		int n = sizes[path];
+		if(n <= 0)continue;
+		path_first[path] = (int)sample_paths.size();
+		sample_xy.push_back(xy[0]);
+		sample_xy.push_back(xy[1]);
+		sample_paths.push_back(path);
+		for(int i = 1; i<n; i++)
+		{
+			double dx = xy[i * 2] - xy[i * 2 - 2];
+			double dy = xy[i * 2 + 1] - xy[i * 2 - 1];
+			double length = sqrt(dx * dx + dy * dy);
+			if(length <= 0.0)continue;
+			int steps = (int)ceil(length / max_step);
+			for(int j = 1; j <= steps; j++)
+			{
+				sample_xy.push_back(xy[i * 2 - 2] + dx * j / steps);
+				sample_xy.push_back(xy[i * 2 - 1] + dy * j / steps);
+				sample_paths.push_back(path);
+			}
+		}
+	}
+
+	int num_samples = (int)sample_paths.size();
+	std::vector<double> sample_z(num_samples);
+	if(num_samples > 0)drop_on_paths(dropper, &sample_xy[0], num_samples, sample_paths, floors, &sample_z[0]);
+	int num_drops = num_samples;
+
+	std::vector<PathPoint> points(num_samples);
+	std::vector<int> spans; // the first point of each span still to be checked
+	for(int i = 0; i<num_samples; i++)
+	{
+		bool last = (i + 1 == num_samples || sample_paths[i + 1] != sample_paths[i]);
+		points[i].m_p[0] = sample_xy[i * 2];
+		points[i].m_p[1] = sample_xy[i * 2 + 1];
+		points[i].m_p[2] = sample_z[i];
+		points[i].m_next = last ? -1 : i + 1;
+		points[i].m_path = sample_paths[i];
+		if(!last)spans.push_back(i);
+	}
+
+	// halve the spans whose middles aren't on the straight line, a round at a time, so each round is one batch of drops
+	double min_length = min_step * 2;
+	std::vector<double> mid_xy;
+	std::vector<double> mid_z;
+	std::vector<int> mid_paths;
+	std::vector<int> next_spans;
+	while(spans.size() > 0)
+	{
+		mid_xy.clear();
+		mid_paths.clear();
+		next_spans.clear();
+		for(std::vector<int>::iterator It = spans.begin(); It != spans.end(); It++)
+		{
+			const double* p0 = points[*It].m_p;
+			const double* p1 = points[points[*It].m_next].m_p;
+			double dx = p1[0] - p0[0];
+			double dy = p1[1] - p0[1];
+			if(dx * dx + dy * dy < min_length * min_length)continue; // too short to halve
+			next_spans.push_back(*It);
+			mid_xy.push_back((p0[0] + p1[0]) * 0.5);
+			mid_xy.push_back((p0[1] + p1[1]) * 0.5);
+			mid_paths.push_back(points[*It].m_path);
+		}
+		if(next_spans.size() == 0)break;
+
+		int num_mids = (int)next_spans.size();
+		mid_z.resize(num_mids);
+		drop_on_paths(dropper, &mid_xy[0], num_mids, mid_paths, floors, &mid_z[0]);
+		num_drops += num_mids;
+
+		spans.clear();
+		for(int i = 0; i<num_mids; i++)
+		{
+			int first = next_spans[i];
+			int next = points[first].m_next;
+			double line_z = (points[first].m_p[2] + points[next].m_p[2]) * 0.5;
+
+			// the middle is kept even if the span is straight enough, so that leaving points out below can't go far from it
+			PathPoint mid;
+			mid.m_p[0] = mid_xy[i * 2];
+			mid.m_p[1] = mid_xy[i * 2 + 1];
+			mid.m_p[2] = mid_z[i];
+			mid.m_next = next;
+			mid.m_path = points[first].m_path;
+			int m = (int)points.size();
+			points.push_back(mid);
+			points[first].m_next = m;
+
+			if(fabs(mid_z[i] - line_z) <= tolerance)continue; // straight enough
+			spans.push_back(first);
+			spans.push_back(m);
+		}
+	}
+
+	// leave out points which are within tolerance of the line from the last point kept to the next point
+	// checking all the points left out since the last one kept
+	result_sizes.resize(num_paths);
+	std::vector<int> left_out;
+	for(int path = 0; path < num_paths; path++)
+	{
+		result_sizes[path] = 0;
+		int first = path_first[path];
+		if(first == -1)continue;
+
+		int last_kept = first;
+		result.insert(result.end(), points[first].m_p, points[first].m_p + 3);
+		result_sizes[path]++;
+		left_out.clear();
+		int last = first;
+		for(int i = points[first].m_next; i != -1; i = points[i].m_next)
+		{
+			last = i;
+			int next = points[i].m_next;
+			if(next == -1)break;
+
+			bool in_line = true;
+			left_out.push_back(i);
+			for(std::vector<int>::iterator It = left_out.begin(); It != left_out.end(); It++)
+			{
+				if(distance_to_line(points[last_kept].m_p, points[next].m_p, points[*It].m_p) > tolerance)
+				{
+					in_line = false;
+					break;
+				}
+			}
+
+			if(!in_line)
+			{
+				result.insert(result.end(), points[i].m_p, points[i].m_p + 3);
+				result_sizes[path]++;
+				last_kept = i;
+				left_out.clear();
+			}
+		}
+		if(last != first)
+		{
+			result.insert(result.end(), points[last].m_p, points[last].m_p + 3);
+			result_sizes[path]++;
+		}
+	}
+
+	return num_drops;
+}
+
+template<class Mesh> class MeshPointDropper: public PointDropper
+{
+	const Cutter &m_cu;
+	const Mesh &m_mesh;
+	double m_minz;
+public:
+	MeshPointDropper(const Cutter &cu, const Mesh &mesh, double minz):m_cu(cu), m_mesh(mesh), m_minz(minz){}
+	void Drop(const double *xy, int n, double *z)
+	{
+		DropCutter::DropPoints(m_cu, m_mesh, xy, n, m_minz, z);
+	}
+};
+
+int DropCutter::DropPath(const Cutter &cu, const GTriMesh &mesh, const double *xy, int n, double minz, double max_step, double min_step, double tolerance, std::vector<double> &result)
+{
+	MeshPointDropper<GTriMesh> dropper(cu, mesh, minz);
+	return DropPath(dropper, xy, n, max_step, min_step, tolerance, result);
+}
+
+int DropCutter::DropPath(const Cutter &cu, const CompactMesh &mesh, const double *xy, int n, double minz, double max_step, double min_step, double tolerance, std::vector<double> &result)
+{
+	MeshPointDropper<CompactMesh> dropper(cu, mesh, minz);
+	return DropPath(dropper, xy, n, max_step, min_step, tolerance, result);
+}
@@ -17,14 +17,77 @@
 // Anders Wallin said:
 // yes, you are free to release this under the BSD license if you want. As someone pointed out on my blog the edge-test for the toroidal cutter is wrong, or at least only an approximation to the exact geometry
 
+#include <string>
+#include <vector>
+
 class Cutter{
 public:
+	typedef enum {
+		eFlat = 0,
+		eBall,
+		eBull,
+		eCone
+	} eShape;
+
 	double R; // shaft radius
     double r; // corner radius
+	double Rf; // radius of the flat bottom of a cone cutter
+	double h; // height of a cone cutter's cone, from the flat bottom up to radius R
+	bool m_cone;
+
     Cutter(double Rset, double rset);
+	Cutter(double Rset, double flat_radius, double half_angle); // cone cutter, for chamfer and engraving tools. half_angle is in radians, from the axis
+
+	// which set of tests to use. this is decided once for a batch of tests, not for every triangle
+	eShape Shape(double tol)const;
+};
+
+// the errors found by the tests, counted instead of being shown straight away, so the tests can run in worker threads
+// call Reset before a batch of tests, and Report after it, to show the user what went wrong
+class DropCutterDiagnostics
+{
+public:
+	typedef enum {
+		eCutterRadius = 0, // R <= 0
+		eCutterCornerRadius, // r < 0 or r > R
+		eCutterFlatRadius, // cone cutter's flat radius < 0 or > R
+		eCutterAngle, // cone cutter's angle not between 0 and 90 degrees
+		eFacetNotInPlane, // FacetTest's contact point is not in the plane of the triangle
+		eFacetTooHigh, // FacetTest's height is more than 100000
+		eEdgeNoCase, // EdgeTest didn't find a case for the cutter
+		eTilePadding, // the cutter is wider than the padding of a TiledMesh's tiles
+		eNumErrors
+	} eError;
+
+	static const int max_samples = 4; // the inputs of the first few errors of each type are kept
+	static const int max_sample_values = 8;
+
+	// counts an error, and keeps values as a sample if there aren't max_samples already; safe to call from any thread
+	static void Record(eError error, const double *values, int num_values);
+
+	static long Count(eError error);
+	static long TotalCount();
+	static void Reset();
+
+	// a summary of the errors since Reset, with the samples, or an empty string if there weren't any
+	static std::string Report();
+
+	static const char* Description(eError error);
 };
 
 class GTri;
+class GTriMesh;
+class CompactMesh;
+
+// something to drop the cutter at a batch of points, for DropCutter::DropPath
+class PointDropper
+{
+public:
+	virtual ~PointDropper(){}
+
+	// xy has x0 y0 x1 y1 ... and z gets the n heights
+	virtual void Drop(const double *xy, int n, double *z) = 0;
+};
 
 class DropCutter
 {
@@ -40,5 +103,50 @@ public:
 
 	// This one does TriTest for a whole load of triangles
     static double TriTest(const Cutter &cu, const double *e, const std::list<GTri> &tri_list, double minz);
+
+	// batch versions of the tests above, for triangles first to first + count - 1 of a mesh
+	// each one raises z[i - first] to the height found for triangle i, if that is higher
+	// the vertex and facet tests do two triangles at a time with SSE2, if it is available
+	static void VertexTests(const Cutter &cu, const double *e, const GTriMesh &mesh, int first, int count, double *z);
+	static void FacetTests(const Cutter &cu, const double *e, const GTriMesh &mesh, int first, int count, double *z);
+
+	// this one is for edges first to first + count - 1 of the mesh's edges, not for triangles
+	static void EdgeTests(const Cutter &cu, const double *e, const GTriMesh &mesh, int first, int count, double *z);
+
+	// This one only tests the triangles of the mesh which are under the cutter
+    static double TriTest(const Cutter &cu, const double *e, const GTriMesh &mesh, double minz);
+    static double TriTest(const Cutter &cu, const double *e, const CompactMesh &mesh, double minz);
+
+	// drop the cutter at n points, xy has x0 y0 x1 y1 ... and z gets the n heights
+	// the points are shared out between the cores; each height only depends on its own point, so the results are the same every time
+	static void DropPoints(const Cutter &cu, const GTriMesh &mesh, const double *xy, int n, double minz, double *z);
+	static void DropPoints(const Cutter &cu, const CompactMesh &mesh, const double *xy, int n, double minz, double *z);
+
+	// drop the cutter on a grid of nx by ny points, starting at x0 y0, with spacing dx dy
+	// z gets the heights, row by row, z[j * nx + i] is at x0 + i * dx, y0 + j * dy
+	static void DropGrid(const Cutter &cu, const GTriMesh &mesh, double x0, double y0, double dx, double dy, int nx, int ny, double minz, double *z);
+	static void DropGrid(const Cutter &cu, const CompactMesh &mesh, double x0, double y0, double dx, double dy, int nx, int ny, double minz, double *z);
+
+	// drop the cutter along a path of n points, xy has x0 y0 x1 y1 ..., adding the cutter locations to result, as x y z for each one
+	// the spans are sampled no more than max_step apart, then halved wherever the height dropped at the middle is more than
+	// tolerance from the straight line between the ends, down to spans of min_step; then points in line with their neighbours are left out
+	// so flat areas only take a few drops, and result is already simplified
+	// the drops are done in batches, one for the first samples and one for each round of halving
+	// returns the number of points dropped
+	static int DropPath(PointDropper &dropper, const double *xy, int n, double max_step, double min_step, double tolerance, std::vector<double> &result);
+	static int DropPath(const Cutter &cu, const GTriMesh &mesh, const double *xy, int n, double minz, double max_step, double min_step, double tolerance, std::vector<double> &result);
+	static int DropPath(const Cutter &cu, const CompactMesh &mesh, const double *xy, int n, double minz, double max_step, double min_step, double tolerance, std::vector<double> &result);
+
+	// DropPath for num_paths paths at once, sizes[i] is the number of points of path i, and their xy follow on from the previous path's
+	// all the paths' first samples are one batch of drops, and each round of halving is one batch, so lots of short paths still make big batches
+	// floors, if not NULL, has a height for each path, which its heights are raised to, as if the path had its own minz
+	// result gets the paths' points one after the other, and result_sizes gets the number of points of each path
+	static int DropPaths(PointDropper &dropper, const double *xy, const int *sizes, int num_paths, const double *floors, double max_step, double min_step, double tolerance, std::vector<double> &result, std::vector<int> &result_sizes);
+
+	// the tolerance of the tests; HeeksCAD's, or, in the attach library, which has no HeeksCAD, the one given to SetTolerance
+	static double Tolerance();
+#ifdef DROPCUTTER_ONLY
+	static void SetTolerance(double tol);
+#endif
 };
 
@@ -3,6 +3,8 @@
 // triangle used for Anders's DropCutter code
 // written by Dan Heeks starting on May 2nd 2008
 
+#pragma once
+
 class GTri{
 public:
 	double m_p[9]; // three points
@@ -42,6 +44,7 @@ public:
 		if(m_p[7] > m_box[3])m_box[3] = m_p[7];
 	}
 
+#ifndef DROPCUTTER_ONLY
 	static bool box_in_box(double *this_box, double *box){
 		if(this_box[0]<box[0]-heeksCAD->GetTolerance()){
 			// left of tri is left of box
@@ -109,5 +112,6 @@ public:
 			return false;
 		}
 	}
+#endif
 };
 
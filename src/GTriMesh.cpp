@@ -0,0 +1,514 @@
+// GTriMesh.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "stdafx.h"
+#include "GTriMesh.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <set>
+#include <climits>
+
+// the nodes and each column start on this boundary in the block
+static const unsigned long long block_alignment = 4096;
+static const unsigned int file_header_size = 4096;
+
+class TriCentreLess
+{
+	int m_axis;
+public:
+	TriCentreLess(int axis):m_axis(axis){}
+	bool operator()(const GTri* t1, const GTri* t2)const
+	{
+		return t1->m_box[m_axis] + t1->m_box[m_axis + 2] < t2->m_box[m_axis] + t2->m_box[m_axis + 2];
+	}
+};
+
+class TriCollector
+{
+	const GTriMesh &m_mesh;
+	const double *m_box;
+	std::vector<int> &m_result;
+public:
+	TriCollector(const GTriMesh &mesh, const double *box, std::vector<int> &result):m_mesh(mesh), m_box(box), m_result(result){}
+	void operator()(const GTriMesh::Node &node)
+	{
+		for(int i = node.m_first; i < node.m_first + node.m_count; i++)
+		{
+			if(m_mesh.TriangleOverlaps(i, m_box))m_result.push_back(i);
+		}
+	}
+};
+
+class EdgeKey
+{
+public:
+	double m_p[6]; // the lower point first, so the same edge of both of its triangles gives the same key
+
+	EdgeKey(const double *p0, const double *p1)
+	{
+		if(std::lexicographical_compare(p1, p1 + 3, p0, p0 + 3))std::swap(p0, p1);
+		for(int i = 0; i<3; i++){m_p[i] = p0[i]; m_p[i + 3] = p1[i];}
+	}
+
+	bool operator<(const EdgeKey &k)const
+	{
+		return std::lexicographical_compare(m_p, m_p + 6, k.m_p, k.m_p + 6);
+	}
+};
+
+// makes the tree and the columns, before they are copied into the mesh's block
+class GTriMeshBuilder
+{
+public:
+	std::vector<GTriMesh::Node> m_nodes;
+	std::vector<double> m_columns[GTriMesh::eNumColumns];
+
+	GTriMeshBuilder(){}
+	GTriMeshBuilder(const std::list<GTri> &tri_list);
+
+	int NumEdges()const{return (int)m_columns[GTriMesh::eColumnEdgeLength].size();}
+
+	// just the columns for a few triangles, without a tree, keeping the memory from last time
+	void Set(const double *p, int count);
+
+private:
+	void Split(std::vector<const GTri*> &tris, int node_index, int first, int count);
+	void AddTriangle(const GTri &tri);
+	void AddEdge(const double *p0, const double *p1);
+	void AddEdges();
+	bool HasEdge(const double *p0, const double *p1)const;
+};
+
+GTriMeshBuilder::GTriMeshBuilder(const std::list<GTri> &tri_list)
+{
+	if(tri_list.size() == 0)return;
+
+	// build the tree on pointers to the triangles, then copy the triangles in leaf order
+	std::vector<const GTri*> tris;
+	tris.reserve(tri_list.size());
+	for(std::list<GTri>::const_iterator It = tri_list.begin(); It != tri_list.end(); It++)
+	{
+		tris.push_back(&(*It));
+	}
+
+	m_nodes.reserve(2 * (tris.size() / GTriMesh::max_triangles_in_leaf) + 1);
+	m_nodes.push_back(GTriMesh::Node());
+	Split(tris, 0, 0, (int)tris.size());
+
+	for(int i = 0; i<GTriMesh::eColumnEdgeP; i++)m_columns[i].reserve(tris.size());
+
+	for(std::vector<const GTri*>::iterator It = tris.begin(); It != tris.end(); It++)
+	{
+		AddTriangle(**It);
+	}
+
+	AddEdges();
+}
+
+void GTriMeshBuilder::AddTriangle(const GTri &tri)
+{
+	for(int i = 0; i<9; i++)m_columns[GTriMesh::eColumnP + i].push_back(tri.m_p[i]);
+	for(int i = 0; i<4; i++)m_columns[GTriMesh::eColumnBox + i].push_back(tri.m_box[i]);
+
+	// the plane, worked out just as DropCutter::FacetTest does it
+	double n[3] = {tri.m_n[0], tri.m_n[1], tri.m_n[2]};
+	if (fabs(n[2]) >= 0.000000000001 && n[2] < 0)
+	{
+		for(int i = 0; i<3; i++)n[i] = -1*n[i];
+	}
+	for(int i = 0; i<3; i++)m_columns[GTriMesh::eColumnN + i].push_back(n[i]);
+
+	double d = - n[0] * tri.m_p[0] - n[1] * tri.m_p[1] - n[2] * tri.m_p[2];
+	m_columns[GTriMesh::eColumnNegDOverC].push_back(-d/n[2]);
+
+	double theta = asin(n[2]);
+	m_columns[GTriMesh::eColumnTanTheta].push_back(tan(theta));
+	m_columns[GTriMesh::eColumnSinTheta].push_back(sin(theta));
+	m_columns[GTriMesh::eColumnCosTheta].push_back(cos(theta));
+}
+
+void GTriMeshBuilder::AddEdge(const double *p0, const double *p1)
+{
+	// always the lower point first, so that an edge is the same whichever triangle, or tile of a CompactMesh, it was found in
+	// the edge tests' tolerance doesn't work the same both ways along an edge
+	if(std::lexicographical_compare(p1, p1 + 3, p0, p0 + 3))std::swap(p0, p1);
+
+	for(int i = 0; i<3; i++)m_columns[GTriMesh::eColumnEdgeP + i].push_back(p0[i]);
+	for(int i = 0; i<3; i++)m_columns[GTriMesh::eColumnEdgeP + i + 3].push_back(p1[i]);
+
+	double dx = p1[0] - p0[0];
+	double dy = p1[1] - p0[1];
+	double length = sqrt(dx * dx + dy * dy);
+	m_columns[GTriMesh::eColumnEdgeLength].push_back(length);
+	m_columns[GTriMesh::eColumnEdgeU].push_back((length > 0.0) ? dx / length : 0.0);
+	m_columns[GTriMesh::eColumnEdgeU + 1].push_back((length > 0.0) ? dy / length : 0.0);
+
+	m_columns[GTriMesh::eColumnEdgeBox].push_back((p0[0] < p1[0]) ? p0[0] : p1[0]);
+	m_columns[GTriMesh::eColumnEdgeBox + 1].push_back((p0[1] < p1[1]) ? p0[1] : p1[1]);
+	m_columns[GTriMesh::eColumnEdgeBox + 2].push_back((p0[0] > p1[0]) ? p0[0] : p1[0]);
+	m_columns[GTriMesh::eColumnEdgeBox + 3].push_back((p0[1] > p1[1]) ? p0[1] : p1[1]);
+}
+
+void GTriMeshBuilder::AddEdges()
+{
+	std::set<EdgeKey> done;
+
+	for(std::vector<GTriMesh::Node>::iterator It = m_nodes.begin(); It != m_nodes.end(); It++)
+	{
+		GTriMesh::Node &node = *It;
+		node.m_first_edge = NumEdges();
+		node.m_edge_count = 0;
+
+		for(int i = node.m_first; i < node.m_first + node.m_count; i++)
+		{
+			double p[9];
+			for(int j = 0; j<9; j++)p[j] = m_columns[GTriMesh::eColumnP + j][i];
+			for(int j = 0; j<3; j++)
+			{
+				const double* p0 = &p[j * 3];
+				const double* p1 = &p[((j + 1) % 3) * 3];
+				if(done.insert(EdgeKey(p0, p1)).second)
+				{
+					AddEdge(p0, p1);
+					node.m_edge_count++;
+				}
+			}
+		}
+	}
+}
+
+bool GTriMeshBuilder::HasEdge(const double *p0, const double *p1)const
+{
+	const std::vector<double>* e = &m_columns[GTriMesh::eColumnEdgeP];
+	for(int i = 0; i<NumEdges(); i++)
+	{
+		if(e[0][i] == p0[0] && e[1][i] == p0[1] && e[2][i] == p0[2] && e[3][i] == p1[0] && e[4][i] == p1[1] && e[5][i] == p1[2])return true;
+		if(e[0][i] == p1[0] && e[1][i] == p1[1] && e[2][i] == p1[2] && e[3][i] == p0[0] && e[4][i] == p0[1] && e[5][i] == p0[2])return true;
+	}
+	return false;
+}
+
+void GTriMeshBuilder::Set(const double *p, int count)
+{
+	for(int i = 0; i<GTriMesh::eNumColumns; i++)m_columns[i].clear();
+
+	for(int i = 0; i<count; i++)
+	{
+		AddTriangle(GTri(&p[i * 9]));
+	}
+
+	// there are only a few triangles, so just look through the edges added so far, instead of using a set
+	for(int i = 0; i<count; i++)
+	{
+		for(int j = 0; j<3; j++)
+		{
+			const double* p0 = &p[i * 9 + j * 3];
+			const double* p1 = &p[i * 9 + ((j + 1) % 3) * 3];
+			if(!HasEdge(p0, p1))AddEdge(p0, p1);
+		}
+	}
+}
+
+void GTriMeshBuilder::Split(std::vector<const GTri*> &tris, int node_index, int first, int count)
+{
+	// find the box of the triangles, the box of their centres, their highest point and their steepest edge
+	double box[4] = {tris[first]->m_box[0], tris[first]->m_box[1], tris[first]->m_box[2], tris[first]->m_box[3]};
+	double max_z = tris[first]->m_p[2];
+	double max_slope = 0.0;
+	for(int i = first; i < first + count; i++)
+	{
+		const double* p = tris[i]->m_p;
+		for(int j = 0; j<3; j++)
+		{
+			const double* p0 = &p[j * 3];
+			const double* p1 = &p[((j + 1) % 3) * 3];
+			if(p0[2] > max_z)max_z = p0[2];
+			double length = sqrt((p1[0] - p0[0]) * (p1[0] - p0[0]) + (p1[1] - p0[1]) * (p1[1] - p0[1]));
+			if(length < 0.000000001)continue; // the edge tests leave out vertical edges
+			double slope = fabs(p1[2] - p0[2]) / length;
+			if(slope > max_slope)max_slope = slope;
+		}
+	}
+	double centre_box[4] = {box[0] + box[2], box[1] + box[3], box[0] + box[2], box[1] + box[3]}; // centres times 2
+	for(int i = first + 1; i < first + count; i++)
+	{
+		const double* b = tris[i]->m_box;
+		if(b[0] < box[0])box[0] = b[0];
+		if(b[1] < box[1])box[1] = b[1];
+		if(b[2] > box[2])box[2] = b[2];
+		if(b[3] > box[3])box[3] = b[3];
+		double cx = b[0] + b[2];
+		double cy = b[1] + b[3];
+		if(cx < centre_box[0])centre_box[0] = cx;
+		if(cy < centre_box[1])centre_box[1] = cy;
+		if(cx > centre_box[2])centre_box[2] = cx;
+		if(cy > centre_box[3])centre_box[3] = cy;
+	}
+
+	// don't keep a reference to the node, m_nodes grows below
+	memcpy(m_nodes[node_index].m_box, box, 4*sizeof(double));
+	m_nodes[node_index].m_max_z = max_z;
+	m_nodes[node_index].m_max_slope = max_slope;
+
+	if(count <= GTriMesh::max_triangles_in_leaf)
+	{
+		m_nodes[node_index].m_first = first;
+		m_nodes[node_index].m_count = count;
+		return;
+	}
+
+	// split at the median centre, along the longer side
+	int axis = (centre_box[2] - centre_box[0] >= centre_box[3] - centre_box[1]) ? 0 : 1;
+	int half = count / 2;
+	std::nth_element(tris.begin() + first, tris.begin() + first + half, tris.begin() + first + count, TriCentreLess(axis));
+
+	int child = (int)m_nodes.size();
+	m_nodes.push_back(GTriMesh::Node());
+	m_nodes.push_back(GTriMesh::Node());
+	m_nodes[node_index].m_first = child;
+	m_nodes[node_index].m_count = 0;
+
+	Split(tris, child, first, half);
+	Split(tris, child + 1, first + half, count - half);
+}
+
+static unsigned long long align_up(unsigned long long n)
+{
+	return (n + block_alignment - 1) / block_alignment * block_alignment;
+}
+
+GTriMesh::GTriMesh():m_nodes(NULL), m_num_nodes(0), m_num_triangles(0), m_num_edges(0), m_file(NULL), m_builder(NULL)
+{
+}
+
+GTriMesh::GTriMesh(const std::list<GTri> &tri_list):m_nodes(NULL), m_num_nodes(0), m_num_triangles(0), m_num_edges(0), m_file(NULL), m_builder(NULL)
+{
+	GTriMeshBuilder builder(tri_list);
+	m_num_nodes = (int)builder.m_nodes.size();
+	m_num_triangles = (int)builder.m_columns[eColumnP].size();
+	m_num_edges = builder.NumEdges();
+
+	// lay the nodes and columns out in the block, as they will be in a file
+	m_offsets.resize(eNumColumns + 1);
+	unsigned long long offset = 0;
+	m_offsets[0] = offset;
+	offset = align_up(offset + m_num_nodes * sizeof(Node));
+	for(int i = 0; i<eNumColumns; i++)
+	{
+		m_offsets[i + 1] = offset;
+		offset = align_up(offset + builder.m_columns[i].size() * sizeof(double));
+	}
+
+	m_block.resize((size_t)(offset / sizeof(double)) + 1); // + 1 so that &m_block[0] is always there
+	char* block = (char*)&m_block[0];
+	if(m_num_nodes > 0)memcpy(block + m_offsets[0], &builder.m_nodes[0], m_num_nodes * sizeof(Node));
+	for(int i = 0; i<eNumColumns; i++)
+	{
+		if(builder.m_columns[i].size() > 0)memcpy(block + m_offsets[i + 1], &builder.m_columns[i][0], builder.m_columns[i].size() * sizeof(double));
+	}
+
+	SetPointers(block, &m_offsets[0]);
+}
+
+GTriMesh::~GTriMesh()
+{
+	delete m_file;
+	delete m_builder;
+}
+
+void GTriMesh::Set(const double *p, int count)
+{
+	if(m_file)return; // a mapped mesh can't be changed
+
+	if(m_builder == NULL)m_builder = new GTriMeshBuilder;
+	m_builder->Set(p, count);
+
+	m_nodes = NULL;
+	m_num_nodes = 0;
+	m_num_triangles = count;
+	m_num_edges = m_builder->NumEdges();
+	if(count == 0)return;
+
+	const double* columns[eNumColumns];
+	for(int i = 0; i<eNumColumns; i++)columns[i] = &(m_builder->m_columns[i][0]);
+	SetColumns(columns);
+}
+
+size_t GTriMesh::MemoryUsed()const
+{
+	if(m_file)return 0; // the pages belong to the file, and are shared
+	size_t size = sizeof(GTriMesh) + m_block.capacity() * sizeof(double) + m_offsets.capacity() * sizeof(unsigned long long);
+	if(m_builder)
+	{
+		for(int i = 0; i<eNumColumns; i++)size += m_builder->m_columns[i].capacity() * sizeof(double);
+	}
+	return size;
+}
+
+void GTriMesh::SetPointers(const char* block, const unsigned long long* offsets)
+{
+	m_nodes = (const Node*)(block + offsets[0]);
+	const double* columns[eNumColumns];
+	for(int i = 0; i<eNumColumns; i++)columns[i] = (const double*)(block + offsets[i + 1]);
+	SetColumns(columns);
+}
+
+void GTriMesh::SetColumns(const double* const* columns)
+{
+	for(int i = 0; i<9; i++)m_p[i] = columns[eColumnP + i];
+	for(int i = 0; i<4; i++)m_box[i] = columns[eColumnBox + i];
+	for(int i = 0; i<3; i++)m_n[i] = columns[eColumnN + i];
+	m_neg_d_over_c = columns[eColumnNegDOverC];
+	m_tan_theta = columns[eColumnTanTheta];
+	m_sin_theta = columns[eColumnSinTheta];
+	m_cos_theta = columns[eColumnCosTheta];
+	for(int i = 0; i<6; i++)m_edge_p[i] = columns[eColumnEdgeP + i];
+	for(int i = 0; i<2; i++)m_edge_u[i] = columns[eColumnEdgeU + i];
+	m_edge_length = columns[eColumnEdgeLength];
+	for(int i = 0; i<4; i++)m_edge_box[i] = columns[eColumnEdgeBox + i];
+}
+
+void GTriMesh::GetBox(double *box)const
+{
+	for(int i = 0; i<6; i++)box[i] = 0.0;
+	if(m_num_nodes == 0)return;
+
+	box[0] = m_nodes[0].m_box[0];
+	box[1] = m_nodes[0].m_box[1];
+	box[3] = m_nodes[0].m_box[2];
+	box[4] = m_nodes[0].m_box[3];
+	box[2] = m_p[2][0];
+	box[5] = m_nodes[0].m_max_z;
+	for(int v = 0; v<3; v++)
+	{
+		const double* z = m_p[v * 3 + 2];
+		for(int i = 0; i<m_num_triangles; i++)
+		{
+			if(z[i] < box[2])box[2] = z[i];
+		}
+	}
+}
+
+bool GTriMesh::Save(const std::string &path, double tolerance)const
+{
+	if(m_file)return false; // it's already in a file
+	if(m_builder)return false; // made by Set, it has no tree
+
+	size_t block_size = m_block.size() * sizeof(double);
+	MappedFile file;
+	if(!file.Create(path, file_header_size + block_size))return false;
+
+	GTriMeshFileHeader* header = (GTriMeshFileHeader*)file.Data();
+	memcpy(header->m_magic, "HCNCGTRI", 8);
+	header->m_version = 1;
+	header->m_header_size = file_header_size;
+	header->m_num_triangles = m_num_triangles;
+	header->m_num_edges = m_num_edges;
+	header->m_num_nodes = m_num_nodes;
+	header->m_block_size = block_size;
+	GetBox(header->m_box);
+	header->m_tolerance = tolerance;
+	for(int i = 0; i<eNumColumns + 1; i++)header->m_offsets[i] = m_offsets[i];
+
+	memcpy((char*)file.Data() + file_header_size, &m_block[0], block_size);
+	return true;
+}
+
+// a damaged file mustn't make the tests read outside the mapping, so everything the header says is checked against the block
+// static
+bool GTriMesh::FileHeaderFits(const GTriMeshFileHeader* header, const char* block)
+{
+	unsigned long long block_size = header->m_block_size;
+	if(header->m_num_triangles > INT_MAX || header->m_num_edges > INT_MAX || header->m_num_nodes > INT_MAX)return false;
+
+	// the nodes, then each column, must be inside the block
+	for(int i = 0; i<eNumColumns + 1; i++)
+	{
+		unsigned long long offset = header->m_offsets[i];
+		if(offset > block_size || offset % sizeof(double) != 0)return false;
+		unsigned long long size_left = block_size - offset;
+		if(i == 0)
+		{
+			if(header->m_num_nodes > size_left / sizeof(Node))return false;
+		}
+		else
+		{
+			unsigned long long column_length = (i - 1 < eColumnEdgeP) ? header->m_num_triangles : header->m_num_edges;
+			if(column_length > size_left / sizeof(double))return false;
+		}
+	}
+
+	// each leaf's triangles and edges must be in the columns, and each branch's children must come after it, not too deep for VisitLeaves' stack
+	int num_nodes = (int)header->m_num_nodes;
+	int num_triangles = (int)header->m_num_triangles;
+	int num_edges = (int)header->m_num_edges;
+	const Node* nodes = (const Node*)(block + header->m_offsets[0]);
+	std::vector<unsigned char> depth(num_nodes, 0);
+	for(int i = 0; i<num_nodes; i++)
+	{
+		const Node &node = nodes[i];
+		if(node.m_count > 0)
+		{
+			// the tests work on a leaf in arrays with room for the biggest leaf, and three edges for each of its triangles
+			if(node.m_count > max_triangles_in_leaf || node.m_edge_count > 3 * node.m_count)return false;
+			if(node.m_first < 0 || node.m_first > num_triangles - node.m_count)return false;
+			if(node.m_first_edge < 0 || node.m_edge_count < 0 || node.m_first_edge > num_edges - node.m_edge_count)return false;
+		}
+		else
+		{
+			if(node.m_count < 0 || node.m_first <= i || node.m_first >= num_nodes - 1)return false;
+			if(depth[i] >= 100)return false;
+			depth[node.m_first] = depth[i] + 1;
+			depth[node.m_first + 1] = depth[i] + 1;
+		}
+	}
+
+	return true;
+}
+
+// static
+GTriMesh* GTriMesh::Open(const std::string &path, double* tolerance)
+{
+	MappedFile* file = new MappedFile;
+	if(!file->Open(path) || file->Size() < sizeof(GTriMeshFileHeader))
+	{
+		delete file;
+		return NULL;
+	}
+
+	const GTriMeshFileHeader* header = (const GTriMeshFileHeader*)file->Data();
+	if(memcmp(header->m_magic, "HCNCGTRI", 8) != 0 || header->m_version != 1 || header->m_header_size < sizeof(GTriMeshFileHeader) || header->m_header_size > file->Size() || header->m_block_size > file->Size() - header->m_header_size)
+	{
+		delete file;
+		return NULL;
+	}
+
+	const char* block = (const char*)file->Data() + header->m_header_size;
+	if(!FileHeaderFits(header, block))
+	{
+		delete file;
+		return NULL;
+	}
+
+	GTriMesh* mesh = new GTriMesh;
+	mesh->m_file = file;
+	mesh->m_num_triangles = (int)header->m_num_triangles;
+	mesh->m_num_edges = (int)header->m_num_edges;
+	mesh->m_num_nodes = (int)header->m_num_nodes;
+	mesh->m_offsets.assign(header->m_offsets, header->m_offsets + eNumColumns + 1);
+	mesh->SetPointers((const char*)file->Data() + header->m_header_size, header->m_offsets);
+	if(tolerance)*tolerance = header->m_tolerance;
+	return mesh;
+}
+
+void GTriMesh::GetTriangles(const double *box, std::vector<int> &result)const
+{
+	TriCollector collector(*this, box, result);
+	VisitLeaves(box, collector);
+}
+
+void GTriMesh::GetTriangle(int i, double *p)const
+{
+	for(int j = 0; j<9; j++)p[j] = m_p[j][i];
+}
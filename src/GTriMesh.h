@@ -0,0 +1,220 @@
+// GTriMesh.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+// triangles for DropCutter, with a 2D AABB tree over the triangle boxes
+// so that only the triangles under the cutter get tested
+// the triangles are stored as columns ( structure of arrays ), in leaf order,
+// so that the DropCutter batch tests can work on several triangles at once
+// edges shared by two triangles are only stored once, with their direction worked out already,
+// and each edge is kept in the leaf of the first triangle which uses it
+// the tree and the columns are all in one block, laid out as they are in a mesh file,
+// so a saved mesh can be mapped into memory and used without reading or building anything
+
+#pragma once
+
+#include <list>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "GTri.h"
+
+class MappedFile;
+class GTriMeshBuilder;
+class GTriMeshFileHeader;
+
+class GTriMesh
+{
+public:
+	class Node{
+	public:
+		double m_box[4]; // minx miny maxx maxy, of all the triangles below this node
+		int m_first; // index of first child node ( second is m_first + 1 ), or first triangle for a leaf
+		int m_count; // number of triangles in a leaf, 0 for a branch
+		int m_first_edge; // edges m_first_edge to m_first_edge + m_edge_count - 1 belong to a leaf
+		int m_edge_count;
+		double m_max_z; // the highest point of all the triangles below this node
+		double m_max_slope; // the steepest of their edges, dz over xy length; the edge tests can go up to the tolerance past the end of an edge
+	};
+
+	static const int max_triangles_in_leaf = 8;
+
+	// where the columns are in the block
+	typedef enum {
+		eColumnP = 0, // 9 columns
+		eColumnBox = 9, // 4
+		eColumnN = 13, // 3
+		eColumnNegDOverC = 16,
+		eColumnTanTheta,
+		eColumnSinTheta,
+		eColumnCosTheta,
+		eColumnEdgeP = 20, // 6
+		eColumnEdgeU = 26, // 2
+		eColumnEdgeLength = 28,
+		eColumnEdgeBox = 29, // 4
+		eNumColumns = 33
+	} eColumn;
+
+	// columns, each has one value per triangle
+	const double* m_p[9]; // x0 y0 z0 x1 y1 z1 x2 y2 z2
+	const double* m_box[4]; // minx miny maxx maxy
+	const double* m_n[3]; // normal, flipped to point up, as used by DropCutter::FacetTest
+	const double* m_neg_d_over_c; // -d/c for the plane a*x + b*y + c*z + d = 0, where a b c is m_n
+	const double* m_tan_theta; // theta = asin(c), the values used by DropCutter::FacetTest
+	const double* m_sin_theta;
+	const double* m_cos_theta;
+
+	// columns for the edges, each has one value per edge
+	const double* m_edge_p[6]; // x0 y0 z0 x1 y1 z1
+	const double* m_edge_u[2]; // unit direction in xy, from the first point to the second
+	const double* m_edge_length; // length in xy
+	const double* m_edge_box[4]; // minx miny maxx maxy
+
+	GTriMesh(const std::list<GTri> &tri_list);
+	~GTriMesh();
+
+	// a mesh with no triangles, to be filled by Set
+	GTriMesh();
+
+	// replaces the triangles with count triangles from p ( nine doubles each ), and their edges, without a tree
+	// the memory is kept for the next call, so this is for testing a few triangles at a time, like the tiles of a CompactMesh
+	void Set(const double *p, int count);
+
+	// bytes of memory used by the mesh; nothing for a mapped mesh, whose pages can be shared and dropped
+	size_t MemoryUsed()const;
+
+	// saves the mesh, with the tolerance that its triangles were made with, in the format described by GTriMeshFileHeader
+	bool Save(const std::string &path, double tolerance)const;
+
+	// maps a saved mesh into memory, read only, so processes which open the same file share one copy of it
+	// returns NULL if the file isn't there or isn't a mesh file of this version
+	static GTriMesh* Open(const std::string &path, double* tolerance = NULL);
+
+	// calls visitor(node) for each leaf whose box overlaps box ( minx miny maxx maxy )
+	// the leaf's triangles and edges still need checking against box
+	// an edge whose box overlaps box is always visited, because the leaf it is kept in contains it
+	template<class Visitor> void VisitLeaves(const double *box, Visitor &visitor)const
+	{
+		if(m_num_nodes == 0)return;
+
+		// the tree is balanced, so this is deep enough for any number of triangles an int can count
+		int stack[128];
+		int n = 0;
+		stack[n++] = 0;
+		while(n > 0)
+		{
+			const Node &node = m_nodes[stack[--n]];
+			if(!boxes_overlap(node.m_box, box))continue;
+			if(node.m_count > 0)
+			{
+				visitor(node);
+			}
+			else
+			{
+				stack[n++] = node.m_first + 1;
+				stack[n++] = node.m_first;
+			}
+		}
+	}
+
+	// like VisitLeaves, but visits the nodes in order of visitor.Bound(node), highest first,
+	// and stops as soon as the highest bound left is not above visitor.Best()
+	// visitor.Bound(node) must not be lower than any height the visitor could get from the triangles below the node
+	// heap is only for working space; pass in the same one for many calls, to save allocating it each time
+	template<class Visitor> void VisitLeavesBestFirst(const double *box, Visitor &visitor, std::vector< std::pair<double, int> > &heap)const
+	{
+		heap.clear();
+		if(m_num_nodes == 0)return;
+
+		if(boxes_overlap(m_nodes[0].m_box, box))heap.push_back(std::make_pair(visitor.Bound(m_nodes[0]), 0));
+		while(heap.size() > 0)
+		{
+			std::pop_heap(heap.begin(), heap.end());
+			std::pair<double, int> top = heap.back();
+			heap.pop_back();
+			if(top.first <= visitor.Best())break;
+
+			const Node &node = m_nodes[top.second];
+			if(node.m_count > 0)
+			{
+				visitor(node);
+			}
+			else
+			{
+				for(int i = 0; i<2; i++)
+				{
+					const Node &child = m_nodes[node.m_first + i];
+					if(!boxes_overlap(child.m_box, box))continue;
+					heap.push_back(std::make_pair(visitor.Bound(child), node.m_first + i));
+					std::push_heap(heap.begin(), heap.end());
+				}
+			}
+		}
+	}
+
+	// adds the indices of all the triangles whose boxes overlap box to result
+	void GetTriangles(const double *box, std::vector<int> &result)const;
+
+	// copies the three points of a triangle to p ( nine doubles )
+	void GetTriangle(int i, double *p)const;
+
+	bool TriangleOverlaps(int i, const double *box)const
+	{
+		return !(m_box[0][i] > box[2] || m_box[1][i] > box[3] || m_box[2][i] < box[0] || m_box[3][i] < box[1]);
+	}
+
+	bool EdgeOverlaps(int i, const double *box)const
+	{
+		return !(m_edge_box[0][i] > box[2] || m_edge_box[1][i] > box[3] || m_edge_box[2][i] < box[0] || m_edge_box[3][i] < box[1]);
+	}
+
+	int NumTriangles()const{return m_num_triangles;}
+	int NumEdges()const{return m_num_edges;}
+	int NumNodes()const{return m_num_nodes;}
+	const Node* Nodes()const{return m_nodes;}
+
+	// minx miny minz maxx maxy maxz of all the triangles
+	void GetBox(double *box)const;
+
+	// touching boxes count as overlapping, to match the box check in DropCutter::TriTest
+	static bool boxes_overlap(const double *b1, const double *b2)
+	{
+		return !(b1[0] > b2[2] || b1[1] > b2[3] || b1[2] < b2[0] || b1[3] < b2[1]);
+	}
+
+private:
+	const Node* m_nodes;
+	int m_num_nodes;
+	int m_num_triangles;
+	int m_num_edges;
+
+	std::vector<double> m_block; // the nodes and columns, for a mesh made in memory
+	std::vector<unsigned long long> m_offsets; // where they are in the block
+	MappedFile* m_file; // for a mesh opened from a file
+	GTriMeshBuilder* m_builder; // the columns for a mesh filled by Set
+
+	GTriMesh(const GTriMesh &); // not copyable, the columns point into the block
+	GTriMesh& operator=(const GTriMesh &);
+
+	void SetPointers(const char* block, const unsigned long long* offsets);
+	static bool FileHeaderFits(const GTriMeshFileHeader* header, const char* block);
+	void SetColumns(const double* const* columns);
+};
+
+// the start of a mesh file
+// the block starts at m_header_size, and the nodes and each column start on a 4096 byte boundary in it
+// all numbers are in the machine's own byte order
+class GTriMeshFileHeader
+{
+public:
+	char m_magic[8]; // "HCNCGTRI"
+	unsigned int m_version; // 1
+	unsigned int m_header_size; // 4096
+	unsigned long long m_num_triangles;
+	unsigned long long m_num_edges;
+	unsigned long long m_num_nodes;
+	unsigned long long m_block_size; // in bytes
+	double m_box[6]; // minx miny minz maxx maxy maxz of all the triangles
+	double m_tolerance; // that the triangles were made with
+	unsigned long long m_offsets[GTriMesh::eNumColumns + 1]; // where the nodes start in the block, then where each column starts
+};
@@ -0,0 +1,181 @@
+// GougeCheck.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "stdafx.h"
+#include "GougeCheck.h"
+#include "CNCConfig.h"
+#include "Program.h"
+#include "NCCode.h"
+#include "OutputCanvas.h"
+#include "CTool.h"
+#include "Surface.h"
+#include "Surfaces.h"
+#include "SurfaceMesh.h"
+#include "ToolpathCheck.h"
+#include "DropCutter.h"
+#include "interface/PropertyLength.h"
+
+double GougeCheck::m_tolerance = 0.01;
+
+class GougeCheckSurface: public ToolpathCheck::Surface
+{
+	CSurfaceMesh* m_mesh;
+	double m_top;
+public:
+	GougeCheckSurface(CSurfaceMesh* mesh, double top):m_mesh(mesh), m_top(top){}
+	PointDropper* Dropper(const Cutter &cu, double minz){return m_mesh->Dropper(cu, minz);}
+	double Top(){return m_top;}
+};
+
+// how many points to split an arc into, so they are no more than step apart
+static int arc_points(const PathObject* arc, const PathObject* prev_po, double step)
+{
+	// as PathObject::Interpolate
+	double sx = -arc->m_c[0];
+	double sy = -arc->m_c[1];
+	double ex = -arc->m_c[0] + arc->m_x[0] - prev_po->m_x[0];
+	double ey = -arc->m_c[1] + arc->m_x[1] - prev_po->m_x[1];
+	double start_angle = atan2(sy, sx);
+	double end_angle = atan2(ey, ex);
+	double sweep = (arc->m_dir == 1) ? (end_angle - start_angle) : (start_angle - end_angle);
+	if(sweep <= 0.0)sweep += 2 * M_PI;
+
+	int n = (int)ceil(sqrt(sx * sx + sy * sy) * sweep / step);
+	return (n < 1) ? 1 : n;
+}
+
+// static
+void GougeCheck::Run()
+{
+	CNCCode* nc_code = theApp.m_program->NCCode();
+	if(nc_code->m_blocks.size() == 0)
+	{
+		wxMessageBox(_("There is no NC code to check"));
+		return;
+	}
+
+	ToolpathCheck check(m_tolerance);
+
+	std::vector<CSurface*> surfaces;
+	for(HeeksObj* object = theApp.m_program->Surfaces()->GetFirstChild(); object; object = theApp.m_program->Surfaces()->GetNextChild())
+	{
+		CSurface* surface = (CSurface*)object;
+		CSurfaceMesh* mesh = CSurfaceMesh::Get(surface);
+		CBox box;
+		mesh->GetBox(box);
+		if(!box.m_valid)continue;
+		check.AddSurface(new GougeCheckSurface(mesh, box.MaxZ()));
+		surfaces.push_back(surface);
+	}
+	if(surfaces.size() == 0)
+	{
+		wxMessageBox(_("There are no surfaces to check the NC code against"));
+		return;
+	}
+
+	wxBusyCursor busy;
+	DropCutterDiagnostics::Reset();
+
+	// the moves, with the tools' real sizes, not made bigger by the surfaces' material allowances
+	std::map<int, int> tools; // tool number to ToolpathCheck's index, or -1 for a tool which isn't in the program
+	std::vector<CNCCodeBlock*> blocks;
+	const PathObject* prev_po = NULL;
+	for(std::list<CNCCodeBlock*>::iterator It = nc_code->m_blocks.begin(); It != nc_code->m_blocks.end(); It++)
+	{
+		CNCCodeBlock* block = *It;
+		int block_index = (int)blocks.size();
+		blocks.push_back(block);
+
+		for(int i = block->m_first_path_object; i < block->m_first_path_object + block->m_num_path_objects; i++)
+		{
+			const PathObject* po = &nc_code->m_path_objects[i];
+			bool rapid = (po->m_color_type == ColorRapidType);
+
+			std::map<int, int>::iterator FindIt = tools.find(po->m_tool_number);
+			if(FindIt == tools.end())
+			{
+				int index = -1;
+				CTool* pTool = CTool::Find(po->m_tool_number);
+				if(pTool)index = check.AddTool(pTool->DropCutterDefinition(0.0), pTool->m_params.m_diameter / 2, pTool->m_params.m_cutting_edge_height);
+				FindIt = tools.insert(std::make_pair(po->m_tool_number, index)).first;
+			}
+			int tool = FindIt->second;
+
+			if(po->GetType() == PathObject::eArc && prev_po != NULL && tool >= 0)
+			{
+				double step = CTool::Find(po->m_tool_number)->m_params.m_diameter / 8;
+				std::list<gp_Pnt> points = po->Interpolate(prev_po, arc_points(po, prev_po, step));
+				points.pop_front(); // the start of the arc
+				for(std::list<gp_Pnt>::iterator PntIt = points.begin(); PntIt != points.end(); PntIt++)
+				{
+					double p[3] = {PntIt->X(), PntIt->Y(), PntIt->Z()};
+					check.MoveTo(p, tool, rapid, block_index);
+				}
+			}
+			else
+			{
+				check.MoveTo(po->m_x, tool, rapid, block_index);
+			}
+			prev_po = po;
+		}
+	}
+	check.Finish();
+
+	std::vector<ToolpathCheck::Problem> problems;
+	check.GetProblems(problems);
+
+	std::string report = DropCutterDiagnostics::Report();
+	if(report.size() > 0)wxMessageBox(_("Gouge check - Problems found while dropping the cutter") + _T("\n") + Ctt(report.c_str()));
+
+	std::list<CNCCodeBlock*> flagged;
+	int counts[ToolpathCheck::eNumProblemTypes] = {0, 0, 0};
+	for(std::vector<ToolpathCheck::Problem>::iterator It = problems.begin(); It != problems.end(); It++)
+	{
+		CNCCodeBlock* block = blocks[It->m_block];
+		if(flagged.size() == 0 || flagged.back() != block)flagged.push_back(block);
+		counts[It->m_type]++;
+	}
+	nc_code->SetFlaggedBlocks(flagged);
+
+	if(flagged.size() == 0)
+	{
+		wxMessageBox(wxString::Format(_("No gouges or collisions found, checked %ld points"), check.NumSamples()));
+		return;
+	}
+
+	// show the first problem
+	const ToolpathCheck::Problem &first = problems.front();
+	theApp.m_output_canvas->m_textCtrl->ShowPosition(blocks[first.m_block]->m_from_pos);
+
+	wxString type_names[ToolpathCheck::eNumProblemTypes] = {_("a gouge"), _("a rapid move touching the surface"), _("the shank touching the surface")};
+	wxString str = wxString::Format(_("Problems found in %d blocks, shown in red in the output window"), (int)flagged.size());
+	str += wxString::Format(_T("\n%s: %d, %s: %d, %s: %d"), wxString(_("Gouges")).c_str(), counts[ToolpathCheck::eGouge], wxString(_("Rapid collisions")).c_str(), counts[ToolpathCheck::eRapid], wxString(_("Shank collisions")).c_str(), counts[ToolpathCheck::eShank]);
+	str += wxString::Format(_("\nThe first is %s, %g deep, into surface %d, at X%g Y%g Z%g"), type_names[first.m_type].c_str(), first.m_depth / theApp.m_program->m_units, surfaces[first.m_surface]->m_id, first.m_p[0] / theApp.m_program->m_units, first.m_p[1] / theApp.m_program->m_units, first.m_p[2] / theApp.m_program->m_units);
+	wxMessageBox(str);
+}
+
+static void on_set_tolerance(double value, HeeksObj* object)
+{
+	GougeCheck::m_tolerance = value;
+	GougeCheck::WriteToConfig();
+}
+
+// static
+void GougeCheck::GetOptions(std::list<Property *> *list)
+{
+	list->push_back(new PropertyLength(_("Gouge check tolerance"), m_tolerance, NULL, on_set_tolerance));
+}
+
+// static
+void GougeCheck::ReadFromConfig()
+{
+	CNCConfig config;
+	config.Read(_T("GougeCheckTolerance"), &m_tolerance, 0.01);
+}
+
+// static
+void GougeCheck::WriteToConfig()
+{
+	CNCConfig config;
+	config.Write(_T("GougeCheckTolerance"), m_tolerance);
+}
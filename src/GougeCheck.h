@@ -0,0 +1,19 @@
+// GougeCheck.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+// checks the program's NC code against all of its surfaces, for feed moves going into them, rapid moves touching them,
+// and shanks hitting them, see ToolpathCheck, and flags the blocks where it finds them in the output window
+
+#pragma once
+
+class GougeCheck
+{
+public:
+	static double m_tolerance; // how far the cutter can go into a surface before it is counted
+
+	static void Run();
+
+	static void GetOptions(std::list<Property *> *list);
+	static void ReadFromConfig();
+	static void WriteToConfig();
+};
@@ -30,6 +30,9 @@
 #include "Profile.h"
 #include "Pocket.h"
 #include "Drilling.h"
+#include "RasterFinish.h"
+#include "Waterline.h"
+#include "GougeCheck.h"
 #include "CTool.h"
 #include "Operations.h"
 #include "Tools.h"
@@ -47,6 +50,7 @@
 #include "Surfaces.h"
 #include "Stock.h"
 #include "Stocks.h"
+#include "ThreadPool.h"
 
 #include <sstream>
 
@@ -290,6 +294,66 @@ static void NewDrillingOpMenuCallback(wxCommandEvent &event)
 	NewDrillingOp();
 }
 
+// a marked surface, or the first one
+static int SurfaceForNewOp()
+{
+	int surface = 0;
+	const std::list<HeeksObj*>& list = heeksCAD->GetMarkedList();
+	for(std::list<HeeksObj*>::const_iterator It = list.begin(); It != list.end(); It++)
+	{
+		HeeksObj* object = *It;
+		if(object->GetType() == SurfaceType)
+		{
+			surface = object->m_id;
+			break;
+		}
+	}
+	if(surface == 0)
+	{
+		HeeksObj* object = theApp.m_program->Surfaces()->GetFirstChild();
+		if(object)surface = object->m_id;
+	}
+	return surface;
+}
+
+static void NewRasterFinishOp()
+{
+	CRasterFinish *new_object = new CRasterFinish(SurfaceForNewOp(), -1);
+	new_object->SetID(heeksCAD->GetNextID(RasterFinishType));
+	if(new_object->Edit())
+	{
+		heeksCAD->StartHistory();
+		heeksCAD->AddUndoably(new_object, theApp.m_program->Operations());
+		heeksCAD->EndHistory();
+	}
+	else
+		delete new_object;
+}
+
+static void NewRasterFinishOpMenuCallback(wxCommandEvent &event)
+{
+	NewRasterFinishOp();
+}
+
+static void NewWaterlineOp()
+{
+	CWaterline *new_object = new CWaterline(SurfaceForNewOp(), -1);
+	new_object->SetID(heeksCAD->GetNextID(WaterlineType));
+	if(new_object->Edit())
+	{
+		heeksCAD->StartHistory();
+		heeksCAD->AddUndoably(new_object, theApp.m_program->Operations());
+		heeksCAD->EndHistory();
+	}
+	else
+		delete new_object;
+}
+
+static void NewWaterlineOpMenuCallback(wxCommandEvent &event)
+{
+	NewWaterlineOp();
+}
+
 static void NewScriptOpMenuCallback(wxCommandEvent &event)
 {
 	CScriptOp *new_object = new CScriptOp();
@@ -486,6 +550,11 @@ static void PostProcessMenuCallback(wxCommandEvent &event)
 	theApp.RunPythonScript();
 }
 
+static void GougeCheckMenuCallback(wxCommandEvent &event)
+{
+	GougeCheck::Run();
+}
+
 static void CancelMenuCallback(wxCommandEvent &event)
 {
 	HeeksPyCancel();
@@ -498,6 +567,11 @@ static void SimulateCallback(wxCommandEvent &event)
 }
 #endif
 
+static void GoToNCLineMenuCallback(wxCommandEvent& event)
+{
+	theApp.m_output_canvas->GoTo();
+}
+
 static void OpenNcFileMenuCallback(wxCommandEvent& event)
 {
 	// Default directory
@@ -562,6 +636,21 @@ static void SaveNcFileMenuCallback(wxCommandEvent& event)
 	if (fd.ShowModal() == wxID_OK)
 	{           
 		wxString nc_file_str = fd.GetPath().c_str();
+
+		// get the text before the file is opened, because the output window might be showing the file itself, mapped into memory
+		wxString nc_text;
+		if(theApp.m_use_DOS_not_Unix == true)   //DF -added to get DOS line endings HeeksCNC running on Unix 
+		{
+			int nLines = theApp.m_output_canvas->m_textCtrl->GetNumberOfLines();
+			for ( int nLine = 0; nLine < nLines; nLine ++)
+			{   
+				nc_text.append(theApp.m_output_canvas->m_textCtrl->GetLineText(nLine) + _T("\r\n") );
+			}
+		}
+		else
+			nc_text = theApp.m_output_canvas->m_textCtrl->GetValue();
+		theApp.m_output_canvas->m_textCtrl->Clear();
+
 		{
 			wxFile ofs(nc_file_str.c_str(), wxFile::write);
 			if(!ofs.IsOpened())
@@ -570,20 +659,7 @@ static void SaveNcFileMenuCallback(wxCommandEvent& event)
 				return;
 			}
 
-			if(theApp.m_use_DOS_not_Unix == true)   //DF -added to get DOS line endings HeeksCNC running on Unix 
-			{
-				long line_num= 0;
-				bool ok = true;
-				int nLines = theApp.m_output_canvas->m_textCtrl->GetNumberOfLines();
-				for ( int nLine = 0; ok && nLine < nLines; nLine ++)
-				{   
-					ok = ofs.Write(theApp.m_output_canvas->m_textCtrl->GetLineText(line_num) + _T("\r\n") );
-					line_num = line_num+1;
-				}
-			}
-
-			else
-				ofs.Write(theApp.m_output_canvas->m_textCtrl->GetValue());
+			ofs.Write(nc_text);
 		}
 		HeeksPyBackplot(theApp.m_program, theApp.m_program, nc_file_str);
 	}
@@ -789,6 +865,8 @@ static void AddToolBars()
 		heeksCAD->AddFlyoutButton(_T("Profile"), ToolImage(_T("opprofile")), _("New Profile Operation..."), NewProfileOpMenuCallback);
 		heeksCAD->AddFlyoutButton(_T("Pocket"), ToolImage(_T("pocket")), _("New Pocket Operation..."), NewPocketOpMenuCallback);
 		heeksCAD->AddFlyoutButton(_T("Drill"), ToolImage(_T("drilling")), _("New Drill Cycle Operation..."), NewDrillingOpMenuCallback);
+		heeksCAD->AddFlyoutButton(_T("RasterFinish"), ToolImage(_T("zigzag")), _("New Raster Finish Operation..."), NewRasterFinishOpMenuCallback);
+		heeksCAD->AddFlyoutButton(_T("Waterline"), ToolImage(_T("opcontour")), _("New Waterline Operation..."), NewWaterlineOpMenuCallback);
 		heeksCAD->EndToolBarFlyout((wxToolBar*)(theApp.m_machiningBar));
 
 		heeksCAD->StartToolBarFlyout(_("Other operations"));
@@ -1098,6 +1176,8 @@ void CHeeksCNCApp::OnStartUp(CHeeksCADInterface* h, const wxString& dll_path)
 	heeksCAD->AddMenuItem(menuMillingOperations, _("Profile Operation..."), ToolImage(_T("opprofile")), NewProfileOpMenuCallback);
 	heeksCAD->AddMenuItem(menuMillingOperations, _("Pocket Operation..."), ToolImage(_T("pocket")), NewPocketOpMenuCallback);
 	heeksCAD->AddMenuItem(menuMillingOperations, _("Drilling Operation..."), ToolImage(_T("drilling")), NewDrillingOpMenuCallback);
+	heeksCAD->AddMenuItem(menuMillingOperations, _("Raster Finish Operation..."), ToolImage(_T("zigzag")), NewRasterFinishOpMenuCallback);
+	heeksCAD->AddMenuItem(menuMillingOperations, _("Waterline Operation..."), ToolImage(_T("opcontour")), NewWaterlineOpMenuCallback);
 
 	// Additive Operations menu
 	wxMenu *menuOperations = new wxMenu;
@@ -1123,10 +1203,12 @@ void CHeeksCNCApp::OnStartUp(CHeeksCADInterface* h, const wxString& dll_path)
 	heeksCAD->AddMenuItem(menuMachining, _("Add New Tool"), ToolImage(_T("tools")), NULL, NULL, menuTools);
 	heeksCAD->AddMenuItem(menuMachining, _("Run Python Script"), ToolImage(_T("runpython")), RunScriptMenuCallback);
 	heeksCAD->AddMenuItem(menuMachining, _("Post-Process"), ToolImage(_T("postprocess")), PostProcessMenuCallback);
+	heeksCAD->AddMenuItem(menuMachining, _("Check for Gouges"), ToolImage(_T("surface")), GougeCheckMenuCallback);
 #ifdef WIN32
 	heeksCAD->AddMenuItem(menuMachining, _("Simulate"), ToolImage(_T("simulate")), SimulateCallback);
 #endif
 	heeksCAD->AddMenuItem(menuMachining, _("Open NC File..."), ToolImage(_T("opennc")), OpenNcFileMenuCallback);
+	heeksCAD->AddMenuItem(menuMachining, _("Go To NC Line..."), ToolImage(_T("opennc")), GoToNCLineMenuCallback);
 	heeksCAD->AddMenuItem(menuMachining, _("Save NC File as..."), ToolImage(_T("savenc")), SaveNcFileMenuCallback);
 #ifndef WIN32
 	heeksCAD->AddMenuItem(menuMachining, _("Send to Machine"), ToolImage(_T("tomachine")), SendToMachineMenuCallback);
@@ -1157,6 +1239,7 @@ void CHeeksCNCApp::OnStartUp(CHeeksCADInterface* h, const wxString& dll_path)
 	CNCCode::ReadColorsFromConfig();
 	CProfile::ReadFromConfig();
 	CPocket::ReadFromConfig();
+	GougeCheck::ReadFromConfig();
 	CSpeedOp::ReadFromConfig();
 	CSendToMachine::ReadFromConfig();
 	config.Read(_T("UseClipperNotBoolean"), &m_use_Clipper_not_Boolean, false);
@@ -1186,6 +1269,8 @@ void CHeeksCNCApp::OnStartUp(CHeeksCADInterface* h, const wxString& dll_path)
 	heeksCAD->RegisterReadXMLfunction("Profile", CProfile::ReadFromXMLElement);
 	heeksCAD->RegisterReadXMLfunction("Pocket", CPocket::ReadFromXMLElement);
 	heeksCAD->RegisterReadXMLfunction("Drilling", CDrilling::ReadFromXMLElement);
+	heeksCAD->RegisterReadXMLfunction("RasterFinish", CRasterFinish::ReadFromXMLElement);
+	heeksCAD->RegisterReadXMLfunction("Waterline", CWaterline::ReadFromXMLElement);
 	heeksCAD->RegisterReadXMLfunction("Tool", CTool::ReadFromXMLElement);
 	heeksCAD->RegisterReadXMLfunction("CuttingTool", CTool::ReadFromXMLElement);
 	heeksCAD->RegisterReadXMLfunction("Tags", CTags::ReadFromXMLElement);
@@ -1325,6 +1410,7 @@ void CHeeksCNCApp::GetOptions(std::list<Property *> *list){
 	CSpeedOp::GetOptions(&(machining_options->m_list));
 	CProfile::GetOptions(&(machining_options->m_list));
 	CPocket::GetOptions(&(machining_options->m_list));
+	GougeCheck::GetOptions(&(machining_options->m_list));
 	CSendToMachine::GetOptions(&(machining_options->m_list));
 	machining_options->m_list.push_back ( new PropertyCheck ( _("Use Clipper not Boolean"), m_use_Clipper_not_Boolean, NULL, on_set_use_clipper ) );
 	machining_options->m_list.push_back ( new PropertyCheck ( _("Use DOS Line Endings"), m_use_DOS_not_Unix, NULL, on_set_use_DOS ) );
@@ -1348,10 +1434,13 @@ void CHeeksCNCApp::OnFrameDelete()
 	CNCCode::WriteColorsToConfig();
 	CProfile::WriteToConfig();
 	CPocket::WriteToConfig();
+	GougeCheck::WriteToConfig();
 	CSpeedOp::WriteToConfig();
 	CSendToMachine::WriteToConfig();
 	config.Write(_T("UseClipperNotBoolean"), m_use_Clipper_not_Boolean);
 	config.Write(_T("UseDOSNotUnix"), m_use_DOS_not_Unix);
+
+	ThreadPool::Shutdown();
 }
 
 Python CHeeksCNCApp::SetTool( const int new_tool )
@@ -1370,7 +1459,7 @@ Python CHeeksCNCApp::SetTool( const int new_tool )
 
 		if(m_attached_to_surface)
 		{
-			python << _T("nc.creator.set_ocl_cutter(") << pTool->OCLDefinition(m_attached_to_surface) << _T(")\n");
+			python << _T("nc.creator.set_cutter(") << pTool->AttachDefinition(m_attached_to_surface) << _T(")\n");
 		}
 	} // End if - then
 
@@ -1476,6 +1565,8 @@ wxString HeeksCNCType( const int type )
 		case TagsType:       return(_("Tags"));
 		case TagType:       return(_("Tag"));
 		case ScriptOpType:       return(_("ScriptOp"));
+		case RasterFinishType:       return(_("RasterFinish"));
+		case WaterlineType:       return(_("Waterline"));
 
 		default:
 								 return(_T("")); // Indicates that this function could not make the conversion.
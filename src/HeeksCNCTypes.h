@@ -24,5 +24,7 @@ enum{
 	SurfacesType,
 	StockType,
 	StocksType,
+	RasterFinishType,
+	WaterlineType,
 	HeeksCNCMaximumType
 };
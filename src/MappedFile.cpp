@@ -0,0 +1,127 @@
+// MappedFile.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "stdafx.h"
+#include "MappedFile.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef WIN32
+static std::wstring WidePath(const std::string &path)
+{
+	int n = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, NULL, 0);
+	if(n <= 0)return std::wstring();
+	std::wstring wide(n, L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wide[0], n);
+	wide.resize(n - 1);
+	return wide;
+}
+
+MappedFile::MappedFile():m_file(INVALID_HANDLE_VALUE), m_mapping(NULL), m_data(NULL), m_size(0), m_writable(false)
+{
+}
+#else
+MappedFile::MappedFile():m_file(-1), m_data(NULL), m_size(0), m_writable(false)
+{
+}
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Create(const std::string &path, size_t size)
+{
+	Close();
+	if(size == 0)return false;
+
+#ifdef WIN32
+	m_file = CreateFileW(WidePath(path).c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(m_file == INVALID_HANDLE_VALUE)return false;
+	unsigned long long size64 = size;
+	m_mapping = CreateFileMappingW(m_file, NULL, PAGE_READWRITE, (DWORD)(size64 >> 32), (DWORD)(size64 & 0xffffffff), NULL);
+	if(m_mapping == NULL){Close(); return false;}
+	m_data = MapViewOfFile(m_mapping, FILE_MAP_WRITE, 0, 0, size);
+#else
+	m_file = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(m_file == -1)return false;
+	if(ftruncate(m_file, (off_t)size) != 0){Close(); return false;}
+	void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+	m_data = (data == MAP_FAILED) ? NULL : data;
+#endif
+
+	if(m_data == NULL){Close(); return false;}
+	m_size = size;
+	m_writable = true;
+	return true;
+}
+
+bool MappedFile::Open(const std::string &path)
+{
+	Close();
+
+#ifdef WIN32
+	m_file = CreateFileW(WidePath(path).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(m_file == INVALID_HANDLE_VALUE)return false;
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(m_file, &size) || size.QuadPart == 0){Close(); return false;}
+	m_mapping = CreateFileMappingW(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(m_mapping == NULL){Close(); return false;}
+	m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	m_size = (size_t)size.QuadPart;
+#else
+	m_file = open(path.c_str(), O_RDONLY);
+	if(m_file == -1)return false;
+	struct stat st;
+	if(fstat(m_file, &st) != 0 || st.st_size == 0){Close(); return false;}
+	void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, m_file, 0);
+	m_data = (data == MAP_FAILED) ? NULL : data;
+	m_size = (size_t)st.st_size;
+#endif
+
+	if(m_data == NULL){Close(); return false;}
+	m_writable = false;
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef WIN32
+	if(m_data)
+	{
+		if(m_writable)FlushViewOfFile(m_data, 0);
+		UnmapViewOfFile(m_data);
+	}
+	if(m_mapping)CloseHandle(m_mapping);
+	if(m_file != INVALID_HANDLE_VALUE)CloseHandle(m_file);
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = NULL;
+#else
+	if(m_data)munmap(m_data, m_size);
+	if(m_file != -1)close(m_file);
+	m_file = -1;
+#endif
+	m_data = NULL;
+	m_size = 0;
+	m_writable = false;
+}
+
+// static
+size_t MappedFile::PageSize()
+{
+#ifdef WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwAllocationGranularity;
+#else
+	return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
@@ -0,0 +1,43 @@
+// MappedFile.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+// a file mapped into memory, for handing big blocks of data, like tessellated surfaces, to other processes without copying them about
+// the path is UTF-8
+
+#pragma once
+
+#include <string>
+
+class MappedFile
+{
+#ifdef WIN32
+	void* m_file;
+	void* m_mapping;
+#else
+	int m_file;
+#endif
+	void* m_data;
+	size_t m_size;
+	bool m_writable;
+
+public:
+	MappedFile();
+	~MappedFile();
+
+	// makes a new file of size bytes, replacing any old one, and maps it for writing
+	bool Create(const std::string &path, size_t size);
+
+	// maps an existing file for reading
+	bool Open(const std::string &path);
+
+	// unmaps the file; the data written to it stays in the file
+	void Close();
+
+	bool IsOpen()const{return m_data != NULL;}
+	void* Data(){return m_data;}
+	const void* Data()const{return m_data;}
+	size_t Size()const{return m_size;}
+
+	// the size of a page of memory; mapped files start on a page boundary
+	static size_t PageSize();
+};
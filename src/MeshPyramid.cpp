@@ -0,0 +1,415 @@
+// MeshPyramid.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "stdafx.h"
+#include "MeshPyramid.h"
+#include "GTriMesh.h"
+
+// levels past this are bigger than any part
+static const int max_levels = 16;
+
+// a square with this many triangles in it, or fewer, keeps them as they are
+static const unsigned int max_triangles_kept = 4;
+
+// clips a triangle to box ( minx miny maxx maxy ), putting the corners of what is left in out, x y z each, with room for 8,
+// and returns how many there are; z is interpolated along the sides, so the corners are on the triangle
+static int clip_triangle(const double *t, const double *box, double *out)
+{
+	double a[8 * 3], b[8 * 3];
+	memcpy(a, t, 9 * sizeof(double));
+	double* in = a;
+	double* clipped = b;
+	int n = 3;
+
+	for(int side = 0; side < 4 && n > 0; side++)
+	{
+		// box[0] and box[1] are minimums, box[2] and box[3] maximums
+		int axis = side % 2;
+		double sign = (side < 2) ? 1.0 : -1.0;
+		int m = 0;
+		for(int i = 0; i<n; i++)
+		{
+			const double* p = &in[i * 3];
+			const double* q = &in[((i + 1) % n) * 3];
+			double dp = (p[axis] - box[side]) * sign;
+			double dq = (q[axis] - box[side]) * sign;
+			if(dp >= 0.0)
+			{
+				memcpy(&clipped[m * 3], p, 3 * sizeof(double));
+				m++;
+			}
+			if((dp >= 0.0) != (dq >= 0.0))
+			{
+				double s = dp / (dp - dq);
+				for(int j = 0; j<3; j++)clipped[m * 3 + j] = p[j] + (q[j] - p[j]) * s;
+				m++;
+			}
+		}
+		n = m;
+		double* temp = in;
+		in = clipped;
+		clipped = temp;
+	}
+
+	if(n > 0)memcpy(out, in, n * 3 * sizeof(double));
+	return n;
+}
+
+static double polygon_area(const double *p, int n)
+{
+	double area = 0.0;
+	for(int i = 0; i<n; i++)
+	{
+		const double* p0 = &p[i * 3];
+		const double* p1 = &p[((i + 1) % n) * 3];
+		area += p0[0] * p1[1] - p1[0] * p0[1];
+	}
+	return fabs(area) * 0.5;
+}
+
+static void get_box(const double *t, double *box)
+{
+	box[0] = box[2] = t[0];
+	box[1] = box[3] = t[1];
+	for(int v = 1; v<3; v++)
+	{
+		if(t[v * 3] < box[0])box[0] = t[v * 3];
+		if(t[v * 3 + 1] < box[1])box[1] = t[v * 3 + 1];
+		if(t[v * 3] > box[2])box[2] = t[v * 3];
+		if(t[v * 3 + 1] > box[3])box[3] = t[v * 3 + 1];
+	}
+}
+
+// if (x, y) is over the triangle, or on its sides, sets z to the triangle's height there and returns true
+// triangles standing on their edges, like walls, are over nothing
+static bool height_at(const double *t, double x, double y, double &z)
+{
+	double ux = t[3] - t[0], uy = t[4] - t[1];
+	double vx = t[6] - t[0], vy = t[7] - t[1];
+	double det = ux * vy - uy * vx;
+	double scale = (ux * ux + uy * uy) * (vx * vx + vy * vy);
+	if(det * det <= scale * 0.000000000001)return false;
+
+	double px = x - t[0], py = y - t[1];
+	double s = (px * vy - py * vx) / det;
+	double r = (ux * py - uy * px) / det;
+	const double margin = -0.000000001;
+	if(s < margin || r < margin || s + r > 1.0 - margin)return false;
+
+	z = t[2] + (t[5] - t[2]) * s + (t[8] - t[2]) * r;
+	return true;
+}
+
+// the triangles of a square, sorted into a grid of cells, to find those over a point quickly
+class TriangleGrid
+{
+	const std::vector<const double*> &m_tris;
+	double m_box[4];
+	int m_n;
+	std::vector< std::vector<unsigned int> > m_cells;
+
+	int Cell(double v, int axis)const
+	{
+		double size = m_box[axis + 2] - m_box[axis];
+		int i = (size > 0.0) ? (int)((v - m_box[axis]) * m_n / size) : 0;
+		if(i < 0)i = 0;
+		if(i >= m_n)i = m_n - 1;
+		return i;
+	}
+
+public:
+	TriangleGrid(const std::vector<const double*> &tris, const double *box):m_tris(tris)
+	{
+		memcpy(m_box, box, 4 * sizeof(double));
+		m_n = (int)sqrt((double)tris.size());
+		if(m_n < 1)m_n = 1;
+		if(m_n > 128)m_n = 128;
+		m_cells.resize(m_n * m_n);
+		for(unsigned int t = 0; t < tris.size(); t++)
+		{
+			double tri_box[4];
+			get_box(tris[t], tri_box);
+			int i0 = Cell(tri_box[0], 0), i1 = Cell(tri_box[2], 0);
+			int j0 = Cell(tri_box[1], 1), j1 = Cell(tri_box[3], 1);
+			for(int i = i0; i<=i1; i++)
+			{
+				for(int j = j0; j<=j1; j++)m_cells[j * m_n + i].push_back(t);
+			}
+		}
+	}
+
+	// returns true if any of the triangles is higher than z + tolerance at (x, y)
+	bool Covered(double x, double y, double z, double tolerance)const
+	{
+		const std::vector<unsigned int> &cell = m_cells[Cell(y, 1) * m_n + Cell(x, 0)];
+		for(std::vector<unsigned int>::const_iterator It = cell.begin(); It != cell.end(); It++)
+		{
+			double tz;
+			if(height_at(m_tris[*It], x, y, tz) && tz > z + tolerance)return true;
+		}
+		return false;
+	}
+};
+
+class Decimator
+{
+	double m_error;
+	std::vector<double> &m_result;
+	std::vector<double> m_points; // the clipped triangles' corners, for the square being looked at
+	std::vector<double> m_top_points; // those of them with no triangle above them, the top of the surface that a cutter can reach
+	std::set<const double*> m_kept; // triangles already added as they are
+	bool m_overlapping; // false if no triangle's corner is under another triangle, so no points need looking for under others
+
+public:
+	Decimator(double error, std::vector<double> &result):m_error(error), m_result(result), m_overlapping(false){}
+
+	// looks for corners under other triangles, as a closed solid's bottom is, to know whether the squares need to look for them
+	void FindOverlaps(const std::vector<const double*> &tris, const double *box)
+	{
+		TriangleGrid grid(tris, box);
+		double tolerance = m_error * 0.01;
+		for(std::vector<const double*>::const_iterator It = tris.begin(); It != tris.end() && !m_overlapping; It++)
+		{
+			for(int i = 0; i<3; i++)
+			{
+				const double* p = *It + i * 3;
+				if(grid.Covered(p[0], p[1], p[2], tolerance))
+				{
+					m_overlapping = true;
+					break;
+				}
+			}
+		}
+	}
+
+	// clips the triangles to the square, filling m_points and m_top_points, and returns how many of the triangles have corners in m_top_points
+	// area is set to the area of the square covered by the top of the surface; a clipped triangle counts if its middle isn't under another
+	// the bottoms and undersides of solids are under their tops, so they don't make a square look less flat, or more covered, than its top
+	unsigned int FindTop(const std::vector<const double*> &tris, const double *box, double &area)
+	{
+		m_points.clear();
+		m_top_points.clear();
+		area = 0.0;
+		TriangleGrid* grid = m_overlapping ? new TriangleGrid(tris, box) : NULL;
+		double tolerance = m_error * 0.01;
+		unsigned int top_triangles = 0;
+		double polygon[8 * 3];
+		for(std::vector<const double*>::const_iterator It = tris.begin(); It != tris.end(); It++)
+		{
+			int n = clip_triangle(*It, box, polygon);
+			if(n == 0)continue;
+			m_points.insert(m_points.end(), polygon, polygon + n * 3);
+
+			bool top = false;
+			double middle[3] = {0.0, 0.0, 0.0};
+			for(int i = 0; i<n; i++)
+			{
+				const double* p = &polygon[i * 3];
+				for(int j = 0; j<3; j++)middle[j] += p[j] / n;
+				if(grid == NULL || !grid->Covered(p[0], p[1], p[2], tolerance))
+				{
+					m_top_points.insert(m_top_points.end(), p, p + 3);
+					top = true;
+				}
+			}
+			if(top)top_triangles++;
+			if(grid == NULL || !grid->Covered(middle[0], middle[1], middle[2], tolerance))area += polygon_area(polygon, n);
+		}
+		delete grid;
+		return top_triangles;
+	}
+
+	// z = a * (x - cx) + b * (y - cy) + c, the best fit to the top points, by least squares
+	void FitPlane(double cx, double cy, double &a, double &b, double &c)
+	{
+		int n = (int)(m_top_points.size() / 3);
+		double sxx = 0.0, sxy = 0.0, syy = 0.0, sx = 0.0, sy = 0.0, sxz = 0.0, syz = 0.0, sz = 0.0;
+		for(int i = 0; i<n; i++)
+		{
+			double x = m_top_points[i * 3] - cx;
+			double y = m_top_points[i * 3 + 1] - cy;
+			double z = m_top_points[i * 3 + 2];
+			sxx += x * x; sxy += x * y; syy += y * y;
+			sx += x; sy += y;
+			sxz += x * z; syz += y * z; sz += z;
+		}
+
+		double det = sxx * (syy * n - sy * sy) - sxy * (sxy * n - sy * sx) + sx * (sxy * sy - syy * sx);
+		double scale = (sxx + syy) * (sxx + syy) * n;
+		if(fabs(det) <= scale * 0.000000001)
+		{
+			// the points are all in a line, or all in one place
+			a = 0.0;
+			b = 0.0;
+			c = sz / n;
+			return;
+		}
+
+		a = (sxz * (syy * n - sy * sy) - sxy * (syz * n - sy * sz) + sx * (syz * sy - syy * sz)) / det;
+		b = (sxx * (syz * n - sz * sy) - sxz * (sxy * n - sy * sx) + sx * (sxy * sz - syz * sx)) / det;
+		c = (sxx * (syy * sz - sy * syz) - sxy * (sxy * sz - sy * sxz) + sx * (sxy * syz - syy * sxz)) / det;
+	}
+
+	void Split(const std::vector<const double*> &tris, const double *box)
+	{
+		double area;
+		unsigned int top_triangles = FindTop(tris, box, area);
+		if(m_top_points.size() == 0)return;
+
+		if(top_triangles <= max_triangles_kept)
+		{
+			// the surface's own triangles are never above it, and the other squares' triangles are never below it, so this can't gouge either
+			// all of them are kept, not just the top ones, in case part of one is uncovered between the points looked at
+			for(std::vector<const double*>::const_iterator It = tris.begin(); It != tris.end(); It++)
+			{
+				if(m_kept.insert(*It).second)m_result.insert(m_result.end(), *It, *It + 9);
+			}
+			return;
+		}
+
+		double cx = (box[0] + box[2]) * 0.5;
+		double cy = (box[1] + box[3]) * 0.5;
+		double a, b, c;
+		FitPlane(cx, cy, a, b, c);
+
+		// the plane has to go up to the highest point above it, of all the points, so it is above the whole surface
+		// but it only has to be near the top points to be flat
+		double min_residual = 0.0, max_residual = 0.0;
+		for(unsigned int i = 0; i < m_points.size(); i += 3)
+		{
+			double residual = m_points[i + 2] - (a * (m_points[i] - cx) + b * (m_points[i + 1] - cy) + c);
+			if(i == 0 || residual > max_residual)max_residual = residual;
+		}
+		for(unsigned int i = 0; i < m_top_points.size(); i += 3)
+		{
+			double residual = m_top_points[i + 2] - (a * (m_top_points[i] - cx) + b * (m_top_points[i + 1] - cy) + c);
+			if(i == 0 || residual < min_residual)min_residual = residual;
+		}
+
+		double width = box[2] - box[0];
+		double height = box[3] - box[1];
+		bool flat = (max_residual - min_residual <= m_error);
+
+		// a square which isn't all covered by triangles is split too, so the level doesn't stick out far past the surface's edges
+		bool covered = (area >= width * height * 0.999);
+
+		if((flat && covered) || (width <= m_error && height <= m_error))
+		{
+			double corners[4][2] = {{box[0], box[1]}, {box[2], box[1]}, {box[2], box[3]}, {box[0], box[3]}};
+			double p[4][3];
+			for(int i = 0; i<4; i++)
+			{
+				p[i][0] = corners[i][0];
+				p[i][1] = corners[i][1];
+				p[i][2] = a * (corners[i][0] - cx) + b * (corners[i][1] - cy) + c + max_residual;
+			}
+			m_result.insert(m_result.end(), p[0], p[0] + 3);
+			m_result.insert(m_result.end(), p[1], p[1] + 3);
+			m_result.insert(m_result.end(), p[2], p[2] + 3);
+			m_result.insert(m_result.end(), p[0], p[0] + 3);
+			m_result.insert(m_result.end(), p[2], p[2] + 3);
+			m_result.insert(m_result.end(), p[3], p[3] + 3);
+			return;
+		}
+
+		// split into four, or two if it is long and thin
+		int nx = (width > m_error && width * 2 > height) ? 2 : 1;
+		int ny = (height > m_error && height * 2 > width) ? 2 : 1;
+		std::vector<const double*> child_tris;
+		for(int i = 0; i<nx; i++)
+		{
+			for(int j = 0; j<ny; j++)
+			{
+				double child_box[4] = {box[0] + width * i / nx, box[1] + height * j / ny, box[0] + width * (i + 1) / nx, box[1] + height * (j + 1) / ny};
+				child_tris.clear();
+				for(std::vector<const double*>::const_iterator It = tris.begin(); It != tris.end(); It++)
+				{
+					double tri_box[4];
+					get_box(*It, tri_box);
+					if(GTriMesh::boxes_overlap(tri_box, child_box))child_tris.push_back(*It);
+				}
+				if(child_tris.size() > 0)Split(child_tris, child_box);
+			}
+		}
+	}
+};
+
+MeshPyramid::MeshPyramid(const Sources &sources, double first_error):m_sources(sources), m_first_error(first_error)
+{
+}
+
+MeshPyramid::~MeshPyramid()
+{
+	for(std::vector<GTriMesh*>::iterator It = m_levels.begin(); It != m_levels.end(); It++)delete *It;
+}
+
+double MeshPyramid::Error(int level)const
+{
+	return m_first_error * pow(4.0, level);
+}
+
+int MeshPyramid::ChooseLevel(double tool_diameter, double material_allowance)const
+{
+	double error = material_allowance * 0.5;
+	if(tool_diameter * 0.05 < error)error = tool_diameter * 0.05;
+
+	int level = -1;
+	while(level + 1 < max_levels && Error(level + 1) <= error)level++;
+	return level;
+}
+
+const GTriMesh& MeshPyramid::Level(int level)
+{
+	if((int)m_levels.size() <= level)m_levels.resize(level + 1, NULL);
+	if(m_levels[level] == NULL)
+	{
+		std::vector<double> p;
+		Decimate(m_sources, Error(level), p);
+
+		std::list<GTri> triangles;
+		for(unsigned int i = 0; i < p.size(); i += 9)triangles.push_back(GTri(&p[i]));
+		m_levels[level] = new GTriMesh(triangles);
+	}
+	return *m_levels[level];
+}
+
+// static
+void MeshPyramid::Decimate(const Sources &sources, double error, std::vector<double> &result)
+{
+	size_t result_size = result.size();
+	std::vector<const double*> tris;
+	double box[4];
+	for(Sources::const_iterator It = sources.begin(); It != sources.end(); It++)
+	{
+		for(size_t i = 0; i < It->second; i++)
+		{
+			const double* t = &It->first[i * 9];
+			double tri_box[4];
+			get_box(t, tri_box);
+			if(tris.size() == 0)
+			{
+				memcpy(box, tri_box, 4 * sizeof(double));
+			}
+			else
+			{
+				if(tri_box[0] < box[0])box[0] = tri_box[0];
+				if(tri_box[1] < box[1])box[1] = tri_box[1];
+				if(tri_box[2] > box[2])box[2] = tri_box[2];
+				if(tri_box[3] > box[3])box[3] = tri_box[3];
+			}
+			tris.push_back(t);
+		}
+	}
+	if(tris.size() == 0)return;
+
+	Decimator decimator(error, result);
+	decimator.FindOverlaps(tris, box);
+	decimator.Split(tris, box);
+
+	if(result.size() - result_size >= tris.size() * 9)
+	{
+		// it didn't make fewer triangles, so the level is the triangles themselves
+		result.resize(result_size);
+		for(std::vector<const double*>::iterator It = tris.begin(); It != tris.end(); It++)result.insert(result.end(), *It, *It + 9);
+	}
+}
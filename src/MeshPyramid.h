@@ -0,0 +1,50 @@
+// MeshPyramid.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+// coarser copies of a surface's triangles, for roughing with cutters which don't need all the detail
+// each level is made by splitting the box of the triangles into squares, like a quadtree, until the triangles in a square are within
+// the level's error of a plane, or the square is no bigger than the error; then the square gets two triangles on that plane, raised
+// to the highest point of the triangles in it, so a level is never below the surface, and a cutter dropped on it never gouges
+// only the top of the surface, which a cutter can reach, counts for whether a square is flat, or covered; the bottoms of solids are under it
+// a square with only a few triangles left on top keeps them instead, so steep walls don't make more triangles than the surface has,
+// and a level which would still have more is the surface's own triangles
+// at most it leaves the level's error more material, or, by steep walls, stops up to the error away from them
+// level i has an error of first_error * 4^i, and is made when it is first asked for
+
+#pragma once
+
+#include <vector>
+
+class GTriMesh;
+
+class MeshPyramid
+{
+public:
+	// triangles to make the levels from, nine doubles each, and how many of them there are, as for TiledMesh::Make
+	typedef std::vector< std::pair<const double*, size_t> > Sources;
+
+	// the sources must stay as they are until the levels wanted have been made
+	MeshPyramid(const Sources &sources, double first_error);
+	~MeshPyramid();
+
+	double Error(int level)const;
+
+	// the coarsest level which a cutter of tool_diameter, leaving material_allowance, can be dropped on,
+	// or -1 if it needs the triangles themselves
+	// the extra material can be up to half the allowance, and a twentieth of the tool's diameter
+	int ChooseLevel(double tool_diameter, double material_allowance)const;
+
+	// the triangles of a level, made if they haven't been already
+	const GTriMesh& Level(int level);
+
+	// makes a level's triangles, nine doubles each, adding them to result
+	static void Decimate(const Sources &sources, double error, std::vector<double> &result);
+
+private:
+	Sources m_sources;
+	double m_first_error;
+	std::vector<GTriMesh*> m_levels; // NULL for levels not made yet
+
+	MeshPyramid(const MeshPyramid &);
+	MeshPyramid& operator=(const MeshPyramid &);
+};
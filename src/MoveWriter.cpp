@@ -0,0 +1,40 @@
+// MoveWriter.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "stdafx.h"
+#include "MoveWriter.h"
+#include "Program.h"
+
+MoveWriter::MoveWriter(Python &python):m_python(python)
+{
+	for(int i = 0; i<3; i++)m_known[i] = false;
+}
+
+void MoveWriter::Move(bool feed, const double *p, bool xy)
+{
+	static const wxChar* names[3] = {_T("x="), _T("y="), _T("z=")};
+	bool first = true;
+	for(int i = xy ? 0 : 2; i<3; i++)
+	{
+		if(m_known[i] && p[i] == m_pos[i])continue;
+		if(first)m_python << (feed ? _T("feed(") : _T("rapid("));
+		else m_python << _T(", ");
+		m_python << names[i] << p[i] / theApp.m_program->m_units;
+		m_pos[i] = p[i];
+		m_known[i] = true;
+		first = false;
+	}
+	if(!first)m_python << _T(")\n");
+}
+
+void MoveWriter::RapidZ(double z)
+{
+	double p[3] = {0.0, 0.0, z};
+	Move(false, p, false);
+}
+
+void MoveWriter::FeedZ(double z)
+{
+	double p[3] = {0.0, 0.0, z};
+	Move(true, p, false);
+}
@@ -0,0 +1,24 @@
+// MoveWriter.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+// writes feed and rapid moves to the python program, for operations which work out their own cutter locations in HeeksCNC
+// the coordinates which haven't changed, and moves which don't go anywhere, are left out
+
+#pragma once
+
+class Python;
+
+class MoveWriter
+{
+	Python &m_python;
+	double m_pos[3];
+	bool m_known[3];
+
+public:
+	MoveWriter(Python &python);
+
+	// p is x y z, in mm; if xy is false only z is written
+	void Move(bool feed, const double *p, bool xy = true);
+	void RapidZ(double z);
+	void FeedZ(double z);
+};
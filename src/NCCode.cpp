@@ -34,6 +34,7 @@
 
 #include <memory>
 #include <sstream>
+#include <algorithm>
 
 int CNCCode::s_arc_interpolation_count = 20;
 
@@ -63,18 +64,61 @@ void ColouredText::ReadFromXMLElement(TiXmlElement* element)
 double PathObject::m_current_x[3] = {0, 0, 0};
 double PathObject::m_prev_x[3] = {0, 0, 0};
 
-void PathObject::WriteBaseXML(TiXmlElement *pElem)
+void PathObject::WriteXML(TiXmlNode *root)const
 {
-	pElem->SetAttribute("tool_number", m_tool_number);
+	TiXmlElement * element;
+	element = heeksCAD->NewXMLElement( (m_type == eArc) ? "arc" : "line" );
+	heeksCAD->LinkXMLEndChild( root,  element );
 
-	pElem->SetDoubleAttribute("x", m_x[0]);
-	pElem->SetDoubleAttribute("y", m_x[1]);
-	pElem->SetDoubleAttribute("z", m_x[2]);
+	if(m_type == eArc)
+	{
+		element->SetDoubleAttribute( "i", m_c[0]);
+		element->SetDoubleAttribute( "j", m_c[1]);
+		element->SetDoubleAttribute( "k", m_c[2]);
+		element->SetDoubleAttribute( "d", m_dir);
+	}
+
+	element->SetAttribute("tool_number", m_tool_number);
+
+	element->SetDoubleAttribute("x", m_x[0]);
+	element->SetDoubleAttribute("y", m_x[1]);
+	element->SetDoubleAttribute("z", m_x[2]);
 
 } // End WriteXML() method
 
-void PathObject::ReadFromXMLElement(TiXmlElement* pElem)
+void PathObject::ReadFromXMLElement(TiXmlElement* pElem, eType_t type, ColorEnum color_type)
 {
+	m_type = type;
+	m_color_type = color_type;
+	m_dir = 1;
+	m_c[0] = m_c[1] = m_c[2] = 0.0;
+
+	// get the arc's attributes
+	bool radius_set = false;
+	double radius = 0.0;
+	if(m_type == eArc)
+	{
+		if (pElem->Attribute("r"))
+		{
+			pElem->Attribute("r", &radius);
+			radius *= CNCCodeBlock::multiplier;
+			radius_set = true;
+		}
+		else
+		{
+			int dir = 1;
+			if (pElem->Attribute("i")) pElem->Attribute("i", &m_c[0]);
+			if (pElem->Attribute("j")) pElem->Attribute("j", &m_c[1]);
+			if (pElem->Attribute("k")) pElem->Attribute("k", &m_c[2]);
+			if (pElem->Attribute("d")) pElem->Attribute("d", &dir);
+			m_dir = (dir < 0) ? -1 : 1;
+
+			m_c[0] *= CNCCodeBlock::multiplier;
+			m_c[1] *= CNCCodeBlock::multiplier;
+			m_c[2] *= CNCCodeBlock::multiplier;
+		}
+	}
+
 	memcpy(m_prev_x, m_current_x, 3*sizeof(double));
 
 	double x;
@@ -92,53 +136,39 @@ void PathObject::ReadFromXMLElement(TiXmlElement* pElem)
 	{
 		m_tool_number = 0;	// No tool selected.
 	} // End if - else
-}
-
-void PathLine::WriteXML(TiXmlNode *root)
-{
-	TiXmlElement * element;
-	element = heeksCAD->NewXMLElement( "line" );
-	heeksCAD->LinkXMLEndChild( root,  element );
-
-	PathObject::WriteBaseXML(element);
-}
 
-void PathLine::ReadFromXMLElement(TiXmlElement* pElem)
-{
-	PathObject::ReadFromXMLElement(pElem);
+	if(radius_set)
+	{
+		// set ij and direction from radius
+		SetFromRadius(radius);
+	}
 }
 
-void PathLine::glVertices(const PathObject* prev_po)
+void PathObject::GetBox(CBox &box,const PathObject* prev_po)const
 {
-	if(prev_po)glVertex3dv(prev_po->m_x);
-	glVertex3dv(m_x);
-}
+	box.Insert(m_x);
 
-void PathArc::GetBox(CBox &box,const PathObject* prev_po)
-{
-	PathObject::GetBox(box,prev_po);
+	if(m_type != eArc || prev_po == NULL)return;
 
+	double radius = sqrt(m_c[0] * m_c[0] + m_c[1] * m_c[1]);
 	if(IsIncluded(gp_Pnt(0,1,0),prev_po))
-		box.Insert(prev_po->m_x[0]+m_c[0],prev_po->m_x[1]+m_c[1]+m_radius,0);
+		box.Insert(prev_po->m_x[0]+m_c[0],prev_po->m_x[1]+m_c[1]+radius,0);
 	if(IsIncluded(gp_Pnt(0,-1,0),prev_po))
-		box.Insert(prev_po->m_x[0]+m_c[0],prev_po->m_x[1]+m_c[1]-m_radius,0);
+		box.Insert(prev_po->m_x[0]+m_c[0],prev_po->m_x[1]+m_c[1]-radius,0);
 	if(IsIncluded(gp_Pnt(1,0,0),prev_po))
-		box.Insert(prev_po->m_x[0]+m_c[0]+m_radius,prev_po->m_x[1]+m_c[1],0);
+		box.Insert(prev_po->m_x[0]+m_c[0]+radius,prev_po->m_x[1]+m_c[1],0);
 	if(IsIncluded(gp_Pnt(-1,0,0),prev_po))
-		box.Insert(prev_po->m_x[0]+m_c[0]-m_radius,prev_po->m_x[1]+m_c[1],0);
+		box.Insert(prev_po->m_x[0]+m_c[0]-radius,prev_po->m_x[1]+m_c[1],0);
 
 }
 
-bool PathArc::IsIncluded(gp_Pnt pnt,const PathObject* prev_po)
+bool PathObject::IsIncluded(gp_Pnt pnt,const PathObject* prev_po)const
 {
 	double sx = -m_c[0];
 	double sy = -m_c[1];
 	// e = cs + se = -c + e - s
 	double ex = -m_c[0] + m_x[0] - prev_po->m_x[0];
 	double ey = -m_c[1] + m_x[1] - prev_po->m_x[1];
-	double rs = sqrt(sx * sx + sy * sy);
-	// double re = sqrt(ex * ex + ey * ey);
-	m_radius = rs;
 
 	double start_angle = atan2(sy, sx);
 	double end_angle = atan2(ey, ex);
@@ -161,56 +191,12 @@ bool PathArc::IsIncluded(gp_Pnt pnt,const PathObject* prev_po)
 	return (the_angle >= start_angle && the_angle <= end_angle) || (the_angle2 >= start_angle && the_angle2 <= end_angle);
 }
 
-void PathArc::WriteXML(TiXmlNode *root)
-{
-	TiXmlElement * element = heeksCAD->NewXMLElement( "arc" );
-	heeksCAD->LinkXMLEndChild( root,  element );
-
-	element->SetDoubleAttribute( "i", m_c[0]);
-	element->SetDoubleAttribute( "j", m_c[1]);
-	element->SetDoubleAttribute( "k", m_c[2]);
-	element->SetDoubleAttribute( "d", m_dir);
-
-	PathObject::WriteBaseXML(element);
-}
-
-void PathArc::ReadFromXMLElement(TiXmlElement* pElem)
-{
-	// get the attributes
-	bool radius_set = false;
-	if (pElem->Attribute("r"))
-	{
-		pElem->Attribute("r", &m_radius);
-		m_radius *= CNCCodeBlock::multiplier;
-		radius_set = true;
-	}
-	else
-	{
-		if (pElem->Attribute("i")) pElem->Attribute("i", &m_c[0]);
-		if (pElem->Attribute("j")) pElem->Attribute("j", &m_c[1]);
-		if (pElem->Attribute("k")) pElem->Attribute("k", &m_c[2]);
-		if (pElem->Attribute("d")) pElem->Attribute("d", &m_dir);
-
-		m_c[0] *= CNCCodeBlock::multiplier;
-		m_c[1] *= CNCCodeBlock::multiplier;
-		m_c[2] *= CNCCodeBlock::multiplier;
-	}
-
-	PathObject::ReadFromXMLElement(pElem);
-
-	if(radius_set)
-	{
-		// set ij and direction from radius
-		SetFromRadius();
-	}
-}
-
-void PathArc::SetFromRadius()
+void PathObject::SetFromRadius(double radius)
 {
 	// make a circle at start point and end point
 	gp_Pnt ps(m_prev_x[0], m_prev_x[1], m_prev_x[2]);
 	gp_Pnt pe(m_x[0], m_x[1], m_x[2]);
-	double r = fabs(m_radius);
+	double r = fabs(radius);
 	gp_Circ c1(gp_Ax2(ps, gp_Dir(0, 0, 1)), r);
 	gp_Circ c2(gp_Ax2(pe, gp_Dir(0, 0, 1)), r);
 	std::list<gp_Pnt> plist;
@@ -223,7 +209,7 @@ void PathArc::SetFromRadius()
 		gp_Vec right = gp_Vec(0, 0, 1).Crossed(along);
 		gp_Vec vc(p1, p2);
 		bool left = vc.Dot(right) < 0;
-		if((m_radius < 0) == left)
+		if((radius < 0) == left)
 		{
 			extract(gp_Vec(ps, p1), this->m_c);
 			this->m_dir = 1;
@@ -233,23 +219,10 @@ void PathArc::SetFromRadius()
 			extract(gp_Vec(ps, p2), this->m_c);
 			this->m_dir = -1;
 		}
-		m_radius = r;
 	}
 }
 
-void PathArc::glVertices(const PathObject* prev_po)
-{
-	if (prev_po == NULL) return;
-
-	std::list<gp_Pnt> vertices = Interpolate( prev_po, CNCCode::s_arc_interpolation_count );
-	glVertex3dv(prev_po->m_x);
-	for (std::list<gp_Pnt>::const_iterator l_itVertex = vertices.begin(); l_itVertex != vertices.end(); l_itVertex++)
-	{
-		glVertex3d(l_itVertex->X(), l_itVertex->Y(), l_itVertex->Z());
-	} // End for
-}
-
-std::list<gp_Pnt> PathArc::Interpolate( const PathObject *prev_po, const unsigned int number_of_points ) const
+std::list<gp_Pnt> PathObject::Interpolate( const PathObject *prev_po, const unsigned int number_of_points ) const
 {
 	std::list<gp_Pnt> points;
 
@@ -304,95 +277,6 @@ std::list<gp_Pnt> PathArc::Interpolate( const PathObject *prev_po, const unsigne
 	return(points);
 }
 
-ColouredPath::ColouredPath(const ColouredPath& c)
-{
-	operator=(c);
-}
-
-const ColouredPath &ColouredPath::operator=(const ColouredPath& c)
-{
-	Clear();
-	m_color_type = c.m_color_type;
-	for(std::list< PathObject* >::const_iterator It = c.m_points.begin(); It != c.m_points.end(); It++)
-	{
-		PathObject* object = *It;
-		m_points.push_back(object->MakeACopy());
-	}
-	return *this;
-}
-
-void ColouredPath::Clear()
-{
-	for(std::list< PathObject* >::iterator It = m_points.begin(); It != m_points.end(); It++)
-	{
-		PathObject* object = *It;
-		delete object;
-	}
-	m_points.clear();
-}
-
-void ColouredPath::glCommands()
-{
-	CNCCode::Color(m_color_type).glColor();
-	glBegin(GL_LINE_STRIP);
-	for(std::list< PathObject* >::iterator It = m_points.begin(); It != m_points.end(); It++)
-	{
-		PathObject* po = *It;
-		po->glVertices(CNCCode::prev_po);
-		CNCCode::prev_po = po;
-	}
-	glEnd();
-
-}
-
-void ColouredPath::GetBox(CBox &box)
-{
-	for(std::list< PathObject* >::iterator It = m_points.begin(); It != m_points.end(); It++)
-	{
-		PathObject* po= *It;
-		po->GetBox(box,CNCCode::prev_po);
-		CNCCode::prev_po = po;
-	}
-}
-
-void ColouredPath::WriteXML(TiXmlNode *root)
-{
-	TiXmlElement * element;
-	element = heeksCAD->NewXMLElement( "path" );
-	heeksCAD->LinkXMLEndChild( root,  element );
-
-	element->SetAttribute( "col", CNCCode::GetColor(m_color_type));
-	for(std::list< PathObject* >::iterator It = m_points.begin(); It != m_points.end(); It++)
-	{
-		PathObject* po = *It;
-		po->WriteXML(element);
-	}
-}
-
-void ColouredPath::ReadFromXMLElement(TiXmlElement* element)
-{
-	// get the attributes
-	m_color_type = CNCCode::GetColor(element->Attribute("col"), ColorRapidType);
-
-	// loop through all the objects
-	for(TiXmlElement* pElem = heeksCAD->FirstXMLChildElement( element ) ; pElem; pElem = pElem->NextSiblingElement())
-	{
-		std::string name(pElem->Value());
-		if(name == "line")
-		{
-			PathLine *new_object = new PathLine;
-			new_object->ReadFromXMLElement(pElem);
-			m_points.push_back(new_object);
-		}
-		else if(name == "arc")
-		{
-			PathArc *new_object = new PathArc;
-			new_object->ReadFromXMLElement(pElem);
-			m_points.push_back(new_object);
-		}
-	}
-}
-
 double CNCCodeBlock::multiplier = 1.0;
 
 HeeksObj *CNCCodeBlock::MakeACopy(void)const{return new CNCCodeBlock(*this);}
@@ -445,11 +329,10 @@ void CNCCodeBlock::glCommands(bool select, bool marked, bool no_color)
 {
 	if(marked)glLineWidth(3);
 
-	for(std::list<ColouredPath>::iterator It = m_line_strips.begin(); It != m_line_strips.end(); It++)
-	{
-		ColouredPath& line_strip = *It;
-		line_strip.glCommands();
-	}
+	m_nc_code->m_renderer.Build(m_nc_code->m_path_objects);
+	m_nc_code->m_renderer.BeginDraw();
+	m_nc_code->m_renderer.Draw(m_first_path_object, m_num_path_objects);
+	m_nc_code->m_renderer.EndDraw();
 
 	if(marked)glLineWidth(1);
 
@@ -457,10 +340,11 @@ void CNCCodeBlock::glCommands(bool select, bool marked, bool no_color)
 
 void CNCCodeBlock::GetBox(CBox &box)
 {
-	for(std::list<ColouredPath>::iterator It = m_line_strips.begin(); It != m_line_strips.end(); It++)
+	for(int i = m_first_path_object; i < m_first_path_object + m_num_path_objects; i++)
 	{
-		ColouredPath& line_strip = *It;
-		line_strip.GetBox(box);
+		const PathObject* po = &m_nc_code->m_path_objects[i];
+		po->GetBox(box,CNCCode::prev_po);
+		CNCCode::prev_po = po;
 	}
 }
 
@@ -476,20 +360,29 @@ void CNCCodeBlock::WriteXML(TiXmlNode *root)
 		text.WriteXML(element);
 	}
 
-	for(std::list<ColouredPath>::iterator It = m_line_strips.begin(); It != m_line_strips.end(); It++)
+	// a path for each run of path objects with the same colour
+	TiXmlElement * path_element = NULL;
+	for(int i = m_first_path_object; i < m_first_path_object + m_num_path_objects; i++)
 	{
-		ColouredPath &line_strip = *It;
-		line_strip.WriteXML(element);
+		const PathObject &po = m_nc_code->m_path_objects[i];
+		if(path_element == NULL || po.m_color_type != m_nc_code->m_path_objects[i - 1].m_color_type)
+		{
+			path_element = heeksCAD->NewXMLElement( "path" );
+			heeksCAD->LinkXMLEndChild( element,  path_element );
+			path_element->SetAttribute( "col", CNCCode::GetColor((ColorEnum)(po.m_color_type)));
+		}
+		po.WriteXML(path_element);
 	}
 
 	WriteBaseXML(element);
 }
 
 // static
-HeeksObj* CNCCodeBlock::ReadFromXMLElement(TiXmlElement* element)
+CNCCodeBlock* CNCCodeBlock::ReadFromXMLElement(TiXmlElement* element, CNCCode* nc_code)
 {
-	CNCCodeBlock* new_object = new CNCCodeBlock;
+	CNCCodeBlock* new_object = new CNCCodeBlock(nc_code);
 	new_object->m_from_pos = CNCCode::pos;
+	new_object->m_first_path_object = (int)nc_code->m_path_objects.size();
 
 	// loop through all the objects
 	for(TiXmlElement* pElem = heeksCAD->FirstXMLChildElement( element ) ; pElem; pElem = pElem->NextSiblingElement())
@@ -504,9 +397,16 @@ HeeksObj* CNCCodeBlock::ReadFromXMLElement(TiXmlElement* element)
 		}
 		else if(name == "path")
 		{
-			ColouredPath l;
-			l.ReadFromXMLElement(pElem);
-			new_object->m_line_strips.push_back(l);
+			ColorEnum color_type = CNCCode::GetColor(pElem->Attribute("col"), ColorRapidType);
+			for(TiXmlElement* pPathElem = heeksCAD->FirstXMLChildElement( pElem ) ; pPathElem; pPathElem = pPathElem->NextSiblingElement())
+			{
+				std::string path_name(pPathElem->Value());
+				PathObject po;
+				if(path_name == "line")po.ReadFromXMLElement(pPathElem, PathObject::eLine, color_type);
+				else if(path_name == "arc")po.ReadFromXMLElement(pPathElem, PathObject::eArc, color_type);
+				else continue;
+				nc_code->m_path_objects.push_back(po);
+			}
 		}
 		else if(name == "mode")
 		{
@@ -518,6 +418,7 @@ HeeksObj* CNCCodeBlock::ReadFromXMLElement(TiXmlElement* element)
 	if(new_object->m_text.size() > 0)CNCCode::pos++;
 
 	new_object->m_to_pos = CNCCode::pos;
+	new_object->m_num_path_objects = (int)nc_code->m_path_objects.size() - new_object->m_first_path_object;
 
 	new_object->ReadBaseXML(element);
 
@@ -536,31 +437,59 @@ void CNCCodeBlock::AppendText(wxString& str)
 	str.append(_T("\n"));
 }
 
-void CNCCodeBlock::FormatText(wxTextCtrl *textCtrl, bool highlighted, bool force_format)
+static bool pos_before_end(long pos, const CNCCodeBlock* block){return pos < block->m_to_pos;}
+
+void NCBlockIndex::Make(const std::list<CNCCodeBlock*> &blocks)
 {
-	if (m_formatted && !force_format) return;
-	int i = m_from_pos;
-	for(std::list<ColouredText>::iterator It = m_text.begin(); It != m_text.end(); It++)
+	Clear();
+
+	for(std::list<CNCCodeBlock*>::const_iterator It = blocks.begin(); It != blocks.end(); It++)
 	{
-		ColouredText &text = *It;
-		HeeksColor &col = CNCCode::Color(text.m_color_type);
-		wxColour c(col.red, col.green, col.blue);
-		int len = text.m_str.size();
-
-		wxFont font(10, wxFONTFAMILY_DEFAULT, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_NORMAL, false, _T("Lucida Console"), wxFONTENCODING_SYSTEM);
-		wxTextAttr ta(c);
-		ta.SetFont(font);
-		if(highlighted)ta.SetBackgroundColour(wxColour(218, 242, 142));
-		else ta.SetBackgroundColour(wxColour(255, 255, 255));
-		textCtrl->SetStyle(i, i+len, ta);
-		i += len;
+		CNCCodeBlock* block = *It;
+		if(block->m_text.size() == 0)continue;
+
+		for(std::list<ColouredText>::iterator TextIt = block->m_text.begin(); TextIt != block->m_text.end(); TextIt++)
+		{
+			ColouredText &text = *TextIt;
+			if(text.m_color_type != ColorBlockType)continue;
+
+			// N10, or :10
+			long n;
+			size_t i = 0;
+			while(i < text.m_str.Len() && !wxIsdigit(text.m_str[i]))i++;
+			if(text.m_str.Mid(i).Trim().ToLong(&n))m_n_numbers.push_back(std::make_pair(n, (int)m_lines.size()));
+			break;
+		}
+
+		m_lines.push_back(block);
 	}
-	m_formatted = true;
+
+	std::sort(m_n_numbers.begin(), m_n_numbers.end());
+}
+
+void NCBlockIndex::Clear()
+{
+	std::vector<CNCCodeBlock*>().swap(m_lines);
+	std::vector< std::pair<long, int> >().swap(m_n_numbers);
+}
+
+int NCBlockIndex::FindLine(long pos)const
+{
+	std::vector<CNCCodeBlock*>::const_iterator It = std::upper_bound(m_lines.begin(), m_lines.end(), pos, pos_before_end);
+	if(It == m_lines.end())return -1;
+	return (int)(It - m_lines.begin());
+}
+
+int NCBlockIndex::FindNNumber(long n)const
+{
+	std::vector< std::pair<long, int> >::const_iterator It = std::lower_bound(m_n_numbers.begin(), m_n_numbers.end(), std::make_pair(n, -1));
+	if(It == m_n_numbers.end() || It->first != n)return -1;
+	return It->second;
 }
 
 long CNCCode::pos = 0;
 // static
-PathObject* CNCCode::prev_po = NULL;
+const PathObject* CNCCode::prev_po = NULL;
 
 std::map<std::string,ColorEnum> CNCCode::m_colors_s_i;
 std::map<ColorEnum,std::string> CNCCode::m_colors_i_s;
@@ -674,7 +603,7 @@ void CNCCode::GetOptions(std::list<Property *> *list)
 	list->push_back(nc_options);
 }
 
-CNCCode::CNCCode():m_highlighted_block(NULL), m_gl_list(0), m_user_edited(false)
+CNCCode::CNCCode():m_highlighted_block(NULL), m_user_edited(false)
 {
 	CNCConfig config;
 	config.Read(_T("CNCCode_ArcInterpolationCount"), &CNCCode::s_arc_interpolation_count, 20);
@@ -693,8 +622,11 @@ const CNCCode &CNCCode::operator=(const CNCCode &rhs)
 	{
 		CNCCodeBlock* block = *It;
 		CNCCodeBlock* new_block = new CNCCodeBlock(*block);
+		new_block->m_nc_code = this;
 		m_blocks.push_back(new_block);
 	}
+	m_path_objects = rhs.m_path_objects;
+	m_block_index.Make(m_blocks);
 	return *this;
 }
 
@@ -706,6 +638,8 @@ void CNCCode::Clear()
 		delete block;
 	}
 	m_blocks.clear();
+	std::vector<PathObject>().swap(m_path_objects);
+	m_block_index.Clear();
 	DestroyGLLists();
 	m_box = CBox();
 	m_highlighted_block = NULL;
@@ -713,33 +647,44 @@ void CNCCode::Clear()
 
 void CNCCode::glCommands(bool select, bool marked, bool no_color)
 {
-	if(m_gl_list)
-	{
-		glCallList(m_gl_list);
-	}
-	else{
-		m_gl_list = glGenLists(1);
-		glNewList(m_gl_list, GL_COMPILE_AND_EXECUTE);
-
-		// render all the blocks
-		CNCCode::prev_po = NULL;
+	m_renderer.Build(m_path_objects);
+	m_renderer.BeginDraw();
 
+	if(select)
+	{
+		// a name for each block, for picking
 		for(std::list<CNCCodeBlock*>::iterator It = m_blocks.begin(); It != m_blocks.end(); It++)
 		{
 			CNCCodeBlock* block = *It;
+			if(block->m_num_path_objects == 0)continue;
 			glPushName(block->GetIndex());
-			block->glCommands(true, block == m_highlighted_block, false);
+			m_renderer.Draw(block->m_first_path_object, block->m_num_path_objects);
 			glPopName();
 		}
+	}
+	else
+	{
+		m_renderer.Draw();
 
-		glEndList();
+		// the highlighted block is drawn again over the top, thicker, so the buffers stay as they are when it changes
+		if(m_highlighted_block)
+		{
+			glPushAttrib(GL_LINE_BIT | GL_DEPTH_BUFFER_BIT);
+			glLineWidth(3);
+			glDepthFunc(GL_LEQUAL);
+			m_renderer.Draw(m_highlighted_block->m_first_path_object, m_highlighted_block->m_num_path_objects);
+			glPopAttrib();
+		}
 	}
+
+	m_renderer.EndDraw();
 }
 
 void CNCCode::GetBox(CBox &box)
 {
 	if(!m_box.m_valid)
 	{
+		CNCCode::prev_po = NULL;
 		for(std::list<CNCCodeBlock*>::iterator It = m_blocks.begin(); It != m_blocks.end(); It++)
 		{
 			CNCCodeBlock* block = *It;
@@ -812,11 +757,7 @@ void CNCCode::SetClickMarkPoint(MarkedObject* marked_object, const double* ray_s
 				if(object && object->GetType() == NCCodeBlockType)
 				{
 					SetHighlightedBlock((CNCCodeBlock*)object);
-					int from_pos = m_highlighted_block->m_from_pos;
-					int to_pos = m_highlighted_block->m_to_pos;
-					DestroyGLLists();
-					theApp.m_output_canvas->m_textCtrl->ShowPosition(from_pos);
-					theApp.m_output_canvas->m_textCtrl->SetSelection(from_pos, to_pos);
+					theApp.m_output_canvas->m_textCtrl->ShowPosition(m_highlighted_block->m_from_pos);
 				}
 			}
 		}
@@ -838,10 +779,10 @@ HeeksObj* CNCCode::ReadFromXMLElement(TiXmlElement* element)
 		std::string name(pElem->Value());
 		if(name == "ncblock")
 		{
-			HeeksObj* object = CNCCodeBlock::ReadFromXMLElement(pElem);
-			new_object->m_blocks.push_back((CNCCodeBlock*)object);
+			new_object->m_blocks.push_back(CNCCodeBlock::ReadFromXMLElement(pElem, new_object));
 		}
 	}
+	new_object->m_block_index.Make(new_object->m_blocks);
 
 	// loop through the attributes
 	int i;
@@ -857,74 +798,32 @@ HeeksObj* CNCCode::ReadFromXMLElement(TiXmlElement* element)
 
 void CNCCode::DestroyGLLists(void)
 {
-	if (m_gl_list)
-	{
-		glDeleteLists(m_gl_list, 1);
-		m_gl_list = 0;
-	}
+	m_renderer.Destroy();
 }
 
-void CNCCode::SetTextCtrl(wxTextCtrl *textCtrl)
+void CNCCode::SetTextCtrl(COutputTextCtrl *textCtrl)
 {
-	textCtrl->Clear();
-
-	textCtrl->Freeze();
-
-	wxFont font(10, wxFONTFAMILY_DEFAULT, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_NORMAL, false, _T("Lucida Console"), wxFONTENCODING_SYSTEM);
-	wxTextAttr ta;
-	ta.SetFont(font);
-	textCtrl->SetDefaultStyle(ta);
-
-	wxString str;
-	for(std::list<CNCCodeBlock*>::iterator It = m_blocks.begin(); It != m_blocks.end(); It++)
-	{
-		CNCCodeBlock* block = *It;
-		block->AppendText(str);
-	}
-	textCtrl->SetValue(str);
-
-#ifndef WIN32
-	// for Windows, this is done in COutputTextCtrl::OnPaint
-	for(std::list<CNCCodeBlock*>::iterator It = m_blocks.begin(); It != m_blocks.end(); It++)
-	{
-		CNCCodeBlock* block = *It;
-		block->FormatText(textCtrl, block == m_highlighted_block, false);
-	}
-#endif
-
-	textCtrl->Thaw();
+	// the text is drawn from m_block_index, as it is scrolled to
+	textCtrl->SetNCCode(this);
 }
 
-void CNCCode::FormatBlocks(wxTextCtrl *textCtrl, int i0, int i1)
+bool CNCCode::GoToLine(int line)
 {
-	textCtrl->Freeze();
-	for(std::list<CNCCodeBlock*>::iterator It = m_blocks.begin(); It != m_blocks.end(); It++)
-	{
-		CNCCodeBlock* block = *It;
-		if (i0 <= block->m_from_pos && block->m_from_pos <= i1)
-			block->FormatText(textCtrl, block == m_highlighted_block, false);
-	}
-	textCtrl->Thaw();
+	if(line < 1 || line > m_block_index.NumLines())return false;
+
+	SetHighlightedBlock(m_block_index.Line(line - 1));
+	theApp.m_output_canvas->m_textCtrl->ShowPosition(m_highlighted_block->m_from_pos);
+	heeksCAD->Repaint();
+	return true;
 }
 
-void CNCCode::HighlightBlock(long pos)
+bool CNCCode::GoToNNumber(long n)
 {
-	SetHighlightedBlock(NULL);
-
-	for(std::list<CNCCodeBlock*>::iterator It = m_blocks.begin(); It != m_blocks.end(); It++)
-	{
-		CNCCodeBlock* block = *It;
-		if(pos < block->m_to_pos)
-		{
-			SetHighlightedBlock(block);
-			break;
-		}
-	}
-	DestroyGLLists();
+	int line = m_block_index.FindNNumber(n);
+	if(line < 0)return false;
+	return GoToLine(line + 1);
 }
 
-
-
 static double Distance( const gp_Pnt start, const gp_Pnt end )
 {
 	double x_squared = (start.X() - end.X()) * (start.X() - end.X());
@@ -941,7 +840,7 @@ static double Distance( const gp_Pnt start, const gp_Pnt end )
 	feed rate.  We want to calculate material removal rate on a per-cutting edge
 	basis.
  */
-std::list<gp_Pnt> PathLine::Interpolate(
+std::list<gp_Pnt> PathObject::Interpolate(
 	const gp_Pnt & start_point,
 	const gp_Pnt & end_point,
 	const double feed_rate,
@@ -973,7 +872,7 @@ std::list<gp_Pnt> PathLine::Interpolate(
 } // End Interpolate() method
 
 
-std::list<gp_Pnt> PathArc::Interpolate(
+std::list<gp_Pnt> PathObject::Interpolate(
 	const PathObject *previous_point,
 	const double feed_rate,
 	const double spindle_rpm,
@@ -998,25 +897,17 @@ std::list<gp_Pnt> PathArc::Interpolate(
 } // End Interpolate() method
 
 
-std::list< std::pair<PathObject *, CTool *> > CNCCode::GetPaths() const
+std::list< std::pair<const PathObject *, CTool *> > CNCCode::GetPaths() const
 {
-	std::list< std::pair<PathObject *, CTool *> > paths;
+	std::list< std::pair<const PathObject *, CTool *> > paths;
 
-	for(std::list<CNCCodeBlock*>::const_iterator l_itCodeBlock = m_blocks.begin(); l_itCodeBlock != m_blocks.end(); l_itCodeBlock++)
+	for(std::vector<PathObject>::const_iterator l_itPoint = m_path_objects.begin(); l_itPoint != m_path_objects.end(); l_itPoint++)
 	{
-		for (std::list<ColouredPath>::const_iterator l_itColouredPath = (*l_itCodeBlock)->m_line_strips.begin();
-			l_itColouredPath != (*l_itCodeBlock)->m_line_strips.end(); l_itColouredPath++)
+		CTool *pTool = CTool::Find( l_itPoint->m_tool_number );
+		if (pTool != NULL)
 		{
-			for (std::list< PathObject* >::const_iterator l_itPoint = l_itColouredPath->m_points.begin();
-				l_itPoint != l_itColouredPath->m_points.end(); l_itPoint++)
-			{
-				CTool *pTool = CTool::Find( (*l_itPoint)->m_tool_number );
-				if (pTool != NULL)
-				{
-					paths.push_back( std::make_pair( *l_itPoint, pTool ) );
-				} // End if - then
-			} // End for
-		} // End for
+			paths.push_back( std::make_pair( &(*l_itPoint), pTool ) );
+		} // End if - then
 	} // End for
 
 	return(paths);
@@ -1024,7 +915,21 @@ std::list< std::pair<PathObject *, CTool *> > CNCCode::GetPaths() const
 
 void CNCCode::SetHighlightedBlock(CNCCodeBlock* block)
 {
-	if(m_highlighted_block)m_highlighted_block->FormatText(theApp.m_output_canvas->m_textCtrl, false, true);
 	m_highlighted_block = block;
-	if(m_highlighted_block)m_highlighted_block->FormatText(theApp.m_output_canvas->m_textCtrl, true, true);
+	theApp.m_output_canvas->m_textCtrl->Refresh();
+}
+
+void CNCCode::SetFlaggedBlocks(const std::list<CNCCodeBlock*> &blocks)
+{
+	for(std::list<CNCCodeBlock*>::iterator It = m_blocks.begin(); It != m_blocks.end(); It++)
+	{
+		CNCCodeBlock* block = *It;
+		block->m_flagged = false;
+	}
+	for(std::list<CNCCodeBlock*>::const_iterator It = blocks.begin(); It != blocks.end(); It++)
+	{
+		CNCCodeBlock* block = *It;
+		block->m_flagged = true;
+	}
+	theApp.m_output_canvas->m_textCtrl->Refresh();
 }
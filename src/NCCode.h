@@ -15,11 +15,13 @@
 #include "interface/HeeksColor.h"
 #include "HeeksCNCTypes.h"
 #include "CTool.h"
+#include "PathRenderer.h"
 
 #include <TopoDS_Shape.hxx>
 #include <gp_Pnt.hxx>
 
 #include <list>
+#include <vector>
 
 enum ColorEnum{
 	ColorDefaultType,
@@ -47,6 +49,8 @@ public:
 	void ReadFromXMLElement(TiXmlElement* pElem);
 };
 
+// a line or an arc of the backplot; a plain struct, tagged with its type, so that all of a CNCCode's moves can be kept
+// together, in order, in one array, CNCCode::m_path_objects, and each CNCCodeBlock just has the range of them it makes
 class PathObject{
 public:
 	typedef enum {
@@ -55,91 +59,52 @@ public:
 	} eType_t;
 
 public:
-	virtual ~PathObject() {}
-
 	static double m_current_x[3];
 	static double m_prev_x[3];
-	double m_x[3];
+	char m_type; // eType_t
+	char m_color_type; // ColorEnum, which colour to draw the move in
+	char m_dir; // for arcs; 1 - anti-clockwise, -1 - clockwise
 	int m_tool_number;
-	PathObject(){m_x[0] = m_x[1] = m_x[2] = 0.0;}
-	virtual int GetType() = 0; // 0 - line, 1 - arc
-	virtual void GetBox(CBox &box,const PathObject* prev_po){box.Insert(m_x);}
-
-	void WriteBaseXML(TiXmlElement *element);
+	double m_x[3];
+	double m_c[3]; // for arcs; defined relative to previous point ( span start point )
 
-	virtual void WriteXML(TiXmlNode *root) = 0;
-	virtual void ReadFromXMLElement(TiXmlElement* pElem) = 0;
-	virtual void glVertices(const PathObject* prev_po){}
-	virtual PathObject *MakeACopy(void)const = 0;
-};
+	int GetType()const{return m_type;} // 0 - line, 1 - arc
+	void GetBox(CBox &box,const PathObject* prev_po)const;
 
-class PathLine : public PathObject{
-public:
-	int GetType(){return int(PathObject::eLine);}
-	void WriteXML(TiXmlNode *root);
-	void ReadFromXMLElement(TiXmlElement* pElem);
-	void glVertices(const PathObject* prev_po);
-	PathObject *MakeACopy(void)const{return new PathLine(*this);}
+	void WriteXML(TiXmlNode *root)const;
+	void ReadFromXMLElement(TiXmlElement* pElem, eType_t type, ColorEnum color_type);
 
-	std::list<gp_Pnt> Interpolate( const gp_Pnt & start_point,
-					const gp_Pnt & end_point,
+	// for arcs
+	std::list<gp_Pnt> Interpolate( const PathObject *prev_po, const unsigned int number_of_points ) const;
+	bool IsIncluded(gp_Pnt pnt,const PathObject* prev_po)const;
+	std::list<gp_Pnt> Interpolate( const PathObject *previous_object,
 					const double feed_rate,
 					const double spindle_rpm,
 					const unsigned int number_of_cutting_edges) const;
+	void SetFromRadius(double radius);
 
-};
-
-class PathArc : public PathObject{
-public:
-	double m_c[3]; // defined relative to previous point ( span start point )
-	double m_radius;
-	int m_dir; // 1 - anti-clockwise, -1 - clockwise
-	PathArc(){m_c[0] = m_c[1] = m_c[2] = 0.0; m_dir = 1;}
-	int GetType(){return int(PathObject::eArc);}
-	void WriteXML(TiXmlNode *root);
-	void ReadFromXMLElement(TiXmlElement* pElem);
-	void glVertices(const PathObject* prev_po);
-	std::list<gp_Pnt> Interpolate( const PathObject *prev_po, const unsigned int number_of_points ) const;
-
-	PathObject *MakeACopy(void)const{return new PathArc(*this);}
-
-	void GetBox(CBox &box,const PathObject* prev_po);
-	bool IsIncluded(gp_Pnt pnt,const PathObject* prev_po);
-
-	std::list<gp_Pnt> Interpolate( const PathObject *previous_object,
+	// for lines
+	std::list<gp_Pnt> Interpolate( const gp_Pnt & start_point,
+					const gp_Pnt & end_point,
 					const double feed_rate,
 					const double spindle_rpm,
 					const unsigned int number_of_cutting_edges) const;
-	void SetFromRadius();
 };
 
-class ColouredPath
-{
-public:
-	ColorEnum m_color_type;
-	std::list< PathObject* > m_points;
-	ColouredPath():m_color_type(ColorRapidType){}
-	ColouredPath(const ColouredPath& c);
-	~ColouredPath(){Clear();}
-
-	const ColouredPath &operator=(const ColouredPath& c);
-
-	void Clear();
-	void glCommands();
-	void GetBox(CBox &box);
-	void WriteXML(TiXmlNode *root);
-	void ReadFromXMLElement(TiXmlElement* pElem);
-};
+class CNCCode;
+class COutputTextCtrl;
 
 class CNCCodeBlock:public HeeksObj
 {
 public:
 	std::list<ColouredText> m_text;
-	std::list<ColouredPath> m_line_strips;
+	CNCCode* m_nc_code; // which has the block's path objects
+	int m_first_path_object, m_num_path_objects; // the block's range of m_nc_code->m_path_objects
 	long m_from_pos, m_to_pos; // position of block in text ctrl
+	bool m_flagged; // the gouge check found a problem in this block, see GougeCheck; shown with a red background
 	static double multiplier;
 
-	CNCCodeBlock():m_from_pos(-1), m_to_pos(-1), m_formatted(false) {}
+	CNCCodeBlock(CNCCode* nc_code):m_nc_code(nc_code), m_first_path_object(0), m_num_path_objects(0), m_from_pos(-1), m_to_pos(-1), m_flagged(false) {}
 
 	void WriteNCCode(wxTextFile &f, double ox, double oy);
 
@@ -150,11 +115,29 @@ public:
 	void GetBox(CBox &box);
 	void WriteXML(TiXmlNode *root);
 
-	static HeeksObj* ReadFromXMLElement(TiXmlElement* pElem);
+	static CNCCodeBlock* ReadFromXMLElement(TiXmlElement* pElem, CNCCode* nc_code);
 	void AppendText(wxString& str);
-	void FormatText(wxTextCtrl *textCtrl, bool highlighted, bool force_format);
-private:
-	bool m_formatted;
+};
+
+// the blocks which have text, one for each line of the output window, in order, so the block at a position in the text,
+// or on a line, or with an N number, can be found by a binary search
+class NCBlockIndex
+{
+	std::vector<CNCCodeBlock*> m_lines;
+	std::vector< std::pair<long, int> > m_n_numbers; // N number and line, sorted
+
+public:
+	void Make(const std::list<CNCCodeBlock*> &blocks);
+	void Clear();
+
+	int NumLines()const{return (int)m_lines.size();}
+	CNCCodeBlock* Line(int line)const{return m_lines[line];} // from 0
+
+	// the line which has pos in it, or -1 if pos is after the end of the text
+	int FindLine(long pos)const;
+
+	// the first line with the N number, or -1 if there isn't one
+	int FindNNumber(long n)const;
 };
 
 class CNCCode:public HeeksObj
@@ -176,14 +159,16 @@ public:
 	static HeeksColor& Color(ColorEnum i) { return m_colors[i]; }
 
 	std::list<CNCCodeBlock*> m_blocks;
-	int m_gl_list;
+	std::vector<PathObject> m_path_objects; // all the blocks' moves, in order; freed all at once by Clear()
+	PathRenderer m_renderer; // draws m_path_objects
+	NCBlockIndex m_block_index; // made when the blocks are read, or copied
 	CBox m_box;
 	bool m_user_edited; // set, if the user has edited the nc code
-	static PathObject* prev_po;
+	static const PathObject* prev_po;
 	static int s_arc_interpolation_count;	// How many lines to represent an arc for the glCommands() method?
 
 	CNCCode();
-	CNCCode(const CNCCode &p):m_highlighted_block(NULL), m_gl_list(0) {operator=(p);}
+	CNCCode(const CNCCode &p):m_highlighted_block(NULL) {operator=(p);}
 	virtual ~CNCCode();
 
 	const CNCCode &operator=(const CNCCode &p);
@@ -210,11 +195,13 @@ public:
 	static void WriteColorsToConfig();
 	static void GetOptions(std::list<Property *> *list);
 
-	void DestroyGLLists(void); // not void KillGLLists(void), because I don't want the display list recreated on the Redraw button
-	void SetTextCtrl(wxTextCtrl *textCtrl);
-	void FormatBlocks(wxTextCtrl *textCtrl, int i0, int i1);
-	void HighlightBlock(long pos);
+	void DestroyGLLists(void); // not void KillGLLists(void), because I don't want the vertex buffers recreated on the Redraw button
+	void SetTextCtrl(COutputTextCtrl *textCtrl);
 	void SetHighlightedBlock(CNCCodeBlock* block);
+	CNCCodeBlock* GetHighlightedBlock()const{return m_highlighted_block;}
+	bool GoToLine(int line); // from 1, as shown in the output window
+	bool GoToNNumber(long n);
+	void SetFlaggedBlocks(const std::list<CNCCodeBlock*> &blocks); // clears the flags of the blocks which aren't in the list
 
-	std::list< std::pair<PathObject *, CTool *> > GetPaths() const;
+	std::list< std::pair<const PathObject *, CTool *> > GetPaths() const;
 };
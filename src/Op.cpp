@@ -200,10 +200,16 @@ void COp::ReadDefaultValues()
 			break;
 		case ProfileType:
 		case PocketType:
+		case WaterlineType:
 			default_tool = FIND_FIRST_TOOL( CToolParams::eEndmill );
 			if (default_tool <= 0) default_tool = FIND_FIRST_TOOL( CToolParams::eSlotCutter );
 			if (default_tool <= 0) default_tool = FIND_FIRST_TOOL( CToolParams::eBallEndMill );
 			break;
+		case RasterFinishType:
+			default_tool = FIND_FIRST_TOOL( CToolParams::eBallEndMill );
+			if (default_tool <= 0) default_tool = FIND_FIRST_TOOL( CToolParams::eEndmill );
+			if (default_tool <= 0) default_tool = FIND_FIRST_TOOL( CToolParams::eSlotCutter );
+			break;
 
 		default:
 			default_tool = FIND_FIRST_TOOL( CToolParams::eEndmill );
@@ -44,6 +44,7 @@ public:
 
 	virtual Python AppendTextToProgram();
 	virtual bool UsesTool(){return true;} // some operations don't use the tool number
+	virtual bool AttachesToSurface(){return true;} // operations which drop the cutter onto m_surface themselves don't have their moves attached to it again
 
 	void ReloadPointers() { ObjList::ReloadPointers(); }
 
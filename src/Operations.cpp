@@ -140,6 +140,8 @@ bool COperations::IsAnOperation(int object_type)
 		case PocketType:
 		case DrillingType:
 		case ScriptOpType:
+		case RasterFinishType:
+		case WaterlineType:
 			return true;
 		default:
 			return theApp.m_external_op_types.find(object_type) != theApp.m_external_op_types.end();
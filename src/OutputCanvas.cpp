@@ -10,57 +10,352 @@
 #include "Program.h"
 #include "NCCode.h"
 
-BEGIN_EVENT_TABLE(COutputTextCtrl, wxTextCtrl)
+BEGIN_EVENT_TABLE(COutputTextCtrl, wxScrolledWindow)
     EVT_MOUSE_EVENTS(COutputTextCtrl::OnMouse)
 	EVT_PAINT(COutputTextCtrl::OnPaint)
+	EVT_KEY_DOWN(COutputTextCtrl::OnKeyDown)
 END_EVENT_TABLE()
 
-void COutputTextCtrl::OnMouse( wxMouseEvent& event )
+COutputTextCtrl::COutputTextCtrl(wxWindow *parent, wxWindowID id, const wxPoint &pos, const wxSize &size)
+	: wxScrolledWindow(parent, id, pos, size, wxHSCROLL | wxVSCROLL | wxWANTS_CHARS | wxBORDER_SUNKEN), m_nc_code_shown(false), m_max_line_length(0), m_line_height(1), m_char_width(1)
 {
-	if(event.LeftUp())
+	SetBackgroundColour(*wxWHITE);
+	SetFont(wxFont(10, wxFONTFAMILY_MODERN, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_NORMAL, false, _T("Lucida Console"), wxFONTENCODING_SYSTEM));
+}
+
+CNCCode* COutputTextCtrl::ShownNCCode()
+{
+	if(m_nc_code_shown && theApp.m_program)return theApp.m_program->NCCode();
+	return NULL;
+}
+
+void COutputTextCtrl::UpdateVirtualSize()
+{
+	SetScrollRate(m_char_width, m_line_height);
+	SetVirtualSize((m_max_line_length + 1) * m_char_width, GetNumberOfLines() * m_line_height);
+	Refresh();
+}
+
+bool COutputTextCtrl::SetFont(const wxFont &font)
+{
+	if(!wxScrolledWindow::SetFont(font))return false;
+
+	// the font is fixed width, so the lines don't need measuring
+	wxClientDC dc(this);
+	dc.SetFont(font);
+	m_line_height = dc.GetCharHeight();
+	m_char_width = dc.GetCharWidth();
+	if(m_line_height < 1)m_line_height = 1;
+	if(m_char_width < 1)m_char_width = 1;
+	UpdateVirtualSize();
+	return true;
+}
+
+void COutputTextCtrl::Clear()
+{
+	m_nc_code_shown = false;
+	m_file.Close();
+	std::vector<size_t>().swap(m_file_lines);
+	m_lines.clear();
+	m_max_line_length = 0;
+	Scroll(0, 0);
+	UpdateVirtualSize();
+}
+
+void COutputTextCtrl::AppendText(const wxString &str)
+{
+	if(m_nc_code_shown || m_file.IsOpen())Clear();
+
+	if(m_lines.size() == 0)m_lines.push_back(wxEmptyString);
+	for(size_t i = 0; i < str.Len(); i++)
 	{
-		wxTextPos pos = GetInsertionPoint();
-		if(theApp.m_program && theApp.m_program->NCCode())
+		if(str[i] == '\n')m_lines.push_back(wxEmptyString);
+		else
 		{
-			theApp.m_program->NCCode()->HighlightBlock(pos);
-			heeksCAD->Repaint();
+			m_lines.back() += str[i];
+			if((int)m_lines.back().Len() > m_max_line_length)m_max_line_length = m_lines.back().Len();
 		}
 	}
+	UpdateVirtualSize();
+}
 
-	event.Skip();
+bool COutputTextCtrl::ShowFile(const wxString &path)
+{
+	Clear();
+	if(!m_file.Open(std::string(path.utf8_str())))return false;
+
+	const char* data = (const char*)m_file.Data();
+	size_t size = m_file.Size();
+	m_file_lines.push_back(0);
+	const char* p = data;
+	while(p < data + size)
+	{
+		const char* end = (const char*)memchr(p, '\n', data + size - p);
+		if(end == NULL)end = data + size;
+		if(end - p > m_max_line_length)m_max_line_length = (int)(end - p);
+		m_file_lines.push_back(end + 1 - data);
+		p = end + 1;
+	}
+
+	UpdateVirtualSize();
+	return true;
 }
 
-bool painting = false;
-void COutputTextCtrl::OnPaint(wxPaintEvent& event)
+// bigger files than this are cleared from the window by ReleaseFile, rather than being read into memory
+static const size_t max_released_file_size = 8 * 1024 * 1024;
+
+void COutputTextCtrl::ReleaseFile()
 {
-	// this is here to Format the text ( which seems to be slow in Windows, if all done at once in CNCCode::SetTextCtrl )
-	// OnPaint doesn't seem to get called from Linux, though
-	wxPaintDC dc(this);
+	if(!m_file.IsOpen())return;
+
+	std::vector<wxString> lines;
+	if(m_file.Size() <= max_released_file_size)
+	{
+		int num_lines = (int)m_file_lines.size() - 1;
+		lines.reserve(num_lines);
+		for(int i = 0; i < num_lines; i++)lines.push_back(GetLineText(i));
+	}
+
+	m_file.Close();
+	std::vector<size_t>().swap(m_file_lines);
+	m_lines.swap(lines);
+	if(m_lines.size() == 0)
+	{
+		m_max_line_length = 0;
+		Scroll(0, 0);
+	}
+	UpdateVirtualSize();
+}
+
+void COutputTextCtrl::SetNCCode(CNCCode* nc_code)
+{
+	Clear();
+	m_nc_code_shown = true;
+
+	for(int i = 0; i < nc_code->m_block_index.NumLines(); i++)
+	{
+		CNCCodeBlock* block = nc_code->m_block_index.Line(i);
+		if(block->m_to_pos - block->m_from_pos > m_max_line_length)m_max_line_length = block->m_to_pos - block->m_from_pos;
+	}
+
+	SetScrollRate(m_char_width, m_line_height);
+	SetVirtualSize((m_max_line_length + 1) * m_char_width, nc_code->m_block_index.NumLines() * m_line_height);
+	Refresh();
+}
+
+int COutputTextCtrl::GetNumberOfLines()
+{
+	CNCCode* nc_code = ShownNCCode();
+	if(nc_code)return nc_code->m_block_index.NumLines();
+	if(m_file.IsOpen())return (int)m_file_lines.size() - 1;
+	return (int)m_lines.size();
+}
+
+wxString COutputTextCtrl::GetLineText(long line)
+{
+	CNCCode* nc_code = ShownNCCode();
+	if(nc_code)
+	{
+		wxString str;
+		CNCCodeBlock* block = nc_code->m_block_index.Line(line);
+		for(std::list<ColouredText>::iterator It = block->m_text.begin(); It != block->m_text.end(); It++)str.append(It->m_str);
+		return str;
+	}
+
+	if(m_file.IsOpen())
+	{
+		const char* data = (const char*)m_file.Data();
+		size_t start = m_file_lines[line];
+		size_t end = m_file_lines[line + 1] - 1;
+		if(end > start && data[end - 1] == '\r')end--;
+		wxString str = wxString::FromUTF8(data + start, end - start);
+		if(str.Len() == 0 && end > start)str = wxString::From8BitData(data + start, end - start);
+		return str;
+	}
+
+	return m_lines[line];
+}
 
-	if (!painting && theApp.m_program && theApp.m_program->NCCode())
+wxString COutputTextCtrl::GetValue()
+{
+	CNCCode* nc_code = ShownNCCode();
+	if(nc_code)
 	{
-		painting = true;
+		wxString str;
+		for(int i = 0; i < nc_code->m_block_index.NumLines(); i++)nc_code->m_block_index.Line(i)->AppendText(str);
+		return str;
+	}
 
-		wxSize size = GetClientSize();
-		int scrollpos = GetScrollPos(wxVERTICAL);
-		wxLogDebug(_T("%i"), scrollpos);
+	if(m_file.IsOpen())
+	{
+		wxString str = wxString::FromUTF8((const char*)m_file.Data(), m_file.Size());
+		if(str.Len() == 0)str = wxString::From8BitData((const char*)m_file.Data(), m_file.Size());
+		return str;
+	}
 
-		wxTextCoord col0, row0, col1, row1;
-		HitTest(wxPoint(0,0),      &col0, &row0);
-		HitTest(wxPoint(0,0)+size, &col1, &row1);
+	wxString str;
+	for(unsigned int i = 0; i < m_lines.size(); i++)
+	{
+		if(i > 0)str.append(_T("\n"));
+		str.append(m_lines[i]);
+	}
+	return str;
+}
 
-		int pos0 = XYToPosition(0, row0);
-		int pos1 = XYToPosition(1, row1);
+void COutputTextCtrl::ShowPosition(long pos)
+{
+	CNCCode* nc_code = ShownNCCode();
+	if(nc_code == NULL)return;
+	int line = nc_code->m_block_index.FindLine(pos);
+	if(line >= 0)ShowLine(line);
+}
 
-		theApp.m_program->NCCode()->FormatBlocks(this, pos0, pos1);
+void COutputTextCtrl::ShowLine(int line)
+{
+	int x, first;
+	GetViewStart(&x, &first);
+	int num_visible = GetClientSize().y / m_line_height;
+	if(line >= first && line < first + num_visible)return;
+
+	// put it in the middle
+	first = line - num_visible / 2;
+	if(first < 0)first = 0;
+	Scroll(-1, first);
+}
 
-		SetScrollPos(wxVERTICAL, scrollpos);
+void COutputTextCtrl::OnMouse( wxMouseEvent& event )
+{
+	if(event.LeftDown())SetFocus();
 
-		painting = false;
+	if(event.LeftUp())
+	{
+		CNCCode* nc_code = ShownNCCode();
+		if(nc_code)
+		{
+			wxPoint point = CalcUnscrolledPosition(event.GetPosition());
+			int line = point.y / m_line_height;
+			if(line >= 0 && line < nc_code->m_block_index.NumLines())
+			{
+				nc_code->SetHighlightedBlock(nc_code->m_block_index.Line(line));
+				heeksCAD->Repaint();
+			}
+		}
 	}
+
 	event.Skip();
 }
 
+void COutputTextCtrl::OnKeyDown(wxKeyEvent& event)
+{
+	if(event.ControlDown() && event.GetKeyCode() == 'G')
+	{
+		theApp.m_output_canvas->GoTo();
+		return;
+	}
+
+	int x, first;
+	GetViewStart(&x, &first);
+	int num_visible = GetClientSize().y / m_line_height;
+	int scroll_to = first;
+
+	switch(event.GetKeyCode())
+	{
+	case WXK_UP:
+	case WXK_DOWN:
+		{
+			// step through the NC code
+			int step = (event.GetKeyCode() == WXK_UP) ? -1 : 1;
+			CNCCode* nc_code = ShownNCCode();
+			if(nc_code && nc_code->GetHighlightedBlock())
+			{
+				int line = nc_code->m_block_index.FindLine(nc_code->GetHighlightedBlock()->m_from_pos);
+				nc_code->GoToLine(line + 1 + step);
+				return;
+			}
+			scroll_to = first + step;
+		}
+		break;
+	case WXK_PAGEUP:
+		scroll_to = first - num_visible;
+		break;
+	case WXK_PAGEDOWN:
+		scroll_to = first + num_visible;
+		break;
+	case WXK_HOME:
+		scroll_to = 0;
+		break;
+	case WXK_END:
+		scroll_to = GetNumberOfLines() - num_visible;
+		break;
+	default:
+		event.Skip();
+		return;
+	}
+
+	if(scroll_to < 0)scroll_to = 0;
+	Scroll(-1, scroll_to);
+}
+
+void COutputTextCtrl::OnPaint(wxPaintEvent& event)
+{
+	wxPaintDC dc(this);
+	DoPrepareDC(dc);
+	dc.SetFont(GetFont());
+	dc.SetBackgroundMode(wxTRANSPARENT);
+	dc.SetPen(*wxTRANSPARENT_PEN);
+
+	// just the lines which can be seen
+	int x, first;
+	GetViewStart(&x, &first);
+	int last = first + GetClientSize().y / m_line_height + 2;
+	if(last > GetNumberOfLines())last = GetNumberOfLines();
+	int width = (x + m_max_line_length + 1) * m_char_width + GetClientSize().x;
+
+	CNCCode* nc_code = ShownNCCode();
+	if(nc_code)
+	{
+		// a colour for each colour type, set only where a line changes colour
+		std::vector<wxColour> colours(CNCCode::ColorCount());
+		for(int i = 0; i < CNCCode::ColorCount(); i++)
+		{
+			HeeksColor &col = CNCCode::Color((ColorEnum)i);
+			colours[i] = wxColour(col.red, col.green, col.blue);
+		}
+		wxBrush highlighted_brush(wxColour(218, 242, 142));
+		wxBrush flagged_brush(wxColour(255, 190, 190));
+
+		int colour_type = -1;
+		for(int line = first; line < last; line++)
+		{
+			CNCCodeBlock* block = nc_code->m_block_index.Line(line);
+			int y = line * m_line_height;
+			if(block == nc_code->GetHighlightedBlock() || block->m_flagged)
+			{
+				dc.SetBrush((block == nc_code->GetHighlightedBlock()) ? highlighted_brush : flagged_brush);
+				dc.DrawRectangle(0, y, width, m_line_height);
+			}
+
+			int text_x = 0;
+			for(std::list<ColouredText>::iterator It = block->m_text.begin(); It != block->m_text.end(); It++)
+			{
+				ColouredText &text = *It;
+				if(text.m_color_type != colour_type)
+				{
+					colour_type = text.m_color_type;
+					dc.SetTextForeground(colours[colour_type]);
+				}
+				dc.DrawText(text.m_str, text_x, y);
+				text_x += text.m_str.Len() * m_char_width;
+			}
+		}
+	}
+	else
+	{
+		dc.SetTextForeground(*wxBLACK);
+		for(int line = first; line < last; line++)dc.DrawText(GetLineText(line), 0, line * m_line_height);
+	}
+}
+
 BEGIN_EVENT_TABLE(COutputCanvas, wxScrolledWindow)
     EVT_SIZE(COutputCanvas::OnSize)
 END_EVENT_TABLE()
@@ -70,14 +365,7 @@ COutputCanvas::COutputCanvas(wxWindow* parent)
         : wxScrolledWindow(parent, wxID_ANY, wxDefaultPosition, wxDefaultSize,
                            wxHSCROLL | wxVSCROLL | wxNO_FULL_REPAINT_ON_RESIZE)
 {
-	m_textCtrl = new COutputTextCtrl( this, 100, _T(""),	wxPoint(180,170), wxSize(200,70), wxTE_MULTILINE | wxTE_DONTWRAP | wxTE_RICH | wxTE_RICH2);
-
-#ifdef WIN32
-	// Ensure the wxTextCtrl object can accept the maximum 
-	// text length allowable for this operating system.
-	// (64kb on Win32) (32kb without this call on Win32)
-	m_textCtrl->SetMaxLength( 0 );
-#endif
+	m_textCtrl = new COutputTextCtrl( this, 100, wxPoint(180,170), wxSize(200,70));
 
 	Resize();
 }
@@ -103,6 +391,26 @@ void COutputCanvas::Clear()
 	m_textCtrl->Clear();
 }
 
+void COutputCanvas::GoTo()
+{
+	if(theApp.m_program == NULL || theApp.m_program->NCCode() == NULL)return;
+
+	wxString str = wxGetTextFromUser(_("Enter a line number, or an N number, like N120"), _("Go To"), wxEmptyString, this);
+	str.Trim().Trim(false);
+	if(str.Len() == 0)return;
+
+	bool n_number = (str[0] == 'N' || str[0] == 'n');
+	long i;
+	if(!str.Mid(n_number ? 1 : 0).ToLong(&i))
+	{
+		wxMessageBox(_("Not a line number"));
+		return;
+	}
+
+	bool found = n_number ? theApp.m_program->NCCode()->GoToNNumber(i) : theApp.m_program->NCCode()->GoToLine((int)i);
+	if(!found)wxMessageBox(n_number ? wxString(_("There isn't a block with that N number")) : wxString(_("There isn't a line with that number")));
+}
+
 
 BEGIN_EVENT_TABLE(CPrintCanvas, wxScrolledWindow)
     EVT_SIZE(CPrintCanvas::OnSize)
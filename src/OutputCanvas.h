@@ -7,13 +7,48 @@
 
 #pragma once
 
-class COutputTextCtrl: public wxTextCtrl
+#include "MappedFile.h"
+
+class CNCCode;
+
+// the output window's text; only the lines which can be seen are drawn, so it doesn't matter how long the text is
+// it shows one of: the program's NC code, a line for each NCBlockIndex line; an NC file, mapped into memory, while it is backplotted;
+// or plain text, like the python program's errors
+class COutputTextCtrl: public wxScrolledWindow
 {
+	bool m_nc_code_shown; // the program's NC code
+	MappedFile m_file;
+	std::vector<size_t> m_file_lines; // where each line of the file starts, and one more after the end
+	std::vector<wxString> m_lines; // the plain text
+	int m_max_line_length; // in characters
+	int m_line_height;
+	int m_char_width;
+
+	CNCCode* ShownNCCode();
+	void UpdateVirtualSize();
+
 public:
-    COutputTextCtrl(wxWindow *parent, wxWindowID id, const wxString &value, const wxPoint &pos, const wxSize &size, int style = 0): wxTextCtrl(parent, id, value, pos, size, style){}
+    COutputTextCtrl(wxWindow *parent, wxWindowID id, const wxPoint &pos, const wxSize &size);
+
+	void Clear();
+	void AppendText(const wxString &str);
+	bool ShowFile(const wxString &path); // shows the file, until the NC code from it is ready
+	void ReleaseFile(); // unmaps the file, so it can be written again; its text is kept as plain text, unless it is too big
+	void SetNCCode(CNCCode* nc_code);
+
+	int GetNumberOfLines();
+	wxString GetLineText(long line);
+	wxString GetValue();
+
+	void ShowPosition(long pos); // scrolls to the NC code's line with the text position in it
+	void ShowLine(int line);
+
+	// wxWindow's virtual functions
+	bool SetFont(const wxFont &font);
 
     void OnMouse( wxMouseEvent& event );
 	void OnPaint(wxPaintEvent& event);
+	void OnKeyDown(wxKeyEvent& event);
 
     DECLARE_NO_COPY_CLASS(COutputTextCtrl)
     DECLARE_EVENT_TABLE()
@@ -31,6 +66,7 @@ public:
 	virtual ~COutputCanvas(){}
 
 	void Clear();
+	void GoTo(); // asks for a line, or an N number, and highlights its block
 
     void OnSize(wxSizeEvent& event);
 	void OnLengthExceeded(wxCommandEvent& event);
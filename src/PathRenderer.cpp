@@ -0,0 +1,220 @@
+// PathRenderer.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "stdafx.h"
+#include "PathRenderer.h"
+#include "NCCode.h"
+
+#include <stddef.h>
+
+// the OpenGL 1.5 buffer functions, got when they are first needed, because gl.h only has OpenGL 1.1
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER 0x8892
+#endif
+#ifndef GL_STATIC_DRAW
+#define GL_STATIC_DRAW 0x88E4
+#endif
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+typedef void (APIENTRY *GenBuffersProc)(GLsizei n, GLuint *buffers);
+typedef void (APIENTRY *DeleteBuffersProc)(GLsizei n, const GLuint *buffers);
+typedef void (APIENTRY *BindBufferProc)(GLenum target, GLuint buffer);
+typedef void (APIENTRY *BufferDataProc)(GLenum target, ptrdiff_t size, const void *data, GLenum usage);
+typedef void (APIENTRY *BufferSubDataProc)(GLenum target, ptrdiff_t offset, ptrdiff_t size, const void *data);
+
+static GenBuffersProc gen_buffers = NULL;
+static DeleteBuffersProc delete_buffers = NULL;
+static BindBufferProc bind_buffer = NULL;
+static BufferDataProc buffer_data = NULL;
+static BufferSubDataProc buffer_sub_data = NULL;
+
+#ifdef WIN32
+static void* GetGLProc(const char* name){return (void*)wglGetProcAddress(name);}
+#elif defined(__APPLE__)
+static void* GetGLProc(const char* name){return NULL;} // draw from memory
+#else
+extern "C" void (*glXGetProcAddressARB(const GLubyte *name))(void);
+static void* GetGLProc(const char* name){return (void*)glXGetProcAddressARB((const GLubyte*)name);}
+#endif
+
+static bool BuffersAvailable()
+{
+	static bool tried = false;
+	if(!tried)
+	{
+		// needs the context to be current
+		tried = true;
+		const char* version = (const char*)glGetString(GL_VERSION);
+		const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+		bool available = (version != NULL && (version[0] > '1' || (version[0] == '1' && version[2] >= '5'))) || (extensions != NULL && strstr(extensions, "GL_ARB_vertex_buffer_object") != NULL);
+		if(available)
+		{
+			gen_buffers = (GenBuffersProc)GetGLProc("glGenBuffersARB");
+			delete_buffers = (DeleteBuffersProc)GetGLProc("glDeleteBuffersARB");
+			bind_buffer = (BindBufferProc)GetGLProc("glBindBufferARB");
+			buffer_data = (BufferDataProc)GetGLProc("glBufferDataARB");
+			buffer_sub_data = (BufferSubDataProc)GetGLProc("glBufferSubDataARB");
+		}
+		if(gen_buffers == NULL || delete_buffers == NULL || bind_buffer == NULL || buffer_data == NULL || buffer_sub_data == NULL)gen_buffers = NULL;
+	}
+	return gen_buffers != NULL;
+}
+
+PathRenderer::PathRenderer():m_num_vertices(0), m_arc_interpolation_count(0), m_built(false)
+{
+	m_buffers[0] = m_buffers[1] = 0;
+}
+
+PathRenderer::~PathRenderer()
+{
+	// the buffers are left to the context, if Destroy wasn't called
+}
+
+void PathRenderer::Build(const std::vector<PathObject> &path_objects)
+{
+	if(m_built && m_arc_interpolation_count == CNCCode::s_arc_interpolation_count)return;
+	Destroy();
+
+	m_arc_interpolation_count = CNCCode::s_arc_interpolation_count;
+	m_first_vertex.resize(path_objects.size() + 1);
+
+	const PathObject* prev_po = NULL;
+	for(unsigned int i = 0; i < path_objects.size(); i++)
+	{
+		const PathObject* po = &path_objects[i];
+		m_first_vertex[i] = (int)m_color_types.size();
+
+		if(po->m_type == PathObject::eArc && prev_po != NULL)
+		{
+			std::list<gp_Pnt> points = po->Interpolate(prev_po, m_arc_interpolation_count);
+			points.pop_front(); // the start of the arc is the last vertex
+			for(std::list<gp_Pnt>::iterator It = points.begin(); It != points.end(); It++)
+			{
+				m_vertices.push_back((float)It->X());
+				m_vertices.push_back((float)It->Y());
+				m_vertices.push_back((float)It->Z());
+				m_color_types.push_back(po->m_color_type);
+			}
+		}
+		else
+		{
+			m_vertices.push_back((float)po->m_x[0]);
+			m_vertices.push_back((float)po->m_x[1]);
+			m_vertices.push_back((float)po->m_x[2]);
+			m_color_types.push_back(po->m_color_type);
+		}
+		prev_po = po;
+	}
+	m_num_vertices = (int)m_color_types.size();
+	m_first_vertex[path_objects.size()] = m_num_vertices;
+
+	MakeColors();
+
+	if(m_num_vertices > 0 && BuffersAvailable())
+	{
+		gen_buffers(2, m_buffers);
+		bind_buffer(GL_ARRAY_BUFFER, m_buffers[0]);
+		buffer_data(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(float), &m_vertices[0], GL_STATIC_DRAW);
+		bind_buffer(GL_ARRAY_BUFFER, m_buffers[1]);
+		buffer_data(GL_ARRAY_BUFFER, m_colors.size(), &m_colors[0], GL_STATIC_DRAW);
+		bind_buffer(GL_ARRAY_BUFFER, 0);
+
+		std::vector<float>().swap(m_vertices);
+		std::vector<unsigned char>().swap(m_colors);
+	}
+
+	m_built = true;
+}
+
+void PathRenderer::MakeColors()
+{
+	m_palette.resize(CNCCode::ColorCount());
+	for(int i = 0; i < CNCCode::ColorCount(); i++)m_palette[i] = CNCCode::Color((ColorEnum)i).COLORREF_color();
+
+	m_colors.resize(m_num_vertices * 4);
+	for(int i = 0; i < m_num_vertices; i++)
+	{
+		HeeksColor &col = CNCCode::Color((ColorEnum)(m_color_types[i]));
+		m_colors[i * 4] = col.red;
+		m_colors[i * 4 + 1] = col.green;
+		m_colors[i * 4 + 2] = col.blue;
+		m_colors[i * 4 + 3] = 255;
+	}
+}
+
+void PathRenderer::BeginDraw()
+{
+	// send the colours again, if they have been changed in the options
+	bool colors_changed = ((int)m_palette.size() != CNCCode::ColorCount());
+	for(unsigned int i = 0; !colors_changed && i < m_palette.size(); i++)
+	{
+		if(m_palette[i] != CNCCode::Color((ColorEnum)i).COLORREF_color())colors_changed = true;
+	}
+	if(colors_changed)
+	{
+		MakeColors();
+		if(m_buffers[1])
+		{
+			bind_buffer(GL_ARRAY_BUFFER, m_buffers[1]);
+			buffer_sub_data(GL_ARRAY_BUFFER, 0, m_colors.size(), &m_colors[0]);
+			bind_buffer(GL_ARRAY_BUFFER, 0);
+			std::vector<unsigned char>().swap(m_colors);
+		}
+	}
+
+	glPushAttrib(GL_LIGHTING_BIT);
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	glShadeModel(GL_FLAT); // each line has the colour of its end
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	if(m_buffers[0])
+	{
+		bind_buffer(GL_ARRAY_BUFFER, m_buffers[0]);
+		glVertexPointer(3, GL_FLOAT, 0, NULL);
+		bind_buffer(GL_ARRAY_BUFFER, m_buffers[1]);
+		glColorPointer(4, GL_UNSIGNED_BYTE, 0, NULL);
+		bind_buffer(GL_ARRAY_BUFFER, 0);
+	}
+	else if(m_num_vertices > 0)
+	{
+		glVertexPointer(3, GL_FLOAT, 0, &m_vertices[0]);
+		glColorPointer(4, GL_UNSIGNED_BYTE, 0, &m_colors[0]);
+	}
+}
+
+void PathRenderer::EndDraw()
+{
+	glPopClientAttrib();
+	glPopAttrib();
+}
+
+void PathRenderer::Draw()
+{
+	if(m_num_vertices > 0)glDrawArrays(GL_LINE_STRIP, 0, m_num_vertices);
+}
+
+void PathRenderer::Draw(int first_path_object, int num_path_objects)
+{
+	if(num_path_objects <= 0)return;
+	int first = m_first_vertex[first_path_object];
+	if(first > 0)first--; // from the end of the one before
+	int count = m_first_vertex[first_path_object + num_path_objects] - first;
+	if(count > 0)glDrawArrays(GL_LINE_STRIP, first, count);
+}
+
+void PathRenderer::Destroy()
+{
+	if(m_buffers[0])
+	{
+		delete_buffers(2, m_buffers);
+		m_buffers[0] = m_buffers[1] = 0;
+	}
+	std::vector<float>().swap(m_vertices);
+	std::vector<unsigned char>().swap(m_color_types);
+	std::vector<unsigned char>().swap(m_colors);
+	std::vector<int>().swap(m_first_vertex);
+	m_num_vertices = 0;
+	m_built = false;
+}
@@ -0,0 +1,54 @@
+// PathRenderer.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+// draws a CNCCode's path objects from vertex buffers, instead of with a display list
+// the moves make one line strip through the whole program, arcs split into lines; the vertices' positions are floats, and each vertex
+// has the colour of the line which ends at it, drawn with flat shading, so the whole backplot is one draw call
+// the buffers are made the first time they are drawn, and only the colours are sent again when the colours are changed
+// where the OpenGL buffer functions aren't available the same arrays are drawn from memory
+
+#pragma once
+
+#include <vector>
+
+class PathObject;
+
+class PathRenderer
+{
+	std::vector<float> m_vertices; // x y z for each vertex; emptied once they are in a buffer
+	std::vector<unsigned char> m_color_types; // for each vertex, the ColorEnum of the line which ends at it
+	std::vector<unsigned char> m_colors; // r g b a for each vertex, from m_color_types; emptied once they are in a buffer
+	std::vector<int> m_first_vertex; // for each path object, its first vertex, and the number of vertices at the end
+	std::vector<long> m_palette; // the colours m_colors was made with
+	unsigned int m_buffers[2]; // positions and colours, or 0 if they are drawn from memory
+	int m_num_vertices;
+	int m_arc_interpolation_count; // what the arcs were split with
+	bool m_built;
+
+	PathRenderer(const PathRenderer &);
+	PathRenderer& operator=(const PathRenderer &);
+
+	void MakeColors();
+
+public:
+	PathRenderer();
+	~PathRenderer();
+
+	// makes the vertices for the path objects, if they aren't made already, or the arcs need splitting differently
+	void Build(const std::vector<PathObject> &path_objects);
+
+	// set up the arrays for drawing, sending the colours again if they have changed; the draws must go between these
+	void BeginDraw();
+	void EndDraw();
+
+	// draws all the path objects
+	void Draw();
+
+	// draws a range of the path objects, with the line to the first one from the one before it
+	void Draw(int first_path_object, int num_path_objects);
+
+	// frees the buffers and the vertices, so the next Build makes them again; needs the OpenGL context
+	void Destroy();
+
+	bool Built()const{return m_built;}
+};
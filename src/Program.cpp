@@ -32,11 +32,14 @@
 #include "interface/strconv.h"
 #include "Pattern.h"
 #include "Surface.h"
+#include "SurfaceMesh.h"
+#include "TessellationCache.h"
 #include "Stock.h"
 #include "ProgramDlg.h"
 
 #include <wx/stdpaths.h>
 #include <wx/filename.h>
+#include <wx/dir.h>
 
 #include <vector>
 #include <algorithm>
@@ -550,31 +553,45 @@ void ApplySurfaceToText(Python &python, CSurface* surface, std::set<CSurface*> &
 	if(surfaces_written.find(surface) == surfaces_written.end())
 	{
 		surfaces_written.insert(surface);
-		// get the solids list
-		std::list<HeeksObj*> solids;
-		for (std::list<int>::iterator It = surface->m_solids.begin(); It != surface->m_solids.end(); It++)
-		{
-			HeeksObj* object = heeksCAD->GetIDObject(SolidType, *It);
-			if (object != NULL)solids.push_back(object);
-		} // End for
+
+		// tessellate the solids, keeping the triangles in memory
+		CSurfaceMesh* mesh = CSurfaceMesh::Get(surface);
 
 #if wxCHECK_VERSION(3, 0, 0)
 		wxStandardPaths& standard_paths = wxStandardPaths::Get();
 #else
 		wxStandardPaths standard_paths;
 #endif
-		wxFileName filepath(standard_paths.GetTempDir().c_str(), wxString::Format(_T("surface%d.stl"), CSurface::number_for_stl_file).c_str());
+		wxFileName filepath(standard_paths.GetTempDir().c_str(), wxString::Format(_T("surface%d.mesh"), CSurface::number_for_stl_file).c_str());
 		CSurface::number_for_stl_file++;
 
-		//write stl file
-		heeksCAD->SaveSTLFile(solids, filepath.GetFullPath(), 0.01);
+		// the attach library's tiles for the last file of this name, like surface1.mesh_3000_0_0.gtri, were made from other triangles
+		{
+			wxArrayString tile_files;
+			wxDir::GetAllFiles(filepath.GetPath(), &tile_files, filepath.GetFullName() + _T("_*"), wxDIR_FILES);
+			wxLogNull no_log; // a file still open in the last python program can't be deleted on Windows; the library won't use it anyway
+			for(size_t i = 0; i<tile_files.GetCount(); i++)wxRemoveFile(tile_files[i]);
+		}
+
+		// hand them to the python program in a mapped file, rather than writing and parsing an STL file
+		if(!mesh->WriteToFile(filepath.GetFullPath()))
+		{
+			wxMessageBox(wxString(_("Couldn't write surface file")) + _T(" ") + filepath.GetFullPath());
+		}
 
-		python << _T("stl") << (int)(surface->m_id) << _T(" = ocl_funcs.STLSurfFromFile(") << PythonString(filepath.GetFullPath()) << _T(")\n");
+		// the attach library maps the saved GTriMesh too, so it doesn't have to make the tree again
+		python << _T("surface") << (int)(surface->m_id) << _T(" = attach.Surface(") << PythonString(filepath.GetFullPath());
+		python << _T(", tree = ") << PythonString(mesh->TreeFilePath());
+		python << _T(", compact = ") << (surface->m_compact_mesh ? _T("True") : _T("False"));
+		python << _T(", tile_memory_budget = ") << surface->m_tile_memory_budget;
+		python << _T(", levels = ") << (surface->m_roughing_levels ? _T("True") : _T("False"));
+		python << _T(", cache_heights = ") << (surface->m_cache_heights ? _T("True") : _T("False"));
+		python << _T(", tolerance = ") << heeksCAD->GetTolerance() << _T(")\n");
 	}
 
 	python << _T("attach.units = ") << theApp.m_program->m_units << _T("\n");
 	python << _T("attach.attach_begin()\n");
-	python << _T("nc.creator.stl = stl") << (int)(surface->m_id) << _T("\n");
+	python << _T("nc.creator.set_surface(surface") << (int)(surface->m_id) << _T(")\n");
 	python << _T("nc.creator.minz = -10000.0\n");
 	python << _T("nc.creator.material_allowance = ") << surface->m_material_allowance << _T("\n");
 
@@ -588,6 +605,7 @@ Python CProgram::RewritePythonProgram()
 	theApp.m_program_canvas->m_textCtrl->Clear();
 	theApp.m_attached_to_surface = NULL;
 	CSurface::number_for_stl_file = 1;
+	CSurfaceMesh::ClearAll();
 	theApp.m_tool_number = 0;
 
 	// call any OnRewritePython functions from other plugins
@@ -623,7 +641,7 @@ Python CProgram::RewritePythonProgram()
 		if(((COp*)object)->m_active)
 		{
 			if(((COp*)object)->m_pattern != 0)transform_module_needed = true;
-			if(((COp*)object)->m_surface != 0){nc_attach_needed = true; ocl_module_needed = true; ocl_funcs_needed = true;}
+			if(((COp*)object)->m_surface != 0 && ((COp*)object)->AttachesToSurface())nc_attach_needed = true; // attach imports OpenCamLib itself, if it hasn't got the attach library
 
 			switch(object->GetType())
 			{
@@ -641,6 +659,11 @@ Python CProgram::RewritePythonProgram()
 				depths_needed = true;
 				break;
 
+			case RasterFinishType:
+			case WaterlineType:
+				depths_needed = true;
+				break;
+
 			case ScriptOpType:
 				ocl_module_needed = true;
 				nc_attach_needed = true;
@@ -889,7 +912,19 @@ Python CProgram::RewritePythonProgram()
 			COp* op = (COp*)object;
 			if(op->m_active)
 			{
-				CSurface* surface = (CSurface*)heeksCAD->GetIDObject(SurfaceType, op->m_surface);
+				if(!op->AttachesToSurface() && op->m_pattern != 0)
+				{
+					// these drop the cutter onto the surface themselves, where it is before the pattern moves it
+					// so their heights are only right at each position if the surface moves with the pattern
+					CSurface* own_surface = (CSurface*)heeksCAD->GetIDObject(SurfaceType, op->m_surface);
+					if(own_surface && !own_surface->m_same_for_each_pattern_position)
+					{
+						wxMessageBox(wxString::Format(_("Operation %d can't have a pattern, because its surface isn't the same for each pattern position, so it has been left out"), op->m_id));
+						continue;
+					}
+				}
+
+				CSurface* surface = op->AttachesToSurface() ? (CSurface*)heeksCAD->GetIDObject(SurfaceType, op->m_surface) : NULL;
 				if(surface && !surface->m_same_for_each_pattern_position)ApplySurfaceToText(python, surface, surfaces_written);
 				ApplyPatternToText(python, op->m_pattern, patterns_written);
 				if(surface && surface->m_same_for_each_pattern_position)ApplySurfaceToText(python, surface, surfaces_written);
@@ -907,6 +942,7 @@ Python CProgram::RewritePythonProgram()
 
 	python << _T("program_end()\n");
 	m_python_program = python;
+	TessellationCache::RemoveUnusedFiles();
 	theApp.m_program_canvas->m_textCtrl->AppendText(python);
 	if (python.Length() > theApp.m_program_canvas->m_textCtrl->GetValue().Length())
 	{
@@ -212,7 +212,16 @@ public:
 	CPyBackPlot(const CProgram* program, HeeksObj* into, const wxChar* filename): m_program(program), m_into(into),m_filename(filename),m_busy_cursor(NULL) { m_object = this; }
 	~CPyBackPlot(void) { m_object = NULL; }
 
-	static void StaticCancel(void) { if (m_object) m_object->Cancel(); }
+	static void StaticCancel(void) { if (m_object) { m_object->Cancel(); m_object->Finished(); } }
+
+	// called however the backplot ends, even if it failed or was cancelled
+	// the output window stops mapping the NC file, which could be written again, or deleted, at any time now
+	void Finished(void)
+	{
+		theApp.m_output_canvas->m_textCtrl->ReleaseFile();
+		delete m_busy_cursor;
+		m_busy_cursor = NULL;
+	}
 
 	void Do(void)
 	{
@@ -223,6 +232,7 @@ public:
 		if (m_program->m_machine.reader == _T("not found"))
 		{
 			wxMessageBox(_T("Machine reader name (defined in Program Properties) not found"));
+			Finished();
 		} // End if - then
 		else
 		{
@@ -241,9 +251,15 @@ public:
 
 				Execute(wxString(_T("python \"")) + path + wxString(_T("backplot.py\" \"")) + m_program->m_machine.reader + wxString(_T("\" \"")) + m_filename + wxString(_T("\"")) );
 			#endif
+			if (m_pid == 0)Finished(); // it didn't start
 		} // End if - else
 	}
 	void ThenDo(void)
+	{
+		ReadBackplotFile();
+		Finished();
+	}
+	void ReadBackplotFile(void)
 	{
 		if (!ProcessErrorAndOutputFiles())
 			return;
@@ -263,9 +279,6 @@ public:
 
 		// in Windows, at least, executing the bat file was making HeeksCAD change it's Z order
 		heeksCAD->GetMainFrame()->Raise();
-
-		delete m_busy_cursor;
-		m_busy_cursor = NULL;
 	}
 };
 
@@ -389,9 +402,11 @@ bool HeeksPyPostProcess(const CProgram* program, const wxString &filepath, const
 bool HeeksPyBackplot(const CProgram* program, HeeksObj* into, const wxString &filepath)
 {
 	try{
-		theApp.m_output_canvas->m_textCtrl->Clear(); // clear the output window
 		theApp.m_print_canvas->m_textCtrl->Clear(); // clear the output window
 
+		// show the file straight away, until its NC code has been read
+		theApp.m_output_canvas->m_textCtrl->ShowFile(filepath);
+
 		::wxSetWorkingDirectory(theApp.GetDllFolder());
 
 		// call the python file
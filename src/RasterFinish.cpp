@@ -0,0 +1,392 @@
+// RasterFinish.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "stdafx.h"
+#include "RasterFinish.h"
+#include "CNCConfig.h"
+#include "Program.h"
+#include "interface/HeeksObj.h"
+#include "interface/PropertyDouble.h"
+#include "interface/PropertyLength.h"
+#include "tinyxml/tinyxml.h"
+#include "CTool.h"
+#include "Surface.h"
+#include "SurfaceMesh.h"
+#include "DropCutter.h"
+#include "MoveWriter.h"
+#include "RasterFinishDlg.h"
+
+CRasterFinishParams::CRasterFinishParams()
+{
+	m_step_over = 0.5;
+	m_angle = 0.0;
+	m_tolerance = 0.01;
+}
+
+void CRasterFinishParams::set_initial_values(int tool_number)
+{
+	if (tool_number > 0)
+	{
+		CTool *pTool = CTool::Find(tool_number);
+		if (pTool != NULL)
+		{
+			m_step_over = pTool->CuttingRadius() / 5.0;
+		}
+	}
+}
+
+static void on_set_step_over(double value, HeeksObj* object)
+{
+	((CRasterFinish*)object)->m_raster_finish_params.m_step_over = value;
+	((CRasterFinish*)object)->WriteDefaultValues();
+}
+
+static void on_set_angle(double value, HeeksObj* object)
+{
+	((CRasterFinish*)object)->m_raster_finish_params.m_angle = value;
+	((CRasterFinish*)object)->WriteDefaultValues();
+}
+
+static void on_set_tolerance(double value, HeeksObj* object)
+{
+	((CRasterFinish*)object)->m_raster_finish_params.m_tolerance = value;
+	((CRasterFinish*)object)->WriteDefaultValues();
+}
+
+void CRasterFinishParams::GetProperties(CRasterFinish* parent, std::list<Property *> *list)
+{
+	list->push_back(new PropertyLength(_("step over"), m_step_over, parent, on_set_step_over));
+	list->push_back(new PropertyDouble(_("angle"), m_angle, parent, on_set_angle));
+	list->push_back(new PropertyLength(_("tolerance"), m_tolerance, parent, on_set_tolerance));
+}
+
+void CRasterFinishParams::WriteXMLAttributes(TiXmlNode *root)
+{
+	TiXmlElement * element;
+	element = heeksCAD->NewXMLElement( "params" );
+	heeksCAD->LinkXMLEndChild( root,  element );
+	element->SetDoubleAttribute( "step", m_step_over);
+	element->SetDoubleAttribute( "angle", m_angle);
+	element->SetDoubleAttribute( "tolerance", m_tolerance);
+}
+
+void CRasterFinishParams::ReadFromXMLElement(TiXmlElement* pElem)
+{
+	pElem->Attribute("step", &m_step_over);
+	pElem->Attribute("angle", &m_angle);
+	pElem->Attribute("tolerance", &m_tolerance);
+}
+
+bool CRasterFinishParams::operator==(const CRasterFinishParams & rhs) const
+{
+	if (m_step_over != rhs.m_step_over) return(false);
+	if (m_angle != rhs.m_angle) return(false);
+	if (m_tolerance != rhs.m_tolerance) return(false);
+
+	return(true);
+}
+
+CRasterFinish::CRasterFinish(int surface, int tool_number)
+	: CDepthOp(tool_number, RasterFinishType)
+{
+	ReadDefaultValues();
+	m_raster_finish_params.set_initial_values(tool_number);
+	m_surface = surface;
+}
+
+CRasterFinish::CRasterFinish( const CRasterFinish & rhs ) : CDepthOp(rhs)
+{
+	m_raster_finish_params = rhs.m_raster_finish_params;
+}
+
+CRasterFinish & CRasterFinish::operator= ( const CRasterFinish & rhs )
+{
+	if (this != &rhs)
+	{
+		CDepthOp::operator=(rhs);
+		m_raster_finish_params = rhs.m_raster_finish_params;
+	}
+
+	return(*this);
+}
+
+bool CRasterFinish::operator==(const CRasterFinish & rhs) const
+{
+	if (m_raster_finish_params != rhs.m_raster_finish_params) return(false);
+
+	return(CDepthOp::operator==(rhs));
+}
+
+const wxBitmap &CRasterFinish::GetIcon()
+{
+	if(!m_active)return GetInactiveIcon();
+	static wxBitmap* icon = NULL;
+	if(icon == NULL)icon = new wxBitmap(wxImage(theApp.GetResFolder() + _T("/icons/zigzag.png")));
+	return *icon;
+}
+
+// adds the rows, step_over apart at angle degrees, across box ( minx miny maxx maxy ), to xy, and their sizes to sizes
+// each row goes the other way to the one before, and a path of two points, from the end of each row to the start of the next, goes between them
+static void make_rows(const double *box, double step_over, double angle, std::vector<double> &xy, std::vector<int> &sizes)
+{
+	double a = angle * M_PI / 180.0;
+	double along[2] = {cos(a), sin(a)};
+	double across[2] = {-along[1], along[0]};
+
+	// the box's extent across the rows
+	double vmin = 0.0, vmax = 0.0;
+	for(int i = 0; i<4; i++)
+	{
+		double x = box[(i & 1) ? 2 : 0];
+		double y = box[(i & 2) ? 3 : 1];
+		double v = x * across[0] + y * across[1];
+		if(i == 0 || v < vmin)vmin = v;
+		if(i == 0 || v > vmax)vmax = v;
+	}
+
+	// the rows are spread evenly, no more than step_over apart, with one on each side of the box
+	int num_rows = (int)ceil((vmax - vmin) / step_over) + 1;
+	double spacing = (num_rows > 1) ? (vmax - vmin) / (num_rows - 1) : 0.0;
+
+	for(int i = 0; i<num_rows; i++)
+	{
+		double v = vmin + spacing * i;
+
+		// clip the row to the box
+		double umin = -1.0e30, umax = 1.0e30;
+		for(int j = 0; j<2; j++)
+		{
+			double start = v * across[j];
+			if(fabs(along[j]) < 0.000000001)continue;
+			double u0 = (box[j] - start) / along[j];
+			double u1 = (box[j + 2] - start) / along[j];
+			if(u0 > u1){double temp = u0; u0 = u1; u1 = temp;}
+			if(u0 > umin)umin = u0;
+			if(u1 < umax)umax = u1;
+		}
+		if(umax < umin)umax = umin = (umin + umax) * 0.5; // just touches a corner
+
+		double u0 = (i % 2 == 0) ? umin : umax;
+		double u1 = (i % 2 == 0) ? umax : umin;
+
+		if(i > 0)
+		{
+			// from the end of the last row
+			double x = xy[xy.size() - 2];
+			double y = xy[xy.size() - 1];
+			xy.push_back(x);
+			xy.push_back(y);
+			xy.push_back(u0 * along[0] + v * across[0]);
+			xy.push_back(u0 * along[1] + v * across[1]);
+			sizes.push_back(2);
+		}
+
+		xy.push_back(u0 * along[0] + v * across[0]);
+		xy.push_back(u0 * along[1] + v * across[1]);
+		xy.push_back(u1 * along[0] + v * across[0]);
+		xy.push_back(u1 * along[1] + v * across[1]);
+		sizes.push_back(2);
+	}
+}
+
+Python CRasterFinish::AppendTextToProgram()
+{
+	Python python;
+
+	CTool *pTool = CTool::Find( m_tool_number );
+	if (pTool == NULL)
+	{
+		wxMessageBox(_("Cannot generate G-Code for raster finish without a tool assigned"));
+		return python;
+	} // End if - then
+
+	CSurface* surface = (CSurface*)heeksCAD->GetIDObject(SurfaceType, m_surface);
+	if(surface == NULL)
+	{
+		wxMessageBox(_("Raster finish operation - Surface doesn't exist"));
+		return python;
+	}
+
+	if(m_raster_finish_params.m_step_over <= 0.0)
+	{
+		wxMessageBox(_("Raster finish operation - Step over must be more than zero"));
+		return python;
+	}
+
+	CSurfaceMesh* mesh = CSurfaceMesh::Get(surface);
+	CBox box;
+	mesh->GetBox(box);
+	if(!box.m_valid)
+	{
+		wxMessageBox(wxString::Format(_("Raster finish operation - Surface %d has no solids"), surface->m_id));
+		return python;
+	}
+
+	python << CDepthOp::AppendTextToProgram();
+
+	// the rows go far enough past the solids for the cutter to go right over their edges
+	Cutter cu = pTool->DropCutterDefinition(surface);
+	double rows_box[4] = {box.MinX() - cu.R, box.MinY() - cu.R, box.MaxX() + cu.R, box.MaxY() + cu.R};
+	std::vector<double> xy;
+	std::vector<int> sizes;
+	make_rows(rows_box, m_raster_finish_params.m_step_over, m_raster_finish_params.m_angle, xy, sizes);
+
+	// the rows are sampled about as closely as they are spaced, and halved down to the tolerance where the surface bends
+	// the cutter doesn't go below the final depth, off the edges of the surface
+	// the material allowance is added to the heights below, so the floor is lowered by it here, as in Waterline
+	double tolerance = m_raster_finish_params.m_tolerance;
+	if(tolerance <= 0.0)tolerance = heeksCAD->GetTolerance();
+	double max_step = m_raster_finish_params.m_step_over;
+	if(max_step < tolerance * 2)max_step = tolerance * 2;
+	std::vector<double> result;
+	std::vector<int> result_sizes;
+	DropCutterDiagnostics::Reset();
+	PointDropper* dropper = mesh->Dropper(cu, m_depth_op_params.m_final_depth - surface->m_material_allowance);
+	DropCutter::DropPaths(*dropper, &xy[0], &sizes[0], (int)sizes.size(), NULL, max_step, tolerance, tolerance, result, result_sizes);
+	delete dropper;
+	std::string report = DropCutterDiagnostics::Report();
+	if(report.size() > 0)wxMessageBox(_("Raster finish operation - Problems found while dropping the cutter") + _T("\n") + Ctt(report.c_str()));
+
+	// the cutter was made bigger by the material allowance, so its tip has to go up by it too
+	double clearance = m_depth_op_params.m_clearance_height;
+	double safe_z = clearance;
+	for(unsigned int i = 2; i < result.size(); i += 3)
+	{
+		result[i] += surface->m_material_allowance;
+		if(result[i] + m_depth_op_params.m_rapid_safety_space > safe_z)safe_z = result[i] + m_depth_op_params.m_rapid_safety_space;
+	}
+
+	MoveWriter writer(python);
+	writer.RapidZ(safe_z);
+
+	// the paths alternate, rows and the links between them
+	bool down = false;
+	const double* p = result.size() > 0 ? &result[0] : NULL;
+	for(unsigned int path = 0; path < result_sizes.size(); p += result_sizes[path] * 3, path++)
+	{
+		int n = result_sizes[path];
+		if(n == 0)continue;
+
+		if(path % 2 == 1)
+		{
+			// stay down and feed along the surface to the next row, unless that goes up to the clearance height
+			bool below_clearance = true;
+			for(int i = 0; i<n; i++)
+			{
+				if(p[i * 3 + 2] >= clearance)below_clearance = false;
+			}
+			if(!below_clearance)
+			{
+				writer.RapidZ(safe_z);
+				down = false;
+				continue;
+			}
+		}
+
+		if(!down)
+		{
+			double above[3] = {p[0], p[1], safe_z};
+			writer.Move(false, above);
+			writer.RapidZ(p[2] + m_depth_op_params.m_rapid_safety_space);
+			writer.FeedZ(p[2]);
+			down = true;
+		}
+
+		for(int i = 0; i<n; i++)writer.Move(true, &p[i * 3]);
+	}
+
+	writer.RapidZ(safe_z);
+
+	return python;
+}
+
+void CRasterFinish::WriteDefaultValues()
+{
+	CDepthOp::WriteDefaultValues();
+
+	CNCConfig config;
+	config.Write(_T("RasterStepOver"), m_raster_finish_params.m_step_over);
+	config.Write(_T("RasterAngle"), m_raster_finish_params.m_angle);
+	config.Write(_T("RasterTolerance"), m_raster_finish_params.m_tolerance);
+}
+
+void CRasterFinish::ReadDefaultValues()
+{
+	CDepthOp::ReadDefaultValues();
+
+	CNCConfig config;
+	config.Read(_T("RasterStepOver"), &m_raster_finish_params.m_step_over, 0.5);
+	config.Read(_T("RasterAngle"), &m_raster_finish_params.m_angle, 0.0);
+	config.Read(_T("RasterTolerance"), &m_raster_finish_params.m_tolerance, 0.01);
+}
+
+void CRasterFinish::GetProperties(std::list<Property *> *list)
+{
+	m_raster_finish_params.GetProperties(this, list);
+	CDepthOp::GetProperties(list);
+}
+
+HeeksObj *CRasterFinish::MakeACopy(void)const
+{
+	return new CRasterFinish(*this);
+}
+
+void CRasterFinish::CopyFrom(const HeeksObj* object)
+{
+	operator=(*((CRasterFinish*)object));
+}
+
+bool CRasterFinish::CanAddTo(HeeksObj* owner)
+{
+	return ((owner != NULL) && (owner->GetType() == OperationsType));
+}
+
+void CRasterFinish::WriteXML(TiXmlNode *root)
+{
+	TiXmlElement * element = heeksCAD->NewXMLElement( "RasterFinish" );
+	heeksCAD->LinkXMLEndChild( root,  element );
+	m_raster_finish_params.WriteXMLAttributes(element);
+
+	WriteBaseXML(element);
+}
+
+// static member function
+HeeksObj* CRasterFinish::ReadFromXMLElement(TiXmlElement* element)
+{
+	CRasterFinish* new_object = new CRasterFinish;
+
+	std::list<TiXmlElement *> elements_to_remove;
+
+	// read parameters
+	TiXmlElement* params = heeksCAD->FirstNamedXMLChildElement(element, "params");
+	if(params)
+	{
+		new_object->m_raster_finish_params.ReadFromXMLElement(params);
+		elements_to_remove.push_back(params);
+	}
+
+	for (std::list<TiXmlElement*>::iterator itElem = elements_to_remove.begin(); itElem != elements_to_remove.end(); itElem++)
+	{
+		heeksCAD->RemoveXMLChild( element, *itElem);
+	}
+
+	// read common parameters
+	new_object->ReadBaseXML(element);
+
+	return new_object;
+}
+
+void CRasterFinish::GetTools(std::list<Tool*>* t_list, const wxPoint* p)
+{
+	CDepthOp::GetTools( t_list, p );
+}
+
+static bool OnEdit(HeeksObj* object)
+{
+	return RasterFinishDlg::Do((CRasterFinish*)object);
+}
+
+void CRasterFinish::GetOnEdit(bool(**callback)(HeeksObj*))
+{
+	*callback = OnEdit;
+}
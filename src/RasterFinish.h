@@ -0,0 +1,65 @@
+// RasterFinish.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+// finishes a surface with parallel rows, dropping the cutter onto the surface's triangles in HeeksCNC, not in the python program
+// the rows go across the box around the surface's solids, and the ends of the rows are joined zig zag fashion
+// the cutter locations are dropped all together, shared out between the cores, see DropCutter::DropPaths, and the python program gets
+// the moves already left out where they are in line, so its moves aren't attached to the surface again, see COp::AttachesToSurface
+
+#pragma once
+
+#include "HeeksCNCTypes.h"
+#include "DepthOp.h"
+
+class CRasterFinish;
+
+class CRasterFinishParams{
+public:
+	double m_step_over;
+	double m_angle; // of the rows, in degrees anti-clockwise from the X axis
+	double m_tolerance; // how far the moves can be from the cutter locations
+
+	CRasterFinishParams();
+
+	void set_initial_values(int tool_number);
+	void GetProperties(CRasterFinish* parent, std::list<Property *> *list);
+	void WriteXMLAttributes(TiXmlNode* pElem);
+	void ReadFromXMLElement(TiXmlElement* pElem);
+
+	bool operator== ( const CRasterFinishParams & rhs ) const;
+	bool operator!= ( const CRasterFinishParams & rhs ) const { return(! (*this == rhs)); }
+};
+
+class CRasterFinish: public CDepthOp{
+public:
+	CRasterFinishParams m_raster_finish_params;
+
+	CRasterFinish():CDepthOp(0, RasterFinishType){}
+	CRasterFinish(int surface, int tool_number);
+	CRasterFinish( const CRasterFinish & rhs );
+	CRasterFinish & operator= ( const CRasterFinish & rhs );
+
+	bool operator== ( const CRasterFinish & rhs ) const;
+	bool operator!= ( const CRasterFinish & rhs ) const { return(! (*this == rhs)); }
+	bool IsDifferent(HeeksObj *other) { return( *this != (*(CRasterFinish *)other) ); }
+
+	// HeeksObj's virtual functions
+	int GetType()const{return RasterFinishType;}
+	const wxChar* GetTypeString(void) const { return _("Raster Finish"); }
+	const wxBitmap &GetIcon();
+	void GetProperties(std::list<Property *> *list);
+	HeeksObj *MakeACopy(void)const;
+	void CopyFrom(const HeeksObj* object);
+	void WriteXML(TiXmlNode *root);
+	bool CanAddTo(HeeksObj* owner);
+	void GetTools(std::list<Tool*>* t_list, const wxPoint* p);
+	void GetOnEdit(bool(**callback)(HeeksObj*));
+	void WriteDefaultValues();
+	void ReadDefaultValues();
+
+	// COp's virtual functions
+	Python AppendTextToProgram();
+	bool AttachesToSurface(){return false;}
+
+	static HeeksObj* ReadFromXMLElement(TiXmlElement* pElem);
+};
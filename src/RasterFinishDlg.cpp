@@ -0,0 +1,83 @@
+// RasterFinishDlg.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "stdafx.h"
+#include "RasterFinishDlg.h"
+#include "interface/NiceTextCtrl.h"
+#include "RasterFinish.h"
+
+BEGIN_EVENT_TABLE(RasterFinishDlg, DepthOpDlg)
+    EVT_BUTTON(wxID_HELP, RasterFinishDlg::OnHelp)
+END_EVENT_TABLE()
+
+RasterFinishDlg::RasterFinishDlg(wxWindow *parent, CRasterFinish* object, const wxString& title, bool top_level)
+             : DepthOpDlg(parent, object, false, title, false)
+{
+	std::list<HControl> save_leftControls = leftControls;
+	leftControls.clear();
+
+	// add all the controls to the left side
+	leftControls.push_back(MakeLabelAndControl(_("Step Over"), m_lgthStepOver = new CLengthCtrl(this)));
+	leftControls.push_back(MakeLabelAndControl(_("Angle"), m_dblAngle = new CDoubleCtrl(this)));
+	leftControls.push_back(MakeLabelAndControl(_("Tolerance"), m_lgthTolerance = new CLengthCtrl(this)));
+
+	for(std::list<HControl>::iterator It = save_leftControls.begin(); It != save_leftControls.end(); It++)
+	{
+		leftControls.push_back(*It);
+	}
+
+	if(top_level)
+	{
+		HeeksObjDlg::AddControlsAndCreate();
+		m_cmbSurface->SetFocus();
+	}
+}
+
+void RasterFinishDlg::GetDataRaw(HeeksObj* object)
+{
+	((CRasterFinish*)object)->m_raster_finish_params.m_step_over = m_lgthStepOver->GetValue();
+	((CRasterFinish*)object)->m_raster_finish_params.m_angle = m_dblAngle->GetValue();
+	((CRasterFinish*)object)->m_raster_finish_params.m_tolerance = m_lgthTolerance->GetValue();
+
+	DepthOpDlg::GetDataRaw(object);
+}
+
+void RasterFinishDlg::SetFromDataRaw(HeeksObj* object)
+{
+	m_lgthStepOver->SetValue(((CRasterFinish*)object)->m_raster_finish_params.m_step_over);
+	m_dblAngle->SetValue(((CRasterFinish*)object)->m_raster_finish_params.m_angle);
+	m_lgthTolerance->SetValue(((CRasterFinish*)object)->m_raster_finish_params.m_tolerance);
+
+	DepthOpDlg::SetFromDataRaw(object);
+}
+
+void RasterFinishDlg::SetPicture(const wxString& name)
+{
+	HeeksObjDlg::SetPicture(name, _T("rasterfinish"));
+}
+
+void RasterFinishDlg::SetPictureByWindow(wxWindow* w)
+{
+	if(w == m_lgthStepOver)SetPicture(_T("step over"));
+	else if(w == m_dblAngle)SetPicture(_T("angle"));
+	else if(w == m_lgthTolerance)SetPicture(_T("tolerance"));
+	else DepthOpDlg::SetPictureByWindow(w);
+}
+
+void RasterFinishDlg::OnHelp( wxCommandEvent& event )
+{
+	::wxLaunchDefaultBrowser(_T("http://heeks.net/help/rasterfinish"));
+}
+
+bool RasterFinishDlg::Do(CRasterFinish* object)
+{
+	RasterFinishDlg dlg(heeksCAD->GetMainFrame(), object);
+
+	if(dlg.ShowModal() == wxID_OK)
+	{
+		dlg.GetData(object);
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,30 @@
+// RasterFinishDlg.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+class CRasterFinish;
+class CLengthCtrl;
+class CDoubleCtrl;
+
+#include "DepthOpDlg.h"
+
+class RasterFinishDlg : public DepthOpDlg
+{
+	CLengthCtrl *m_lgthStepOver;
+	CDoubleCtrl *m_dblAngle;
+	CLengthCtrl *m_lgthTolerance;
+
+public:
+	RasterFinishDlg(wxWindow *parent, CRasterFinish* object, const wxString& title = wxString(_("Raster Finish Operation")), bool top_level = true);
+
+	static bool Do(CRasterFinish* object);
+
+	// HeeksObjDlg virtual functions
+	void GetDataRaw(HeeksObj* object);
+	void SetFromDataRaw(HeeksObj* object);
+	void SetPictureByWindow(wxWindow* w);
+	void SetPicture(const wxString& name);
+
+	void OnHelp( wxCommandEvent& event );
+
+	DECLARE_EVENT_TABLE()
+};
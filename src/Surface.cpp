@@ -9,6 +9,7 @@
 #include "tinyxml/tinyxml.h"
 #include "interface/PropertyLength.h"
 #include "interface/PropertyCheck.h"
+#include "interface/PropertyDouble.h"
 #include "Reselect.h"
 #include "SurfaceDlg.h"
 
@@ -32,6 +33,10 @@ void CSurface::WriteXML(TiXmlNode *root)
 	element->SetDoubleAttribute( "tolerance", m_tolerance);
 	element->SetDoubleAttribute( "material_allowance", m_material_allowance);
 	element->SetAttribute( "same_for_posns", m_same_for_each_pattern_position ? 1:0);
+	element->SetAttribute( "compact_mesh", m_compact_mesh ? 1:0);
+	element->SetDoubleAttribute( "tile_memory_budget", m_tile_memory_budget);
+	element->SetAttribute( "roughing_levels", m_roughing_levels ? 1:0);
+	element->SetAttribute( "cache_heights", m_cache_heights ? 1:0);
 
 	// write solid ids
 	for (std::list<int>::iterator It = m_solids.begin(); It != m_solids.end(); It++)
@@ -55,6 +60,10 @@ HeeksObj* CSurface::ReadFromXMLElement(TiXmlElement* element)
 	element->Attribute("material_allowance", &new_object->m_material_allowance);
 	int int_for_bool = 1;
 	if(element->Attribute( "same_for_posns", &int_for_bool))new_object->m_same_for_each_pattern_position = (int_for_bool != 0);
+	if(element->Attribute( "compact_mesh", &int_for_bool))new_object->m_compact_mesh = (int_for_bool != 0);
+	element->Attribute("tile_memory_budget", &new_object->m_tile_memory_budget);
+	if(element->Attribute( "roughing_levels", &int_for_bool))new_object->m_roughing_levels = (int_for_bool != 0);
+	if(element->Attribute( "cache_heights", &int_for_bool))new_object->m_cache_heights = (int_for_bool != 0);
 
 	if(const char* pstr = element->Attribute("title"))new_object->m_title = Ctt(pstr);
 
@@ -85,6 +94,10 @@ void CSurface::WriteDefaultValues()
 	config.Write(wxString(GetTypeString()) + _T("Tolerance"), m_tolerance);
 	config.Write(wxString(GetTypeString()) + _T("MatAllowance"), m_material_allowance);
 	config.Write(wxString(GetTypeString()) + _T("SameForPositions"), m_same_for_each_pattern_position);
+	config.Write(wxString(GetTypeString()) + _T("CompactMesh"), m_compact_mesh);
+	config.Write(wxString(GetTypeString()) + _T("TileMemoryBudget"), m_tile_memory_budget);
+	config.Write(wxString(GetTypeString()) + _T("RoughingLevels"), m_roughing_levels);
+	config.Write(wxString(GetTypeString()) + _T("CacheHeights"), m_cache_heights);
 }
 
 void CSurface::ReadDefaultValues()
@@ -93,11 +106,19 @@ void CSurface::ReadDefaultValues()
 	config.Read(wxString(GetTypeString()) + _T("Tolerance"), &m_tolerance, 0.01);
 	config.Read(wxString(GetTypeString()) + _T("MatAllowance"), &m_material_allowance, 0.0);
 	config.Read(wxString(GetTypeString()) + _T("SameForPositions"), &m_same_for_each_pattern_position, true);
+	config.Read(wxString(GetTypeString()) + _T("CompactMesh"), &m_compact_mesh, false);
+	config.Read(wxString(GetTypeString()) + _T("TileMemoryBudget"), &m_tile_memory_budget, 0.0);
+	config.Read(wxString(GetTypeString()) + _T("RoughingLevels"), &m_roughing_levels, true);
+	config.Read(wxString(GetTypeString()) + _T("CacheHeights"), &m_cache_heights, true);
 }
 
 static void on_set_tolerance(double value, HeeksObj* object){((CSurface*)object)->m_tolerance = value; ((CSurface*)object)->WriteDefaultValues();}
 static void on_set_material_allowance(double value, HeeksObj* object){((CSurface*)object)->m_material_allowance = value; ((CSurface*)object)->WriteDefaultValues();}
 static void on_set_same_for_position(bool value, HeeksObj* object){((CSurface*)object)->m_same_for_each_pattern_position = value; ((CSurface*)object)->WriteDefaultValues();}
+static void on_set_compact_mesh(bool value, HeeksObj* object){((CSurface*)object)->m_compact_mesh = value; ((CSurface*)object)->WriteDefaultValues();}
+static void on_set_tile_memory_budget(double value, HeeksObj* object){((CSurface*)object)->m_tile_memory_budget = value; ((CSurface*)object)->WriteDefaultValues();}
+static void on_set_roughing_levels(bool value, HeeksObj* object){((CSurface*)object)->m_roughing_levels = value; ((CSurface*)object)->WriteDefaultValues();}
+static void on_set_cache_heights(bool value, HeeksObj* object){((CSurface*)object)->m_cache_heights = value; ((CSurface*)object)->WriteDefaultValues();}
 
 void CSurface::GetProperties(std::list<Property *> *list)
 {
@@ -106,6 +127,10 @@ void CSurface::GetProperties(std::list<Property *> *list)
 	list->push_back(new PropertyLength(_("tolerance"), m_tolerance, this, on_set_tolerance));
 	list->push_back(new PropertyLength(_("material allowance"), m_material_allowance, this, on_set_material_allowance));
 	list->push_back(new PropertyCheck(_("same for each pattern position"), m_same_for_each_pattern_position, this, on_set_same_for_position));
+	list->push_back(new PropertyCheck(_("compact mesh"), m_compact_mesh, this, on_set_compact_mesh));
+	list->push_back(new PropertyDouble(_("tile memory budget MB, 0 for no tiles"), m_tile_memory_budget, this, on_set_tile_memory_budget));
+	list->push_back(new PropertyCheck(_("roughing levels"), m_roughing_levels, this, on_set_roughing_levels));
+	list->push_back(new PropertyCheck(_("cache heights"), m_cache_heights, this, on_set_cache_heights));
 
 	IdNamedObj::GetProperties(list);
 }
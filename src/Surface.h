@@ -16,11 +16,15 @@ public:
 	double m_tolerance;
 	double m_material_allowance;
 	bool m_same_for_each_pattern_position;
+	bool m_compact_mesh; // keep the triangles as a CompactMesh, for surfaces with too many triangles for a GTriMesh
+	double m_tile_memory_budget; // in megabytes; if more than 0, the triangles are kept on disk as a TiledMesh, and only this much is mapped in at once
+	bool m_roughing_levels; // drop cutters which don't need all the detail onto coarser copies of the triangles, see MeshPyramid
+	bool m_cache_heights; // keep the heights each cutter is dropped to, for the ops and pattern positions after the first, see ZMap
 	static int number_for_stl_file;
 
 	//	Constructors.
 	CSurface();
-	CSurface(const std::list<int> &solids, double tol, double mat_allowance):m_solids(solids), m_tolerance(tol), m_material_allowance(mat_allowance), m_same_for_each_pattern_position(true){}
+	CSurface(const std::list<int> &solids, double tol, double mat_allowance):m_solids(solids), m_tolerance(tol), m_material_allowance(mat_allowance), m_same_for_each_pattern_position(true), m_compact_mesh(false), m_tile_memory_budget(0.0), m_roughing_levels(true), m_cache_heights(true){}
 
 	// HeeksObj's virtual functions
 	int GetType()const{return SurfaceType;}
@@ -0,0 +1,259 @@
+// SurfaceAttach.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "stdafx.h"
+#include "SurfaceAttach.h"
+#include "SurfaceMeshFile.h"
+#include "GTriMesh.h"
+#include "CompactMesh.h"
+#include "TiledMesh.h"
+#include "MappedFile.h"
+#include "MeshPyramid.h"
+#include "ZMap.h"
+
+template<class Mesh> class AttachMeshDropper: public PointDropper
+{
+	Cutter m_cu;
+	const Mesh &m_mesh;
+	double m_minz;
+public:
+	AttachMeshDropper(const Cutter &cu, const Mesh &mesh, double minz):m_cu(cu), m_mesh(mesh), m_minz(minz){}
+	void Drop(const double *xy, int n, double *z)
+	{
+		DropCutter::DropPoints(m_cu, m_mesh, xy, n, m_minz, z);
+	}
+};
+
+class AttachZMapDropper: public PointDropper
+{
+	ZMap &m_zmap;
+public:
+	AttachZMapDropper(ZMap &zmap):m_zmap(zmap){}
+	void Drop(const double *xy, int n, double *z)
+	{
+		m_zmap.Drop(xy, n, z);
+	}
+};
+
+class AttachTiledDropper: public PointDropper
+{
+	Cutter m_cu;
+	TiledMesh &m_mesh;
+	double m_minz;
+public:
+	AttachTiledDropper(const Cutter &cu, TiledMesh &mesh, double minz):m_cu(cu), m_mesh(mesh), m_minz(minz){}
+	void Drop(const double *xy, int n, double *z)
+	{
+		m_mesh.DropPoints(m_cu, xy, n, m_minz, z);
+	}
+};
+
+AttachSurface::AttachSurface():m_mesh(NULL), m_compact_mesh(NULL), m_file(NULL), m_pyramid(NULL), m_cache_heights(false), m_box_found(false), m_tile_memory_budget(0), m_tolerance(0.0)
+{
+}
+
+AttachSurface::~AttachSurface()
+{
+	// the height maps drop onto the meshes, so they go first
+	for(std::map< std::vector<double>, ZMap* >::iterator It = m_zmaps.begin(); It != m_zmaps.end(); It++)delete It->second;
+	delete m_mesh;
+	delete m_compact_mesh;
+	for(std::map<int, TiledMesh*>::iterator It = m_tiled_meshes.begin(); It != m_tiled_meshes.end(); It++)delete It->second;
+	delete m_pyramid;
+	delete m_file;
+}
+
+const double* AttachSurface::Triangles(size_t &num_triangles)const
+{
+	const SurfaceMeshFileHeader* header = (const SurfaceMeshFileHeader*)m_file->Data();
+	num_triangles = (size_t)header->m_num_triangles;
+	return (const double*)((const char*)m_file->Data() + header->m_header_size);
+}
+
+// static
+AttachSurface* AttachSurface::Open(const std::string &mesh_path, const std::string &tree_path, bool compact, size_t tile_memory_budget, bool levels, bool cache_heights)
+{
+	AttachSurface* surface = new AttachSurface;
+	surface->m_mesh_path = mesh_path;
+	surface->m_tile_memory_budget = tile_memory_budget;
+	surface->m_cache_heights = cache_heights;
+
+	surface->m_file = new MappedFile;
+	bool ok = surface->m_file->Open(mesh_path) && surface->m_file->Size() >= sizeof(SurfaceMeshFileHeader);
+	if(ok)
+	{
+		const SurfaceMeshFileHeader* header = (const SurfaceMeshFileHeader*)surface->m_file->Data();
+		ok = memcmp(header->m_magic, "HCNCMESH", 8) == 0 && header->m_version == 1 && SurfaceMeshFileFits(header, surface->m_file->Size());
+		if(ok)surface->m_tolerance = header->m_tolerance;
+	}
+	if(!ok)
+	{
+		delete surface;
+		return NULL;
+	}
+
+	size_t num_triangles;
+	const double* p = surface->Triangles(num_triangles);
+
+	// the box is where the height maps go
+	for(size_t i = 0; i < num_triangles * 3; i++)
+	{
+		const double* v = &p[i * 3];
+		if(!surface->m_box_found)
+		{
+			surface->m_box[0] = surface->m_box[2] = v[0];
+			surface->m_box[1] = surface->m_box[3] = v[1];
+			surface->m_box_found = true;
+		}
+		if(v[0] < surface->m_box[0])surface->m_box[0] = v[0];
+		if(v[1] < surface->m_box[1])surface->m_box[1] = v[1];
+		if(v[0] > surface->m_box[2])surface->m_box[2] = v[0];
+		if(v[1] > surface->m_box[3])surface->m_box[3] = v[1];
+	}
+
+	if(levels)
+	{
+		// the first level leaves a few times the tolerance the triangles were made with
+		MeshPyramid::Sources sources;
+		sources.push_back(std::make_pair(p, num_triangles));
+		surface->m_pyramid = new MeshPyramid(sources, surface->m_tolerance * 4.0);
+	}
+
+	// the tiles are made when the cutter is known
+	if(tile_memory_budget > 0)return surface;
+
+	if(compact)
+	{
+		surface->m_compact_mesh = new CompactMesh(p, num_triangles);
+	}
+	else
+	{
+		// the saved mesh is mapped, so its tree doesn't have to be made again
+		if(tree_path.size() > 0)surface->m_mesh = GTriMesh::Open(tree_path);
+		if(surface->m_mesh == NULL)
+		{
+			std::list<GTri> triangles;
+			for(size_t i = 0; i<num_triangles; i++)triangles.push_back(GTri(&p[i * 9]));
+			surface->m_mesh = new GTriMesh(triangles);
+		}
+	}
+
+	// the file is only kept for making tiles and levels from
+	if(surface->m_pyramid == NULL)
+	{
+		delete surface->m_file;
+		surface->m_file = NULL;
+	}
+
+	return surface;
+}
+
+PointDropper* AttachSurface::Dropper(const Cutter &cu, double minz, double material_allowance, double tolerance)
+{
+	if(!m_cache_heights || !m_box_found)return MeshDropper(cu, minz, material_allowance);
+
+	double sizes[] = {cu.R, cu.r, cu.Rf, cu.h, cu.m_cone ? 1.0 : 0.0, minz, material_allowance, tolerance};
+	std::vector<double> key(sizes, sizes + sizeof(sizes) / sizeof(double));
+	std::map< std::vector<double>, ZMap* >::iterator FindIt = m_zmaps.find(key);
+	if(FindIt != m_zmaps.end())return new AttachZMapDropper(*FindIt->second);
+
+	PointDropper* dropper = MeshDropper(cu, minz, material_allowance);
+	if(dropper == NULL)return NULL;
+
+	// the cutter touches the triangles from up to its radius away
+	double box[4] = {m_box[0] - cu.R, m_box[1] - cu.R, m_box[2] + cu.R, m_box[3] + cu.R};
+	ZMap* zmap = new ZMap(dropper, box, ZMap::Spacing(cu.R, tolerance), tolerance);
+	m_zmaps.insert(std::make_pair(key, zmap));
+	return new AttachZMapDropper(*zmap);
+}
+
+PointDropper* AttachSurface::MeshDropper(const Cutter &cu, double minz, double material_allowance)
+{
+	if(m_pyramid)
+	{
+		int level = m_pyramid->ChooseLevel(cu.R * 2.0, material_allowance);
+		if(level >= 0)return new AttachMeshDropper<GTriMesh>(cu, m_pyramid->Level(level), minz);
+	}
+
+	if(m_mesh)return new AttachMeshDropper<GTriMesh>(cu, *m_mesh, minz);
+	if(m_compact_mesh)return new AttachMeshDropper<CompactMesh>(cu, *m_compact_mesh, minz);
+
+	// each size of cutter gets its own tiles, as in CSurfaceMesh::Tiled, kept while the surface is open, as droppers may still be dropping onto the others
+	// the padding is the cutter's radius rounded up to a thousandth, so every cutter that rounds to it fits in the tiles
+	int padding_key = (int)ceil(cu.R * 1000.0 - 0.000001);
+	std::map<int, TiledMesh*>::iterator FindIt = m_tiled_meshes.find(padding_key);
+	if(FindIt != m_tiled_meshes.end())return new AttachTiledDropper(cu, *FindIt->second, minz);
+
+	// they are named after the mesh file, which is written again for each program, so they are only used if they were made from the same triangles
+	TiledMesh::Sources sources;
+	size_t num_triangles;
+	const double* p = Triangles(num_triangles);
+	sources.push_back(std::make_pair(p, num_triangles));
+	unsigned long long source_key = TiledMesh::SourceKey(sources);
+
+	double padding = padding_key * 0.001;
+	if(padding < cu.R)padding = cu.R;
+	char suffix[32];
+	sprintf(suffix, "_%d", padding_key);
+	std::string base_path = m_mesh_path + suffix;
+	TiledMesh* tiled_mesh = TiledMesh::Open(base_path, m_tile_memory_budget, source_key);
+	if(tiled_mesh && tiled_mesh->Padding() < padding)
+	{
+		delete tiled_mesh;
+		tiled_mesh = NULL;
+	}
+	if(tiled_mesh == NULL)
+	{
+		tiled_mesh = TiledMesh::Make(base_path, sources, padding, m_tolerance, m_tile_memory_budget, source_key);
+		if(tiled_mesh == NULL)return NULL;
+	}
+
+	m_tiled_meshes.insert(std::make_pair(padding_key, tiled_mesh));
+	return new AttachTiledDropper(cu, *tiled_mesh, minz);
+}
+
+SurfaceAttach::SurfaceAttach(PointDropper* dropper, double material_allowance, double max_step, double min_step, double tolerance):m_dropper(dropper), m_material_allowance(material_allowance), m_max_step(max_step), m_min_step(min_step), m_tolerance(tolerance), m_num_drops(0)
+{
+}
+
+SurfaceAttach::~SurfaceAttach()
+{
+	delete m_dropper;
+}
+
+int SurfaceAttach::AddPath(const double *xy, int n, double floor)
+{
+	if(n < 0)n = 0;
+	m_xy.insert(m_xy.end(), xy, xy + n * 2);
+	m_sizes.push_back(n);
+	m_floors.push_back(floor);
+	return (int)m_sizes.size() - 1;
+}
+
+int SurfaceAttach::Run()
+{
+	m_result.clear();
+	m_result_sizes.clear();
+	m_result_first.clear();
+
+	int num_drops = 0;
+	if(m_sizes.size() > 0)
+	{
+		num_drops = DropCutter::DropPaths(*m_dropper, m_xy.size() > 0 ? &m_xy[0] : NULL, &m_sizes[0], (int)m_sizes.size(), &m_floors[0], m_max_step, m_min_step, m_tolerance, m_result, m_result_sizes);
+	}
+
+	for(unsigned int i = 2; i < m_result.size(); i += 3)m_result[i] += m_material_allowance;
+
+	int first = 0;
+	for(std::vector<int>::iterator It = m_result_sizes.begin(); It != m_result_sizes.end(); It++)
+	{
+		m_result_first.push_back(first);
+		first += *It;
+	}
+
+	m_xy.clear();
+	m_sizes.clear();
+	m_floors.clear();
+	m_num_drops += num_drops;
+	return num_drops;
+}
@@ -0,0 +1,107 @@
+// SurfaceAttach.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+// attaching moves to a surface, for nc/attach.py, which gets these through the attach library, see AttachLib.cpp
+// the python program hands over the moves it wants attached as paths, and the points it wants to plunge to as paths of one point
+// they are all dropped together, one batch of drops for their first samples and one for each round of halving, see DropCutter::DropPaths,
+// and the python program only gets back the finished cutter locations, with the material allowance added
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "DropCutter.h"
+
+class GTriMesh;
+class CompactMesh;
+class TiledMesh;
+class MappedFile;
+class MeshPyramid;
+class ZMap;
+
+// the triangles of a surface, opened from the files HeeksCNC writes for the python program
+class AttachSurface
+{
+	GTriMesh* m_mesh;
+	CompactMesh* m_compact_mesh;
+	std::map<int, TiledMesh*> m_tiled_meshes; // keyed by the padding, in thousandths, as their files are named
+	MappedFile* m_file; // the file written by CSurfaceMesh::WriteToFile, kept mapped for making tiles and levels from
+	MeshPyramid* m_pyramid; // coarser levels of the triangles, for roughing, or NULL
+	bool m_cache_heights;
+	std::map< std::vector<double>, ZMap* > m_zmaps; // keyed by the cutter's sizes, minz, the material allowance and the tolerance
+	// the droppers handed out, and the height maps, refer to the tiles and height maps, so none are deleted until the surface is
+	double m_box[4]; // of the triangles, minx miny maxx maxy
+	bool m_box_found;
+	std::string m_mesh_path;
+	size_t m_tile_memory_budget;
+	double m_tolerance; // that the triangles were made with
+
+	AttachSurface();
+	AttachSurface(const AttachSurface &);
+	AttachSurface& operator=(const AttachSurface &);
+
+	const double* Triangles(size_t &num_triangles)const;
+	PointDropper* MeshDropper(const Cutter &cu, double minz, double material_allowance);
+
+public:
+	// mesh_path is the file written by CSurfaceMesh::WriteToFile, and tree_path the surface's saved GTriMesh, or empty if it hasn't got one
+	// as in CSurfaceMesh, compact gives a CompactMesh, and a tile memory budget, in bytes, gives a TiledMesh
+	// the tiles are made next to mesh_path, when a cutter is first dropped, because their padding depends on the cutter, and each size of cutter has its own
+	// levels gives a MeshPyramid, which cutters that don't need all the triangles are dropped onto instead
+	// cache_heights keeps a ZMap for each cutter, so the ops and pattern positions after the first one look their heights up
+	// returns NULL if the files can't be read
+	static AttachSurface* Open(const std::string &mesh_path, const std::string &tree_path, bool compact, size_t tile_memory_budget, bool levels, bool cache_heights);
+	~AttachSurface();
+
+	// something to drop the cutter onto the surface with, or NULL if tiles for it can't be made; the caller deletes it
+	// with levels, the material allowance picks the level, see MeshPyramid::ChooseLevel
+	// with cache_heights, heights in smooth places are looked up to within tolerance
+	PointDropper* Dropper(const Cutter &cu, double minz, double material_allowance, double tolerance);
+};
+
+class SurfaceAttach
+{
+	PointDropper* m_dropper;
+	double m_material_allowance;
+	double m_max_step, m_min_step, m_tolerance; // the sampling, as for DropCutter::DropPath
+
+	// the paths waiting to be dropped
+	std::vector<double> m_xy;
+	std::vector<int> m_sizes;
+	std::vector<double> m_floors;
+
+	// the paths dropped by the last Run
+	std::vector<double> m_result;
+	std::vector<int> m_result_sizes;
+	std::vector<int> m_result_first;
+
+	int m_num_drops;
+
+	SurfaceAttach(const SurfaceAttach &);
+	SurfaceAttach& operator=(const SurfaceAttach &);
+
+public:
+	// the dropper is deleted with this
+	SurfaceAttach(PointDropper* dropper, double material_allowance, double max_step, double min_step, double tolerance);
+	~SurfaceAttach();
+
+	// adds a path of n points, xy has x0 y0 x1 y1 ..., which won't be dropped lower than floor, and returns its index for Result
+	int AddPath(const double *xy, int n, double floor);
+
+	// the paths and points waiting for Run
+	int NumPaths()const{return (int)m_sizes.size();}
+	int NumPoints()const{return (int)(m_xy.size() / 2);}
+
+	// drops all the paths added since the last Run, and returns how many drops it took
+	// the paths added after this start at index 0 again
+	int Run();
+
+	// the cutter locations of a path dropped by the last Run, x y z for each, already simplified and with the material allowance added
+	int ResultSize(int path)const{return m_result_sizes[path];}
+	const double* Result(int path)const{return (m_result_sizes[path] > 0) ? &m_result[m_result_first[path] * 3] : NULL;}
+
+	// drops done since this was made
+	int NumDrops()const{return m_num_drops;}
+};
@@ -9,6 +9,9 @@
 
 BEGIN_EVENT_TABLE(SurfaceDlg, SolidsDlg)
     EVT_CHECKBOX(ID_SAME_FOR_EACH_POSITION, HeeksObjDlg::OnComboOrCheck)
+    EVT_CHECKBOX(ID_COMPACT_MESH, HeeksObjDlg::OnComboOrCheck)
+    EVT_CHECKBOX(ID_ROUGHING_LEVELS, HeeksObjDlg::OnComboOrCheck)
+    EVT_CHECKBOX(ID_CACHE_HEIGHTS, HeeksObjDlg::OnComboOrCheck)
     EVT_BUTTON(wxID_HELP, SurfaceDlg::OnHelp)
 END_EVENT_TABLE()
 
@@ -19,6 +22,10 @@ SurfaceDlg::SurfaceDlg(wxWindow *parent, HeeksObj* object, const wxString& title
 	leftControls.push_back(MakeLabelAndControl(_("Tolerance"), m_lgthTolerance = new CLengthCtrl(this)));
 	leftControls.push_back(MakeLabelAndControl(_("Material Allowance"), m_lgthMaterialAllowance = new CLengthCtrl(this)));
 	leftControls.push_back( HControl( m_chkSameForEachPosition = new wxCheckBox( this, ID_SAME_FOR_EACH_POSITION, _("Same for Each Pattern Position") ), wxALL ));
+	leftControls.push_back( HControl( m_chkCompactMesh = new wxCheckBox( this, ID_COMPACT_MESH, _("Compact Mesh, for Very Big Surfaces") ), wxALL ));
+	leftControls.push_back(MakeLabelAndControl(_("Tile Memory Budget MB, 0 for No Tiles"), m_dblTileMemoryBudget = new CDoubleCtrl(this)));
+	leftControls.push_back( HControl( m_chkRoughingLevels = new wxCheckBox( this, ID_ROUGHING_LEVELS, _("Coarser Triangles for Roughing") ), wxALL ));
+	leftControls.push_back( HControl( m_chkCacheHeights = new wxCheckBox( this, ID_CACHE_HEIGHTS, _("Cache Heights for Later Operations") ), wxALL ));
 
 	if(top_level)
 	{
@@ -32,6 +39,10 @@ void SurfaceDlg::GetDataRaw(HeeksObj* object)
 	((CSurface*)object)->m_tolerance = m_lgthTolerance->GetValue();
 	((CSurface*)object)->m_material_allowance = m_lgthMaterialAllowance->GetValue();
 	((CSurface*)object)->m_same_for_each_pattern_position = m_chkSameForEachPosition->GetValue();
+	((CSurface*)object)->m_compact_mesh = m_chkCompactMesh->GetValue();
+	((CSurface*)object)->m_tile_memory_budget = m_dblTileMemoryBudget->GetValue();
+	((CSurface*)object)->m_roughing_levels = m_chkRoughingLevels->GetValue();
+	((CSurface*)object)->m_cache_heights = m_chkCacheHeights->GetValue();
 	SolidsDlg::GetDataRaw(object);
 }
 
@@ -40,6 +51,10 @@ void SurfaceDlg::SetFromDataRaw(HeeksObj* object)
 	m_lgthTolerance->SetValue(((CSurface*)object)->m_tolerance);
 	m_lgthMaterialAllowance->SetValue(((CSurface*)object)->m_material_allowance);
 	m_chkSameForEachPosition->SetValue(((CSurface*)object)->m_same_for_each_pattern_position != 0);
+	m_chkCompactMesh->SetValue(((CSurface*)object)->m_compact_mesh);
+	m_dblTileMemoryBudget->SetValue(((CSurface*)object)->m_tile_memory_budget);
+	m_chkRoughingLevels->SetValue(((CSurface*)object)->m_roughing_levels);
+	m_chkCacheHeights->SetValue(((CSurface*)object)->m_cache_heights);
 	SolidsDlg::SetFromDataRaw(object);
 }
 
@@ -87,4 +102,4 @@ bool SurfaceDlg::Do(CSurface* object)
 			return false;
 		}
 	}
-}
\ No newline at end of file
+}
\ No newline at end of file
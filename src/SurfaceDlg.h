@@ -3,6 +3,7 @@
 // This program is released under the BSD license. See the file COPYING for details.
 
 class CLengthCtrl;
+class CDoubleCtrl;
 class CObjectIdsCtrl;
 
 #include "SolidsDlg.h"
@@ -16,12 +17,19 @@ protected:
 		ID_MIN_Z,
 		ID_MATERIAL_ALLOWANCE,
 		ID_SAME_FOR_EACH_POSITION,
+		ID_COMPACT_MESH,
+		ID_ROUGHING_LEVELS,
+		ID_CACHE_HEIGHTS,
 		ID_SURFACE_ENUM_MAX,
 	};
 
 	CLengthCtrl *m_lgthTolerance;
 	CLengthCtrl *m_lgthMaterialAllowance;
 	wxCheckBox *m_chkSameForEachPosition;
+	wxCheckBox *m_chkCompactMesh;
+	CDoubleCtrl *m_dblTileMemoryBudget;
+	wxCheckBox *m_chkRoughingLevels;
+	wxCheckBox *m_chkCacheHeights;
 
 public:
     SurfaceDlg(wxWindow *parent, HeeksObj* object, const wxString& title = wxString(_T("Surface")), bool top_level = true);
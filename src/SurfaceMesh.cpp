@@ -0,0 +1,304 @@
+// SurfaceMesh.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "stdafx.h"
+#include "SurfaceMesh.h"
+#include "Surface.h"
+#include "GTriMesh.h"
+#include "CompactMesh.h"
+#include "TiledMesh.h"
+#include "MappedFile.h"
+#include "TessellationCache.h"
+#include "DropCutter.h"
+
+std::map<CSurface*, CSurfaceMesh*> CSurfaceMesh::m_meshes;
+
+CSurfaceMesh::CSurfaceMesh(CSurface* surface):m_mesh(NULL), m_compact_mesh(NULL), m_compact(surface->m_compact_mesh), m_tiled_mesh(NULL), m_tile_memory_budget((size_t)(surface->m_tile_memory_budget * 1048576)), m_tolerance(surface->m_tolerance)
+{
+	// the key for the whole mesh comes from the keys of the solids
+	m_key = TessellationCache::Hash(&m_tolerance, sizeof(double));
+	for (std::list<int>::iterator It = surface->m_solids.begin(); It != surface->m_solids.end(); It++)
+	{
+		HeeksObj* object = heeksCAD->GetIDObject(SolidType, *It);
+		if (object == NULL)continue;
+		unsigned long long key = TessellationCache::GetKey(object, m_tolerance);
+		m_solids.push_back(object);
+		m_solid_keys.push_back(key);
+		m_key = TessellationCache::Hash(&key, sizeof(key), m_key);
+	}
+}
+
+CSurfaceMesh::~CSurfaceMesh()
+{
+	delete m_mesh;
+	delete m_compact_mesh;
+	delete m_tiled_mesh;
+}
+
+const GTriMesh& CSurfaceMesh::Mesh()
+{
+	if(m_mesh == NULL)
+	{
+		std::string filepath(TessellationCache::GetCacheFilePath(m_key, _T(".gtri")).utf8_str());
+		m_mesh = GTriMesh::Open(filepath);
+		if(m_mesh == NULL)
+		{
+			std::list<GTri> triangles;
+			for(unsigned int i = 0; i<m_solids.size(); i++)
+			{
+				TessellationCache::GetTriangles(m_solids[i], m_solid_keys[i], m_tolerance, triangles);
+			}
+			m_mesh = new GTriMesh(triangles);
+			m_mesh->Save(filepath, m_tolerance);
+		}
+	}
+	return *m_mesh;
+}
+
+const CompactMesh& CSurfaceMesh::Compact()
+{
+	if(m_compact_mesh == NULL)
+	{
+		// the triangles as doubles are only needed while the mesh is made
+		std::vector<double> p;
+		for(unsigned int i = 0; i<m_solids.size(); i++)
+		{
+			TessellationCache::GetTriangles(m_solids[i], m_solid_keys[i], m_tolerance, p);
+		}
+		m_compact_mesh = new CompactMesh(p.size() > 0 ? &p[0] : NULL, p.size() / 9);
+	}
+	return *m_compact_mesh;
+}
+
+void CSurfaceMesh::MapSolidFiles(std::vector<MappedFile*> &files, std::vector< std::pair<const double*, size_t> > &sources)
+{
+	for(unsigned int i = 0; i<m_solids.size(); i++)
+	{
+		MappedFile* file = new MappedFile;
+		files.push_back(file);
+		wxString filepath = TessellationCache::GetTrianglesFile(m_solids[i], m_solid_keys[i], m_tolerance);
+		if(!file->Open(std::string(filepath.utf8_str())) || file->Size() < sizeof(SurfaceMeshFileHeader))continue;
+		const SurfaceMeshFileHeader* header = (const SurfaceMeshFileHeader*)file->Data();
+		if(memcmp(header->m_magic, "HCNCMESH", 8) != 0 || !SurfaceMeshFileFits(header, file->Size()))continue;
+		sources.push_back(std::make_pair((const double*)((const char*)file->Data() + header->m_header_size), (size_t)header->m_num_triangles));
+	}
+}
+
+TiledMesh* CSurfaceMesh::Tiled(double cutter_radius)
+{
+	if(m_tiled_mesh && m_tiled_mesh->Padding() < cutter_radius)
+	{
+		// these tiles aren't padded enough for this cutter
+		delete m_tiled_mesh;
+		m_tiled_mesh = NULL;
+	}
+
+	if(m_tiled_mesh == NULL)
+	{
+		unsigned long long key = TessellationCache::Hash(&cutter_radius, sizeof(double), m_key);
+		std::string base_path(TessellationCache::GetCacheFilePath(key, _T("")).utf8_str());
+		m_tiled_mesh = TiledMesh::Open(base_path, m_tile_memory_budget, key);
+		if(m_tiled_mesh == NULL)
+		{
+			// map the solids' triangle files, rather than reading them in
+			std::vector<MappedFile*> files;
+			TiledMesh::Sources sources;
+			MapSolidFiles(files, sources);
+
+			m_tiled_mesh = TiledMesh::Make(base_path, sources, cutter_radius, m_tolerance, m_tile_memory_budget, key);
+
+			for(std::vector<MappedFile*>::iterator It = files.begin(); It != files.end(); It++)delete *It;
+		}
+	}
+
+	return m_tiled_mesh;
+}
+
+template<class Mesh> class SurfaceMeshDropper: public PointDropper
+{
+	Cutter m_cu;
+	const Mesh &m_mesh;
+	double m_minz;
+public:
+	SurfaceMeshDropper(const Cutter &cu, const Mesh &mesh, double minz):m_cu(cu), m_mesh(mesh), m_minz(minz){}
+	void Drop(const double *xy, int n, double *z)
+	{
+		DropCutter::DropPoints(m_cu, m_mesh, xy, n, m_minz, z);
+	}
+};
+
+class SurfaceTiledDropper: public PointDropper
+{
+	Cutter m_cu;
+	TiledMesh &m_mesh;
+	double m_minz;
+public:
+	SurfaceTiledDropper(const Cutter &cu, TiledMesh &mesh, double minz):m_cu(cu), m_mesh(mesh), m_minz(minz){}
+	void Drop(const double *xy, int n, double *z)
+	{
+		m_mesh.DropPoints(m_cu, xy, n, m_minz, z);
+	}
+};
+
+PointDropper* CSurfaceMesh::Dropper(const Cutter &cu, double minz)
+{
+	if(IsTiled())
+	{
+		TiledMesh* tiled_mesh = Tiled(cu.R);
+		if(tiled_mesh)return new SurfaceTiledDropper(cu, *tiled_mesh, minz);
+	}
+
+	if(m_compact)return new SurfaceMeshDropper<CompactMesh>(cu, Compact(), minz);
+	return new SurfaceMeshDropper<GTriMesh>(cu, Mesh(), minz);
+}
+
+void CSurfaceMesh::GetBox(CBox &box)
+{
+	for(std::vector<HeeksObj*>::iterator It = m_solids.begin(); It != m_solids.end(); It++)
+	{
+		(*It)->GetBox(box);
+	}
+}
+
+wxString CSurfaceMesh::TreeFilePath()
+{
+	if(m_compact || IsTiled())return _T("");
+
+	// makes sure it has been saved
+	Mesh();
+
+	wxString filepath = TessellationCache::GetCacheFilePath(m_key, _T(".gtri"));
+	if(!wxFileExists(filepath))return _T("");
+	return filepath;
+}
+
+static double* start_file(MappedFile &file, const wxString &filepath, size_t num_triangles, double tolerance)
+{
+	if(!file.Create(std::string(filepath.utf8_str()), sizeof(SurfaceMeshFileHeader) + num_triangles * 9 * sizeof(double)))return NULL;
+
+	SurfaceMeshFileHeader* header = (SurfaceMeshFileHeader*)file.Data();
+	memcpy(header->m_magic, "HCNCMESH", 8);
+	header->m_version = 1;
+	header->m_header_size = sizeof(SurfaceMeshFileHeader);
+	header->m_num_triangles = num_triangles;
+	for(int i = 0; i<6; i++)header->m_box[i] = 0.0;
+	header->m_tolerance = tolerance;
+
+	return (double*)((char*)file.Data() + sizeof(SurfaceMeshFileHeader));
+}
+
+static void finish_file(MappedFile &file)
+{
+	// work out the box from the triangles in the file
+	SurfaceMeshFileHeader* header = (SurfaceMeshFileHeader*)file.Data();
+	const double* p = (const double*)((const char*)file.Data() + sizeof(SurfaceMeshFileHeader));
+	size_t n = (size_t)(header->m_num_triangles * 9);
+	if(n == 0)return;
+
+	for(int j = 0; j<3; j++)header->m_box[j] = header->m_box[j + 3] = p[j];
+	for(size_t i = 0; i<n; i++)
+	{
+		int j = (int)(i % 3);
+		if(p[i] < header->m_box[j])header->m_box[j] = p[i];
+		if(p[i] > header->m_box[j + 3])header->m_box[j + 3] = p[i];
+	}
+}
+
+bool CSurfaceMesh::WriteToFile(const wxString &filepath)
+{
+	if(m_compact || IsTiled())
+	{
+		// don't make a GTriMesh just to write the file; copy the solids' mapped files into it
+		std::vector<MappedFile*> files;
+		std::vector< std::pair<const double*, size_t> > sources;
+		MapSolidFiles(files, sources);
+
+		size_t num_triangles = 0;
+		for(unsigned int i = 0; i<sources.size(); i++)num_triangles += sources[i].second;
+
+		MappedFile file;
+		double* p = start_file(file, filepath, num_triangles, m_tolerance);
+		if(p)
+		{
+			for(unsigned int i = 0; i<sources.size(); i++)
+			{
+				memcpy(p, sources[i].first, sources[i].second * 9 * sizeof(double));
+				p += sources[i].second * 9;
+			}
+			finish_file(file);
+		}
+
+		for(std::vector<MappedFile*>::iterator It = files.begin(); It != files.end(); It++)delete *It;
+		return p != NULL;
+	}
+
+	const GTriMesh& mesh = Mesh();
+
+	MappedFile file;
+	double* p = start_file(file, filepath, mesh.NumTriangles(), m_tolerance);
+	if(p == NULL)return false;
+
+	// the triangles go straight into the mapped memory
+	for(int i = 0; i<mesh.NumTriangles(); i++, p += 9)
+	{
+		mesh.GetTriangle(i, p);
+	}
+
+	finish_file(file);
+	return true;
+}
+
+// static
+bool CSurfaceMesh::WriteFile(const wxString &filepath, const std::vector<double> &p, double tolerance)
+{
+	MappedFile file;
+	double* file_p = start_file(file, filepath, p.size() / 9, tolerance);
+	if(file_p == NULL)return false;
+
+	if(p.size() > 0)memcpy(file_p, &p[0], (p.size() / 9) * 9 * sizeof(double));
+
+	finish_file(file);
+	return true;
+}
+
+// static
+bool CSurfaceMesh::ReadFile(const wxString &filepath, std::vector<double> &p)
+{
+	if(!wxFileExists(filepath))return false;
+
+	MappedFile file;
+	if(!file.Open(std::string(filepath.utf8_str())))return false;
+	if(file.Size() < sizeof(SurfaceMeshFileHeader))return false;
+
+	const SurfaceMeshFileHeader* header = (const SurfaceMeshFileHeader*)file.Data();
+	if(memcmp(header->m_magic, "HCNCMESH", 8) != 0 || header->m_version != 1)return false;
+	if(!SurfaceMeshFileFits(header, file.Size()))return false;
+
+	const double* file_p = (const double*)((const char*)file.Data() + header->m_header_size);
+	p.assign(file_p, file_p + header->m_num_triangles * 9);
+	return true;
+}
+
+// static
+CSurfaceMesh* CSurfaceMesh::Get(CSurface* surface)
+{
+	std::map<CSurface*, CSurfaceMesh*>::iterator FindIt = m_meshes.find(surface);
+	if(FindIt != m_meshes.end())return FindIt->second;
+
+	CSurfaceMesh* mesh = new CSurfaceMesh(surface);
+	m_meshes.insert(std::make_pair(surface, mesh));
+	return mesh;
+}
+
+// static
+void CSurfaceMesh::ClearAll()
+{
+	for(std::map<CSurface*, CSurfaceMesh*>::iterator It = m_meshes.begin(); It != m_meshes.end(); It++)
+	{
+		delete It->second;
+	}
+	m_meshes.clear();
+
+	// the solids' triangles stay in the cache, unless the last program didn't use them
+	TessellationCache::RemoveUnused();
+}
@@ -0,0 +1,88 @@
+// SurfaceMesh.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+// the triangles of a surface's solids, tessellated in HeeksCNC and kept in memory while the program is written
+// DropCutter uses them directly, and the python program gets them through a mapped file, instead of an STL file
+// the GTriMesh, with its tree, is saved in the tessellation cache folder, and mapped from there when the same solids are used again
+// a surface with "compact mesh" set gets a CompactMesh instead, which takes about a ninth of the memory, but is slower to test
+// a surface with a tile memory budget gets a TiledMesh, for surfaces bigger than memory
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include "GTri.h"
+#include "SurfaceMeshFile.h"
+
+class CSurface;
+class GTriMesh;
+class CompactMesh;
+class TiledMesh;
+class MappedFile;
+class PointDropper;
+class Cutter;
+class CBox;
+
+class CSurfaceMesh
+{
+	GTriMesh* m_mesh;
+	CompactMesh* m_compact_mesh;
+	bool m_compact;
+	TiledMesh* m_tiled_mesh;
+	size_t m_tile_memory_budget; // in bytes, 0 for no tiles
+	double m_tolerance;
+	std::vector<HeeksObj*> m_solids;
+	std::vector<unsigned long long> m_solid_keys;
+	unsigned long long m_key; // of all the solids together
+
+	static std::map<CSurface*, CSurfaceMesh*> m_meshes;
+
+	// maps the files of the solids' triangles, adding the files, and where their triangles are, to the lists
+	void MapSolidFiles(std::vector<MappedFile*> &files, std::vector< std::pair<const double*, size_t> > &sources);
+
+public:
+	CSurfaceMesh(CSurface* surface);
+	~CSurfaceMesh();
+
+	// the triangles with a tree over them, for DropCutter
+	// made when first asked for, by mapping the saved mesh, or from the solids' triangles if there isn't one
+	const GTriMesh& Mesh();
+
+	// the triangles as a CompactMesh, made when first asked for; it isn't saved, because it is quick to make
+	const CompactMesh& Compact();
+
+	// whether the surface asked for a CompactMesh; use Compact() instead of Mesh() if so
+	bool IsCompact()const{return m_compact;}
+
+	// the triangles in tiles padded for a cutter of radius up to cutter_radius, made when first asked for, or NULL if they couldn't be saved
+	// the tiles are kept in the tessellation cache folder, and the triangles are read from the solids' files there, so they are never all in memory
+	TiledMesh* Tiled(double cutter_radius);
+
+	// whether the surface asked for a TiledMesh; use Tiled() instead of Mesh() if so
+	bool IsTiled()const{return m_tile_memory_budget > 0;}
+
+	// a dropper for the cutter, onto the tiles, the CompactMesh or the GTriMesh, whichever the surface asked for, for operations which drop the cutter themselves
+	// the heights aren't lower than minz; delete it after use, before ClearAll
+	PointDropper* Dropper(const Cutter &cu, double minz);
+
+	// the box around the surface's solids
+	void GetBox(CBox &box);
+
+	// the file the GTriMesh is saved in, for the attach library to map, or an empty string for a compact or tiled surface, or if it couldn't be saved
+	wxString TreeFilePath();
+
+	// writes the triangles to a mapped file for nc/attach.py, and ocl_funcs.STLSurfFromMesh
+	// the file has a header, then nine doubles for each triangle
+	bool WriteToFile(const wxString &filepath);
+
+	// the same file format, for triangles kept as nine doubles each
+	static bool WriteFile(const wxString &filepath, const std::vector<double> &p, double tolerance);
+	static bool ReadFile(const wxString &filepath, std::vector<double> &p);
+
+	// the mesh for a surface, made the first time it is asked for, and kept until ClearAll
+	// the solids' triangles come from TessellationCache, so unchanged solids aren't tessellated again
+	static CSurfaceMesh* Get(CSurface* surface);
+	static void ClearAll();
+};
@@ -0,0 +1,27 @@
+// SurfaceMeshFile.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+// the file format which CSurfaceMesh hands a surface's triangles to the python program in
+// it is on its own, without wx, so the attach library can read it too
+
+#pragma once
+
+// the start of the file written by CSurfaceMesh::WriteToFile
+class SurfaceMeshFileHeader
+{
+public:
+	char m_magic[8]; // "HCNCMESH"
+	unsigned int m_version; // 1
+	unsigned int m_header_size; // where the triangles start, sizeof(SurfaceMeshFileHeader)
+	unsigned long long m_num_triangles;
+	double m_box[6]; // minx miny minz maxx maxy maxz of all the triangles
+	double m_tolerance; // that the solids were tessellated with
+};
+
+// returns true if a file of file_size bytes, starting with header, has room for all the triangles the header says it has
+// it divides rather than multiplies, so a damaged count can't wrap around to a small size
+inline bool SurfaceMeshFileFits(const SurfaceMeshFileHeader* header, unsigned long long file_size)
+{
+	if(header->m_header_size < sizeof(SurfaceMeshFileHeader) || header->m_header_size > file_size)return false;
+	return header->m_num_triangles <= (file_size - header->m_header_size) / (9 * sizeof(double));
+}
@@ -0,0 +1,190 @@
+// TessellationCache.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "stdafx.h"
+#include "TessellationCache.h"
+#include "SurfaceMesh.h"
+
+#include <wx/stdpaths.h>
+#include <wx/filename.h>
+#include <wx/ffile.h>
+#include <wx/dir.h>
+
+std::map<unsigned long long, TessellationCache::Entry*> TessellationCache::m_entries;
+std::set<unsigned long long> TessellationCache::m_used_keys;
+
+static std::vector<double>* triangles_for_callback = NULL;
+
+static void add_triangle(const double* x, const double* n)
+{
+	triangles_for_callback->insert(triangles_for_callback->end(), x, x + 9);
+}
+
+// static
+unsigned long long TessellationCache::Hash(const void* data, size_t size, unsigned long long hash)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for(size_t i = 0; i<size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// static
+unsigned long long TessellationCache::GetKey(HeeksObj* solid, double tolerance)
+{
+	// write the solid's XML to a file, and hash that
+	// the file has a name of its own, so two copies of HeeksCNC don't write the same file at once
+	wxFileName filepath(wxFileName::CreateTempFileName(wxFileName::GetTempDir() + wxFileName::GetPathSeparator() + _T("heekscnc_solid_for_hash")));
+	std::list<HeeksObj*> objects;
+	objects.push_back(solid);
+	heeksCAD->SaveXMLFile(objects, filepath.GetFullPath().c_str(), false);
+
+	unsigned long long hash = 14695981039346656037ULL;
+	wxFFile file(filepath.GetFullPath(), _T("rb"));
+	if(file.IsOpened())
+	{
+		char buffer[65536];
+		size_t n;
+		while((n = file.Read(buffer, sizeof(buffer))) > 0)hash = Hash(buffer, n, hash);
+		file.Close();
+	}
+	wxRemoveFile(filepath.GetFullPath());
+
+	return Hash(&tolerance, sizeof(double), hash);
+}
+
+// static
+wxString TessellationCache::GetCacheFolder()
+{
+	// next to the project, or in the temp folder if it hasn't been saved yet
+	if(heeksCAD->GetProjectFileName().IsOk())
+	{
+		return heeksCAD->GetProjectFileName().GetPath(wxPATH_GET_SEPARATOR) + heeksCAD->GetProjectFileName().GetName() + _T("_meshcache");
+	}
+
+	return wxFileName::GetTempDir() + wxFileName::GetPathSeparator() + _T("heekscnc_meshcache");
+}
+
+// static
+wxString TessellationCache::GetCacheFilePath(unsigned long long key, const wxString &extension)
+{
+	m_used_keys.insert(key);
+	wxString folder = GetCacheFolder();
+	if(!wxFileName::DirExists(folder))wxFileName::Mkdir(folder, 0777, wxPATH_MKDIR_FULL);
+	return folder + wxFileName::GetPathSeparator() + wxString::Format(_T("%08x%08x"), (unsigned int)(key >> 32), (unsigned int)(key & 0xffffffff)) + extension;
+}
+
+// static
+void TessellationCache::RemoveUnusedFiles()
+{
+	// not the folder in the temp folder, which is shared by all the projects which haven't been saved
+	if(!heeksCAD->GetProjectFileName().IsOk())return;
+
+	wxString folder = GetCacheFolder();
+	if(!wxFileName::DirExists(folder))return;
+
+	std::set<wxString> used;
+	for(std::set<unsigned long long>::iterator It = m_used_keys.begin(); It != m_used_keys.end(); It++)
+	{
+		unsigned long long key = *It;
+		used.insert(wxString::Format(_T("%08x%08x"), (unsigned int)(key >> 32), (unsigned int)(key & 0xffffffff)));
+	}
+
+	// every file's name starts with its key, like 0123456789abcdef.mesh or 0123456789abcdef_12.tile
+	wxArrayString files;
+	wxDir::GetAllFiles(folder, &files, wxEmptyString, wxDIR_FILES);
+	wxLogNull no_log; // a file another program has open can't be deleted on Windows; leave it for next time
+	for(size_t i = 0; i<files.GetCount(); i++)
+	{
+		wxString name = wxFileName(files[i]).GetFullName();
+		if(used.find(name.Left(16)) == used.end())wxRemoveFile(files[i]);
+	}
+}
+
+// static
+TessellationCache::Entry* TessellationCache::GetEntry(HeeksObj* solid, unsigned long long key, double tolerance)
+{
+	Entry* entry = NULL;
+	std::map<unsigned long long, Entry*>::iterator FindIt = m_entries.find(key);
+	if(FindIt != m_entries.end())
+	{
+		entry = FindIt->second;
+	}
+	else
+	{
+		entry = new Entry;
+		m_entries.insert(std::make_pair(key, entry));
+
+		// read the triangles from the cache folder, or tessellate the solid and save them there
+		wxString filepath = GetCacheFilePath(key, _T(".mesh"));
+		if(!CSurfaceMesh::ReadFile(filepath, entry->m_p))
+		{
+			entry->m_p.clear();
+			triangles_for_callback = &(entry->m_p);
+			solid->GetTriangles(add_triangle, tolerance);
+			triangles_for_callback = NULL;
+
+			CSurfaceMesh::WriteFile(filepath, entry->m_p, tolerance);
+		}
+	}
+
+	entry->m_used = true;
+	return entry;
+}
+
+// static
+void TessellationCache::GetTriangles(HeeksObj* solid, unsigned long long key, double tolerance, std::list<GTri> &triangles)
+{
+	Entry* entry = GetEntry(solid, key, tolerance);
+	for(size_t i = 0; i + 9 <= entry->m_p.size(); i += 9)
+	{
+		triangles.push_back(GTri(&(entry->m_p[i])));
+	}
+}
+
+// static
+void TessellationCache::GetTriangles(HeeksObj* solid, unsigned long long key, double tolerance, std::vector<double> &p)
+{
+	Entry* entry = GetEntry(solid, key, tolerance);
+	p.insert(p.end(), entry->m_p.begin(), entry->m_p.begin() + (entry->m_p.size() / 9) * 9);
+}
+
+// static
+wxString TessellationCache::GetTrianglesFile(HeeksObj* solid, unsigned long long key, double tolerance)
+{
+	wxString filepath = GetCacheFilePath(key, _T(".mesh"));
+	if(!wxFileExists(filepath))GetEntry(solid, key, tolerance);
+	return filepath;
+}
+
+// static
+void TessellationCache::RemoveUnused()
+{
+	for(std::map<unsigned long long, Entry*>::iterator It = m_entries.begin(); It != m_entries.end();)
+	{
+		Entry* entry = It->second;
+		if(entry->m_used)
+		{
+			entry->m_used = false;
+			It++;
+		}
+		else
+		{
+			delete entry;
+			m_entries.erase(It++);
+		}
+	}
+}
+
+// static
+void TessellationCache::Clear()
+{
+	for(std::map<unsigned long long, Entry*>::iterator It = m_entries.begin(); It != m_entries.end(); It++)
+	{
+		delete It->second;
+	}
+	m_entries.clear();
+}
@@ -0,0 +1,60 @@
+// TessellationCache.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+// keeps the triangles of each solid, so a solid is only tessellated again when it, or the tolerance, has changed
+// the key is a hash of the solid's XML, which includes its shape, and the tolerance
+// the triangles are kept in memory while they are being used, and in files in a folder next to the project, for next time
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "GTri.h"
+
+class TessellationCache
+{
+	class Entry
+	{
+	public:
+		std::vector<double> m_p; // nine doubles for each triangle
+		bool m_used; // used since the last RemoveUnused
+	};
+
+	static std::map<unsigned long long, Entry*> m_entries;
+	static std::set<unsigned long long> m_used_keys; // keys of the files asked for since HeeksCNC started
+
+	static wxString GetCacheFolder();
+	static Entry* GetEntry(HeeksObj* solid, unsigned long long key, double tolerance);
+
+public:
+	// the key for a solid's triangles
+	static unsigned long long GetKey(HeeksObj* solid, double tolerance);
+
+	// adds the triangles of solid to triangles; key is from GetKey
+	static void GetTriangles(HeeksObj* solid, unsigned long long key, double tolerance, std::list<GTri> &triangles);
+
+	// adds the triangles to p, as nine doubles each, without making a GTri for each one
+	static void GetTriangles(HeeksObj* solid, unsigned long long key, double tolerance, std::vector<double> &p);
+
+	// the file with the triangles of solid, as written by CSurfaceMesh::WriteFile, tessellating the solid to make it if it isn't there
+	// for reading triangles through a mapped file, without keeping them in memory
+	static wxString GetTrianglesFile(HeeksObj* solid, unsigned long long key, double tolerance);
+
+	// where to keep a file for key, in the cache folder, made if it isn't there; extension is like _T(".mesh")
+	static wxString GetCacheFilePath(unsigned long long key, const wxString &extension);
+
+	// FNV-1a, to add data to a hash
+	static unsigned long long Hash(const void* data, size_t size, unsigned long long hash = 14695981039346656037ULL);
+
+	// frees the triangles which haven't been used since the last call; call it before writing a program
+	static void RemoveUnused();
+
+	// deletes the files in the project's cache folder which haven't been asked for since HeeksCNC started
+	// call it after writing a program, so the files the program uses have been asked for
+	static void RemoveUnusedFiles();
+
+	static void Clear();
+};
@@ -0,0 +1,143 @@
+// ThreadPool.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "stdafx.h"
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int num_threads):m_task(NULL), m_generation(0), m_running(0), m_stop(false)
+{
+	if(num_threads <= 0)num_threads = (int)std::thread::hardware_concurrency();
+	if(num_threads <= 0)num_threads = 1;
+
+	for(int i = 0; i<num_threads; i++)m_workers.push_back(new Worker);
+	for(int i = 0; i<num_threads; i++)m_threads.push_back(std::thread(&ThreadPool::WorkerLoop, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_start.notify_all();
+
+	for(std::vector<std::thread>::iterator It = m_threads.begin(); It != m_threads.end(); It++)It->join();
+	for(std::vector<Worker*>::iterator It = m_workers.begin(); It != m_workers.end(); It++)delete *It;
+}
+
+static ThreadPool* shared_pool = NULL;
+static std::mutex shared_pool_mutex;
+
+// static
+ThreadPool& ThreadPool::Get()
+{
+	// made with new and never destroyed by a static destructor, because that runs inside DllMain on Windows,
+	// where joining the worker threads would deadlock on the loader lock
+	std::unique_lock<std::mutex> lock(shared_pool_mutex);
+	if(shared_pool == NULL)shared_pool = new ThreadPool;
+	return *shared_pool;
+}
+
+// static
+void ThreadPool::Shutdown()
+{
+	std::unique_lock<std::mutex> lock(shared_pool_mutex);
+	delete shared_pool;
+	shared_pool = NULL;
+}
+
+bool ThreadPool::GetChunk(int index, std::pair<int, int> &chunk)
+{
+	// take the next of our own chunks
+	{
+		Worker &worker = *(m_workers[index]);
+		std::unique_lock<std::mutex> lock(worker.m_mutex);
+		if(!worker.m_chunks.empty())
+		{
+			chunk = worker.m_chunks.front();
+			worker.m_chunks.pop_front();
+			return true;
+		}
+	}
+
+	// steal the last chunk of another worker
+	int num_workers = (int)m_workers.size();
+	for(int i = 1; i<num_workers; i++)
+	{
+		Worker &victim = *(m_workers[(index + i) % num_workers]);
+		std::unique_lock<std::mutex> lock(victim.m_mutex);
+		if(!victim.m_chunks.empty())
+		{
+			chunk = victim.m_chunks.back();
+			victim.m_chunks.pop_back();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ThreadPool::WorkerLoop(int index)
+{
+	unsigned int generation = 0;
+
+	while(1)
+	{
+		ParallelTask* task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while(!m_stop && m_generation == generation)m_start.wait(lock);
+			if(m_stop)return;
+			generation = m_generation;
+			task = m_task;
+		}
+
+		// no chunks get added while a job is running, so once there are none left this worker is finished
+		std::pair<int, int> chunk;
+		while(GetChunk(index, chunk))
+		{
+			task->Run(chunk.first, chunk.second);
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_running--;
+			if(m_running == 0)m_done.notify_all();
+		}
+	}
+}
+
+void ThreadPool::Run(ParallelTask &task, int n, int chunk_size)
+{
+	if(n <= 0)return;
+	if(chunk_size < 1)chunk_size = 1;
+
+	if(n <= chunk_size || m_threads.size() < 2)
+	{
+		// not worth waking the workers
+		task.Run(0, n);
+		return;
+	}
+
+	std::unique_lock<std::mutex> run_lock(m_run_mutex);
+
+	// give each worker a contiguous run of chunks
+	int num_chunks = (n + chunk_size - 1) / chunk_size;
+	int num_workers = (int)m_workers.size();
+	for(int c = 0; c<num_chunks; c++)
+	{
+		int first = c * chunk_size;
+		int count = (first + chunk_size > n) ? (n - first) : chunk_size;
+		Worker &worker = *(m_workers[(int)(((long long)c * num_workers) / num_chunks)]);
+		std::unique_lock<std::mutex> lock(worker.m_mutex);
+		worker.m_chunks.push_back(std::make_pair(first, count));
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_task = &task;
+	m_running = num_workers;
+	m_generation++;
+	m_start.notify_all();
+	while(m_running > 0)m_done.wait(lock);
+	m_task = NULL;
+}
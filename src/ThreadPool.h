@@ -0,0 +1,65 @@
+// ThreadPool.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+// a pool of worker threads for running the same job over a range of items, like DropCutter raster points
+// the range is cut into chunks, each worker starts with its own contiguous run of chunks,
+// and takes chunks from the other end of another worker's run when its own are finished
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class ParallelTask
+{
+public:
+	virtual ~ParallelTask(){}
+
+	// do items first to first + count - 1. called from the worker threads, so only write to those items' results
+	virtual void Run(int first, int count) = 0;
+};
+
+class ThreadPool
+{
+	class Worker
+	{
+	public:
+		std::mutex m_mutex;
+		std::deque< std::pair<int, int> > m_chunks; // first, count
+	};
+
+	std::vector<std::thread> m_threads;
+	std::vector<Worker*> m_workers;
+
+	std::mutex m_run_mutex; // one Run at a time
+	std::mutex m_mutex; // for all of the following
+	std::condition_variable m_start;
+	std::condition_variable m_done;
+	ParallelTask* m_task;
+	unsigned int m_generation;
+	int m_running;
+	bool m_stop;
+
+	void WorkerLoop(int index);
+	bool GetChunk(int index, std::pair<int, int> &chunk);
+
+public:
+	ThreadPool(int num_threads = 0); // 0 means one thread for each core
+	~ThreadPool();
+
+	int NumThreads()const{return (int)m_threads.size();}
+
+	// runs task on items 0 to n - 1, in chunks of chunk_size, and returns when they have all been done
+	// don't call this from inside a task
+	void Run(ParallelTask &task, int n, int chunk_size);
+
+	// a pool shared by everything, with one thread for each core
+	static ThreadPool& Get();
+
+	// stops and joins the shared pool's threads; call this when closing, not from DllMain or a static destructor
+	// Get will start a new pool if it is called again afterwards
+	static void Shutdown();
+};
@@ -0,0 +1,374 @@
+// TiledMesh.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "stdafx.h"
+#include "TiledMesh.h"
+#include "GTriMesh.h"
+#include "DropCutter.h"
+#include "MappedFile.h"
+
+#include <math.h>
+#include <stdio.h>
+
+// about how many bytes a GTriMesh takes for each triangle, with its edges and tree
+static const double gtrimesh_bytes_per_triangle = 340.0;
+
+// the fewest triangles to put in a tile, so small surfaces don't get lots of tiny tiles
+static const double min_triangles_per_tile = 1000.0;
+
+static void get_box(const double *t, double *box)
+{
+	box[0] = box[2] = t[0];
+	box[1] = box[3] = t[1];
+	for(int v = 1; v<3; v++)
+	{
+		if(t[v * 3] < box[0])box[0] = t[v * 3];
+		if(t[v * 3 + 1] < box[1])box[1] = t[v * 3 + 1];
+		if(t[v * 3] > box[2])box[2] = t[v * 3];
+		if(t[v * 3 + 1] > box[3])box[3] = t[v * 3 + 1];
+	}
+}
+
+TiledMesh::TiledMesh(const std::string &base_path, size_t memory_budget):m_base_path(base_path), m_x0(0.0), m_y0(0.0), m_tile_size(1.0), m_nx(0), m_ny(0), m_padding(0.0), m_tolerance(0.0), m_memory_budget(memory_budget), m_memory_used(0)
+{
+}
+
+TiledMesh::~TiledMesh()
+{
+	for(std::map<int, std::pair<const GTriMesh*, std::list<int>::iterator> >::iterator It = m_tiles.begin(); It != m_tiles.end(); It++)
+	{
+		delete It->second.first;
+	}
+}
+
+std::string TiledMesh::TilePath(int index)const
+{
+	char str[64];
+	sprintf(str, "_%d_%d.gtri", index % m_nx, index / m_nx);
+	return m_base_path + str;
+}
+
+std::string TiledMesh::IndexPath()const
+{
+	return m_base_path + ".tiles";
+}
+
+// static
+TiledMesh* TiledMesh::Make(const std::string &base_path, const Sources &sources, double padding, double tolerance, size_t memory_budget, unsigned long long source_key)
+{
+	TiledMesh* tiled = new TiledMesh(base_path, memory_budget);
+	tiled->m_padding = padding;
+	tiled->m_tolerance = tolerance;
+
+	// the box of all the triangles
+	double box[4] = {0.0, 0.0, 0.0, 0.0};
+	double num_triangles = 0.0;
+	for(Sources::const_iterator It = sources.begin(); It != sources.end(); It++)
+	{
+		for(size_t i = 0; i<It->second; i++)
+		{
+			double tri_box[4];
+			get_box(&(It->first[i * 9]), tri_box);
+			if(num_triangles == 0.0)memcpy(box, tri_box, 4 * sizeof(double));
+			if(tri_box[0] < box[0])box[0] = tri_box[0];
+			if(tri_box[1] < box[1])box[1] = tri_box[1];
+			if(tri_box[2] > box[2])box[2] = tri_box[2];
+			if(tri_box[3] > box[3])box[3] = tri_box[3];
+			num_triangles += 1.0;
+		}
+	}
+
+	// tiles about the size for a quarter of the memory budget, if the triangles are spread evenly
+	double triangles_per_tile = (double)memory_budget / 4 / gtrimesh_bytes_per_triangle;
+	if(triangles_per_tile < min_triangles_per_tile)triangles_per_tile = min_triangles_per_tile;
+	double num_tiles = ceil(num_triangles / triangles_per_tile);
+	if(num_tiles < 1.0)num_tiles = 1.0;
+	double width = box[2] - box[0];
+	double height = box[3] - box[1];
+	double tile_size = sqrt(width * height / num_tiles);
+	if(tile_size <= 0.0)tile_size = ((width > height) ? width : height) / num_tiles;
+	if(tile_size < padding)tile_size = padding; // smaller tiles would mostly be padding
+	if(tile_size <= 0.0)tile_size = 1.0;
+
+	tiled->m_x0 = box[0];
+	tiled->m_y0 = box[1];
+	tiled->m_tile_size = tile_size;
+	tiled->m_nx = (int)ceil(width / tile_size);
+	tiled->m_ny = (int)ceil(height / tile_size);
+	if(tiled->m_nx < 1)tiled->m_nx = 1;
+	if(tiled->m_ny < 1)tiled->m_ny = 1;
+	tiled->m_tile_sizes.resize(tiled->m_nx * tiled->m_ny, 0);
+
+	// a little more padding, so a point which rounds into a tile is still padding away from the triangles left out of it
+	double pad = padding + tile_size * 0.000001 + 0.000000001;
+
+	// one row at a time, so only a row of tiles' triangles are in memory
+	for(int j = 0; j<tiled->m_ny; j++)
+	{
+		double row_box[2] = {tiled->m_y0 + j * tile_size - pad, tiled->m_y0 + (j + 1) * tile_size + pad};
+		std::vector< std::list<GTri> > row(tiled->m_nx);
+
+		for(Sources::const_iterator It = sources.begin(); It != sources.end(); It++)
+		{
+			for(size_t t = 0; t<It->second; t++)
+			{
+				const double* p = &(It->first[t * 9]);
+				double tri_box[4];
+				get_box(p, tri_box);
+				if(tri_box[1] > row_box[1] || tri_box[3] < row_box[0])continue;
+
+				int i0 = (int)floor((tri_box[0] - pad - tiled->m_x0) / tile_size);
+				int i1 = (int)floor((tri_box[2] + pad - tiled->m_x0) / tile_size);
+				if(i0 < 0)i0 = 0;
+				if(i1 > tiled->m_nx - 1)i1 = tiled->m_nx - 1;
+				for(int i = i0; i <= i1; i++)
+				{
+					if(tri_box[0] > tiled->m_x0 + (i + 1) * tile_size + pad || tri_box[2] < tiled->m_x0 + i * tile_size - pad)continue;
+					row[i].push_back(GTri(p));
+				}
+			}
+		}
+
+		for(int i = 0; i<tiled->m_nx; i++)
+		{
+			if(row[i].size() == 0)continue;
+			int index = j * tiled->m_nx + i;
+			std::string path = tiled->TilePath(index);
+			{
+				GTriMesh mesh(row[i]);
+				if(!mesh.Save(path, tolerance))
+				{
+					delete tiled;
+					return NULL;
+				}
+			}
+			row[i].clear();
+
+			MappedFile file;
+			if(!file.Open(path))
+			{
+				delete tiled;
+				return NULL;
+			}
+			tiled->m_tile_sizes[index] = file.Size();
+		}
+	}
+
+	// the index goes last, so tiles which weren't finished are never used
+	MappedFile index_file;
+	size_t num_sizes = tiled->m_tile_sizes.size();
+	if(!index_file.Create(tiled->IndexPath(), sizeof(TiledMeshFileHeader) + num_sizes * sizeof(unsigned long long)))
+	{
+		delete tiled;
+		return NULL;
+	}
+	TiledMeshFileHeader* header = (TiledMeshFileHeader*)index_file.Data();
+	memcpy(header->m_magic, "HCNCTILE", 8);
+	header->m_version = 2;
+	header->m_header_size = sizeof(TiledMeshFileHeader);
+	header->m_nx = tiled->m_nx;
+	header->m_ny = tiled->m_ny;
+	header->m_x0 = tiled->m_x0;
+	header->m_y0 = tiled->m_y0;
+	header->m_tile_size = tiled->m_tile_size;
+	header->m_padding = tiled->m_padding;
+	header->m_tolerance = tiled->m_tolerance;
+	header->m_num_triangles = (unsigned long long)num_triangles;
+	header->m_source_key = source_key;
+	memcpy((char*)index_file.Data() + sizeof(TiledMeshFileHeader), &(tiled->m_tile_sizes[0]), num_sizes * sizeof(unsigned long long));
+
+	return tiled;
+}
+
+// static
+TiledMesh* TiledMesh::Open(const std::string &base_path, size_t memory_budget, unsigned long long source_key)
+{
+	TiledMesh* tiled = new TiledMesh(base_path, memory_budget);
+
+	MappedFile index_file;
+	if(!index_file.Open(tiled->IndexPath()) || index_file.Size() < sizeof(TiledMeshFileHeader))
+	{
+		delete tiled;
+		return NULL;
+	}
+
+	const TiledMeshFileHeader* header = (const TiledMeshFileHeader*)index_file.Data();
+	size_t num_sizes = (size_t)header->m_nx * header->m_ny;
+	if(memcmp(header->m_magic, "HCNCTILE", 8) != 0 || header->m_version != 2 || header->m_header_size < sizeof(TiledMeshFileHeader) || header->m_source_key != source_key || header->m_nx == 0 || header->m_ny == 0 || header->m_tile_size <= 0.0 || header->m_header_size > index_file.Size() || num_sizes > (index_file.Size() - header->m_header_size) / sizeof(unsigned long long))
+	{
+		delete tiled;
+		return NULL;
+	}
+
+	tiled->m_nx = header->m_nx;
+	tiled->m_ny = header->m_ny;
+	tiled->m_x0 = header->m_x0;
+	tiled->m_y0 = header->m_y0;
+	tiled->m_tile_size = header->m_tile_size;
+	tiled->m_padding = header->m_padding;
+	tiled->m_tolerance = header->m_tolerance;
+	const unsigned long long* sizes = (const unsigned long long*)((const char*)index_file.Data() + header->m_header_size);
+	tiled->m_tile_sizes.assign(sizes, sizes + num_sizes);
+	return tiled;
+}
+
+// static
+unsigned long long TiledMesh::SourceKey(const Sources &sources)
+{
+	// FNV-1a, a double at a time
+	unsigned long long hash = 14695981039346656037ULL;
+	for(Sources::const_iterator It = sources.begin(); It != sources.end(); It++)
+	{
+		const unsigned long long* words = (const unsigned long long*)It->first;
+		size_t n = It->second * 9;
+		for(size_t i = 0; i<n; i++)
+		{
+			hash ^= words[i];
+			hash *= 1099511628211ULL;
+		}
+		hash ^= (unsigned long long)It->second;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+int TiledMesh::TileIndex(double x, double y)const
+{
+	int i = (int)floor((x - m_x0) / m_tile_size);
+	int j = (int)floor((y - m_y0) / m_tile_size);
+	if(i < 0)i = 0;
+	if(i > m_nx - 1)i = m_nx - 1;
+	if(j < 0)j = 0;
+	if(j > m_ny - 1)j = m_ny - 1;
+	return j * m_nx + i;
+}
+
+void TiledMesh::UnmapOldTiles(int keep)
+{
+	// the least recently used are at the back
+	while(m_memory_used > m_memory_budget && m_recent.size() > 0 && m_recent.back() != keep)
+	{
+		int index = m_recent.back();
+		m_recent.pop_back();
+		std::map<int, std::pair<const GTriMesh*, std::list<int>::iterator> >::iterator FindIt = m_tiles.find(index);
+		delete FindIt->second.first;
+		m_tiles.erase(FindIt);
+		m_memory_used -= (size_t)m_tile_sizes[index];
+	}
+}
+
+const GTriMesh* TiledMesh::GetTile(int index)
+{
+	if(index < 0 || index >= (int)m_tile_sizes.size() || m_tile_sizes[index] == 0)return NULL;
+
+	std::map<int, std::pair<const GTriMesh*, std::list<int>::iterator> >::iterator FindIt = m_tiles.find(index);
+	if(FindIt != m_tiles.end())
+	{
+		// move it to the front
+		m_recent.erase(FindIt->second.second);
+		m_recent.push_front(index);
+		FindIt->second.second = m_recent.begin();
+		return FindIt->second.first;
+	}
+
+	GTriMesh* mesh = GTriMesh::Open(TilePath(index));
+	if(mesh == NULL)return NULL;
+
+	m_recent.push_front(index);
+	m_tiles.insert(std::make_pair(index, std::make_pair((const GTriMesh*)mesh, m_recent.begin())));
+	m_memory_used += (size_t)m_tile_sizes[index];
+	UnmapOldTiles(index);
+	return mesh;
+}
+
+void TiledMesh::DropTilePoints(const Cutter &cu, const std::vector<int> &points, const double *xy, double minz, double *z, int tile)
+{
+	const GTriMesh* mesh = GetTile(tile);
+	if(mesh == NULL)
+	{
+		// no triangles within the padding of the tile
+		for(std::vector<int>::const_iterator It = points.begin(); It != points.end(); It++)z[*It] = minz;
+		return;
+	}
+
+	std::vector<double> tile_xy(points.size() * 2);
+	std::vector<double> tile_z(points.size());
+	for(size_t i = 0; i<points.size(); i++)
+	{
+		tile_xy[i * 2] = xy[points[i] * 2];
+		tile_xy[i * 2 + 1] = xy[points[i] * 2 + 1];
+	}
+
+	DropCutter::DropPoints(cu, *mesh, &tile_xy[0], (int)points.size(), minz, &tile_z[0]);
+
+	for(size_t i = 0; i<points.size(); i++)z[points[i]] = tile_z[i];
+}
+
+void TiledMesh::DropPoints(const Cutter &cu, const double *xy, int n, double minz, double *z)
+{
+	if(n <= 0)return;
+
+	if(cu.R > m_padding)
+	{
+		// the heights could be too low near the edges of the tiles
+		double values[2] = {cu.R, m_padding};
+		DropCutterDiagnostics::Record(DropCutterDiagnostics::eTilePadding, values, 2);
+	}
+
+	// share the points out between the tiles, keeping the order the tiles are first met
+	std::map<int, std::vector<int> > tile_points;
+	std::vector<int> tile_order;
+	for(int i = 0; i<n; i++)
+	{
+		int tile = TileIndex(xy[i * 2], xy[i * 2 + 1]);
+		std::map<int, std::vector<int> >::iterator FindIt = tile_points.find(tile);
+		if(FindIt == tile_points.end())
+		{
+			FindIt = tile_points.insert(std::make_pair(tile, std::vector<int>())).first;
+			tile_order.push_back(tile);
+		}
+		FindIt->second.push_back(i);
+	}
+
+	for(std::vector<int>::iterator It = tile_order.begin(); It != tile_order.end(); It++)
+	{
+		DropTilePoints(cu, tile_points[*It], xy, minz, z, *It);
+	}
+}
+
+class TiledPointDropper: public PointDropper
+{
+	TiledMesh &m_mesh;
+	const Cutter &m_cu;
+	double m_minz;
+public:
+	TiledPointDropper(TiledMesh &mesh, const Cutter &cu, double minz):m_mesh(mesh), m_cu(cu), m_minz(minz){}
+	void Drop(const double *xy, int n, double *z)
+	{
+		m_mesh.DropPoints(m_cu, xy, n, m_minz, z);
+	}
+};
+
+int TiledMesh::DropPath(const Cutter &cu, const double *xy, int n, double minz, double max_step, double min_step, double tolerance, std::vector<double> &result)
+{
+	TiledPointDropper dropper(*this, cu, minz);
+	return DropCutter::DropPath(dropper, xy, n, max_step, min_step, tolerance, result);
+}
+
+void TiledMesh::DropGrid(const Cutter &cu, double x0, double y0, double dx, double dy, int nx, int ny, double minz, double *z)
+{
+	if(nx <= 0 || ny <= 0)return;
+
+	std::vector<double> xy(nx * ny * 2);
+	for(int j = 0; j<ny; j++)
+	{
+		for(int i = 0; i<nx; i++)
+		{
+			int k = j * nx + i;
+			xy[k * 2] = x0 + i * dx;
+			xy[k * 2 + 1] = y0 + j * dy;
+		}
+	}
+
+	DropPoints(cu, &xy[0], nx * ny, minz, z);
+}
@@ -0,0 +1,114 @@
+// TiledMesh.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+// triangles for DropCutter, for surfaces with too many triangles to keep in memory
+// the triangles are split into a grid of tiles in XY, and each tile is saved as a GTriMesh file
+// a tile also has all the triangles within the padding of it, so a cutter whose radius is no more than the padding,
+// dropped at a point in the tile, only needs that tile, and gets exactly the height it would get from the whole mesh
+// the tiles are mapped in when a drop needs them, and the least recently used ones are unmapped when the tiles
+// mapped in add up to more than the memory budget
+// the paths are UTF-8
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+
+class GTriMesh;
+class Cutter;
+
+class TiledMesh
+{
+public:
+	// triangles to make the tiles from, nine doubles each, and how many of them there are
+	typedef std::vector< std::pair<const double*, size_t> > Sources;
+
+	// makes the tiles from the triangles, and saves them and an index file next to base_path
+	// the size of the tiles is chosen so that a few of them fit in memory_budget bytes
+	// the triangles are read again for each row of tiles, so they can be in mapped files bigger than memory
+	// source_key identifies the triangles, such as a hash of them from SourceKey, and is saved in the index file
+	static TiledMesh* Make(const std::string &base_path, const Sources &sources, double padding, double tolerance, size_t memory_budget, unsigned long long source_key);
+
+	// opens tiles made before with Make, or returns NULL if they aren't there or were made with a different source_key
+	static TiledMesh* Open(const std::string &base_path, size_t memory_budget, unsigned long long source_key);
+
+	// a hash of the triangles and how many there are, for when they have no key of their own
+	static unsigned long long SourceKey(const Sources &sources);
+
+	~TiledMesh();
+
+	// drop the cutter at n points, xy has x0 y0 x1 y1 ... and z gets the n heights, as DropCutter::DropPoints
+	// the points are done a tile at a time, in the order their tiles are first met, so rows of points only map each tile in once
+	void DropPoints(const Cutter &cu, const double *xy, int n, double minz, double *z);
+
+	// as DropCutter::DropGrid
+	void DropGrid(const Cutter &cu, double x0, double y0, double dx, double dy, int nx, int ny, double minz, double *z);
+
+	// as DropCutter::DropPath
+	int DropPath(const Cutter &cu, const double *xy, int n, double minz, double max_step, double min_step, double tolerance, std::vector<double> &result);
+
+	double Padding()const{return m_padding;}
+	double Tolerance()const{return m_tolerance;}
+	int NumTilesX()const{return m_nx;}
+	int NumTilesY()const{return m_ny;}
+
+	// the tile which a point uses; points outside the grid use the nearest tile
+	int TileIndex(double x, double y)const;
+
+	// the tile's mesh, mapped in if it isn't already, or NULL if it has no triangles
+	// the mesh stays mapped until another call to GetTile unmaps it to keep within the memory budget
+	const GTriMesh* GetTile(int index);
+
+	size_t MemoryBudget()const{return m_memory_budget;}
+	void SetMemoryBudget(size_t memory_budget){m_memory_budget = memory_budget;}
+
+	// bytes of the tiles which are mapped in now
+	size_t MemoryUsed()const{return m_memory_used;}
+
+	// the files the tiles and the index are saved in
+	std::string TilePath(int index)const;
+	std::string IndexPath()const;
+
+private:
+	std::string m_base_path;
+	double m_x0, m_y0; // the corner of the grid
+	double m_tile_size;
+	int m_nx, m_ny;
+	double m_padding;
+	double m_tolerance;
+	std::vector<unsigned long long> m_tile_sizes; // bytes in each tile's file, 0 if it has no triangles
+	size_t m_memory_budget;
+	size_t m_memory_used;
+
+	// the mapped tiles, most recently used first
+	std::list<int> m_recent;
+	std::map<int, std::pair<const GTriMesh*, std::list<int>::iterator> > m_tiles;
+
+	TiledMesh(const std::string &base_path, size_t memory_budget);
+	TiledMesh(const TiledMesh &);
+	TiledMesh& operator=(const TiledMesh &);
+
+	void UnmapOldTiles(int keep);
+	void DropTilePoints(const Cutter &cu, const std::vector<int> &points, const double *xy, double minz, double *z, int tile);
+};
+
+// the index file, made by TiledMesh::Make
+// the header is followed by one unsigned long long for each tile, row by row, with the size of the tile's file
+class TiledMeshFileHeader
+{
+public:
+	char m_magic[8]; // "HCNCTILE"
+	unsigned int m_version; // 2
+	unsigned int m_header_size; // where the tile sizes start, sizeof(TiledMeshFileHeader)
+	unsigned int m_nx;
+	unsigned int m_ny;
+	double m_x0;
+	double m_y0;
+	double m_tile_size;
+	double m_padding;
+	double m_tolerance;
+	unsigned long long m_num_triangles;
+	unsigned long long m_source_key; // given to Make, so tiles made from other triangles aren't opened
+};
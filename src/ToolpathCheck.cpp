@@ -0,0 +1,139 @@
+// ToolpathCheck.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "stdafx.h"
+#include "ToolpathCheck.h"
+
+ToolpathCheck::ToolpathCheck(double tolerance):m_tolerance(tolerance), m_pos_known(false), m_num_samples(0), m_num_drops(0)
+{
+	m_samples.reserve(batch_size);
+}
+
+ToolpathCheck::~ToolpathCheck()
+{
+	for(std::vector<Surface*>::iterator It = m_surfaces.begin(); It != m_surfaces.end(); It++)delete *It;
+}
+
+int ToolpathCheck::AddTool(const Cutter &cu, double shank_radius, double flute_length)
+{
+	Tool tool(cu);
+	tool.m_shank_radius = shank_radius;
+	tool.m_flute_length = flute_length;
+	tool.m_step = cu.R * 0.25;
+	if(tool.m_step < m_tolerance)tool.m_step = m_tolerance;
+	m_tools.push_back(tool);
+	return (int)m_tools.size() - 1;
+}
+
+void ToolpathCheck::AddSurface(Surface* surface)
+{
+	m_surfaces.push_back(surface);
+}
+
+void ToolpathCheck::AddSample(const double *p, int tool, bool rapid, int block)
+{
+	Sample sample;
+	memcpy(sample.m_p, p, 3 * sizeof(double));
+	sample.m_tool = tool;
+	sample.m_block = block;
+	sample.m_rapid = rapid;
+	m_samples.push_back(sample);
+	m_num_samples++;
+	if((int)m_samples.size() >= batch_size)CheckSamples();
+}
+
+void ToolpathCheck::MoveTo(const double *p, int tool, bool rapid, int block)
+{
+	if(tool >= 0)
+	{
+		if(!m_pos_known)AddSample(p, tool, rapid, block);
+		else
+		{
+			double v[3] = {p[0] - m_pos[0], p[1] - m_pos[1], p[2] - m_pos[2]};
+			double length = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+			int steps = (int)ceil(length / m_tools[tool].m_step);
+			for(int i = 1; i <= steps; i++)
+			{
+				double t = (double)i / steps;
+				double sp[3] = {m_pos[0] + v[0] * t, m_pos[1] + v[1] * t, m_pos[2] + v[2] * t};
+				AddSample(sp, tool, rapid, block);
+			}
+		}
+	}
+
+	memcpy(m_pos, p, 3 * sizeof(double));
+	m_pos_known = true;
+}
+
+void ToolpathCheck::Finish()
+{
+	CheckSamples();
+}
+
+void ToolpathCheck::CheckSamples()
+{
+	for(unsigned int s = 0; s < m_surfaces.size(); s++)
+	{
+		for(unsigned int tool = 0; tool < m_tools.size(); tool++)
+		{
+			CheckSamples(m_surfaces[s], s, tool, false);
+			if(m_tools[tool].m_flute_length > 0.0 && m_tools[tool].m_shank_radius > 0.0)CheckSamples(m_surfaces[s], s, tool, true);
+		}
+	}
+	m_samples.clear();
+}
+
+void ToolpathCheck::CheckSamples(Surface* surface, int surface_index, int tool, bool shank)
+{
+	// only the samples low enough to touch the surface
+	const Tool &t = m_tools[tool];
+	double lift = shank ? t.m_flute_length : 0.0;
+	double top = surface->Top();
+	std::vector<int> indices;
+	std::vector<double> xy;
+	double minz = 0.0;
+	for(unsigned int i = 0; i < m_samples.size(); i++)
+	{
+		const Sample &sample = m_samples[i];
+		if(sample.m_tool != tool)continue;
+		double z = sample.m_p[2] + lift;
+		if(z + m_tolerance >= top)continue;
+		if(indices.size() == 0 || z < minz)minz = z;
+		indices.push_back(i);
+		xy.push_back(sample.m_p[0]);
+		xy.push_back(sample.m_p[1]);
+	}
+	if(indices.size() == 0)return;
+
+	// the cutter drops to below all the samples, off the edges of the surface
+	std::vector<double> heights(indices.size());
+	PointDropper* dropper = surface->Dropper(shank ? Cutter(t.m_shank_radius, 0.0) : t.m_cutter, minz - 1.0);
+	dropper->Drop(&xy[0], (int)indices.size(), &heights[0]);
+	delete dropper;
+	m_num_drops += (long)indices.size();
+
+	for(unsigned int i = 0; i < indices.size(); i++)
+	{
+		const Sample &sample = m_samples[indices[i]];
+		double depth = heights[i] - (sample.m_p[2] + lift);
+		if(depth <= m_tolerance)continue;
+
+		eProblemType type = shank ? eShank : (sample.m_rapid ? eRapid : eGouge);
+		std::pair<int, int> key(sample.m_block, type);
+		std::map< std::pair<int, int>, Problem >::iterator FindIt = m_problems.find(key);
+		if(FindIt != m_problems.end() && FindIt->second.m_depth >= depth)continue;
+
+		Problem &problem = m_problems[key];
+		problem.m_block = sample.m_block;
+		problem.m_type = type;
+		problem.m_surface = surface_index;
+		problem.m_depth = depth;
+		memcpy(problem.m_p, sample.m_p, 3 * sizeof(double));
+	}
+}
+
+void ToolpathCheck::GetProblems(std::vector<Problem> &problems)const
+{
+	problems.clear();
+	for(std::map< std::pair<int, int>, Problem >::const_iterator It = m_problems.begin(); It != m_problems.end(); It++)problems.push_back(It->second);
+}
@@ -0,0 +1,108 @@
+// ToolpathCheck.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+// checks moves for the cutter going into a surface, rapid moves touching it, and the shank, above the flutes, hitting it
+// the moves are cut into samples, no more than a quarter of the cutter's radius apart, and the samples are dropped onto each surface
+// in big batches, shared out between the cores; with the tool's cutter for the flutes, and a flat cutter as wide as the shank for the shank
+// samples above the top of a surface aren't dropped onto it, so rapid moves over the surface cost next to nothing
+
+#pragma once
+
+#include <vector>
+#include <map>
+
+#include "DropCutter.h"
+
+class ToolpathCheck
+{
+public:
+	typedef enum {
+		eGouge = 0, // a feed move goes into the surface
+		eRapid, // a rapid move touches the surface
+		eShank, // the shank, above the flutes, touches the surface
+		eNumProblemTypes
+	} eProblemType;
+
+	// makes droppers for the cutters, for one surface
+	class Surface
+	{
+	public:
+		virtual ~Surface(){}
+		virtual PointDropper* Dropper(const Cutter &cu, double minz) = 0;
+		virtual double Top() = 0; // the height of the highest point of the surface
+	};
+
+	class Problem
+	{
+	public:
+		int m_block; // as given to MoveTo
+		eProblemType m_type;
+		int m_surface; // the order it was added in
+		double m_depth; // how far into the surface it goes, at the deepest
+		double m_p[3]; // where the deepest sample is
+	};
+
+private:
+	class Tool
+	{
+	public:
+		Cutter m_cutter;
+		double m_shank_radius;
+		double m_flute_length; // from the bottom of the cutter up to the shank
+		double m_step; // the most the samples are apart
+
+		Tool(const Cutter &cu):m_cutter(cu){}
+	};
+
+	class Sample
+	{
+	public:
+		double m_p[3];
+		int m_tool;
+		int m_block;
+		bool m_rapid;
+	};
+
+	double m_tolerance;
+	std::vector<Tool> m_tools;
+	std::vector<Surface*> m_surfaces;
+	std::vector<Sample> m_samples; // waiting to be checked
+	std::map< std::pair<int, int>, Problem > m_problems; // the deepest problem of each type for each block
+	double m_pos[3];
+	bool m_pos_known;
+	long m_num_samples;
+	long m_num_drops;
+
+	ToolpathCheck(const ToolpathCheck &);
+	ToolpathCheck& operator=(const ToolpathCheck &);
+
+	void AddSample(const double *p, int tool, bool rapid, int block);
+	void CheckSamples();
+	void CheckSamples(Surface* surface, int surface_index, int tool, bool shank);
+
+public:
+	static const int batch_size = 262144; // the samples are checked when there are this many waiting
+
+	// a problem is only found if the cutter goes more than tolerance into the surface
+	ToolpathCheck(double tolerance);
+	~ToolpathCheck();
+
+	// returns the tool's index, for MoveTo; the shank isn't checked if flute_length or shank_radius isn't more than zero
+	int AddTool(const Cutter &cu, double shank_radius, double flute_length);
+
+	// the surface is deleted with this
+	void AddSurface(Surface* surface);
+
+	// a straight move, from where the last move went to, to p
+	// tool -1 means the move isn't checked, for moves made without a tool
+	void MoveTo(const double *p, int tool, bool rapid, int block);
+
+	// checks the samples which are still waiting; call this after the last move, before GetProblems
+	void Finish();
+
+	// the deepest problem of each type for each block, in order of block
+	void GetProblems(std::vector<Problem> &problems)const;
+
+	long NumSamples()const{return m_num_samples;}
+	long NumDrops()const{return m_num_drops;}
+};
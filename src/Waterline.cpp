@@ -0,0 +1,283 @@
+// Waterline.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "stdafx.h"
+#include "Waterline.h"
+#include "CNCConfig.h"
+#include "Program.h"
+#include "interface/HeeksObj.h"
+#include "interface/PropertyLength.h"
+#include "tinyxml/tinyxml.h"
+#include "CTool.h"
+#include "Surface.h"
+#include "SurfaceMesh.h"
+#include "DropCutter.h"
+#include "WaterlineLoops.h"
+#include "MoveWriter.h"
+#include "WaterlineDlg.h"
+
+CWaterlineParams::CWaterlineParams()
+{
+	m_tolerance = 0.01;
+}
+
+static void on_set_tolerance(double value, HeeksObj* object)
+{
+	((CWaterline*)object)->m_waterline_params.m_tolerance = value;
+	((CWaterline*)object)->WriteDefaultValues();
+}
+
+void CWaterlineParams::GetProperties(CWaterline* parent, std::list<Property *> *list)
+{
+	list->push_back(new PropertyLength(_("tolerance"), m_tolerance, parent, on_set_tolerance));
+}
+
+void CWaterlineParams::WriteXMLAttributes(TiXmlNode *root)
+{
+	TiXmlElement * element;
+	element = heeksCAD->NewXMLElement( "params" );
+	heeksCAD->LinkXMLEndChild( root,  element );
+	element->SetDoubleAttribute( "tolerance", m_tolerance);
+}
+
+void CWaterlineParams::ReadFromXMLElement(TiXmlElement* pElem)
+{
+	pElem->Attribute("tolerance", &m_tolerance);
+}
+
+bool CWaterlineParams::operator==(const CWaterlineParams & rhs) const
+{
+	if (m_tolerance != rhs.m_tolerance) return(false);
+
+	return(true);
+}
+
+CWaterline::CWaterline(int surface, int tool_number)
+	: CDepthOp(tool_number, WaterlineType)
+{
+	ReadDefaultValues();
+	m_surface = surface;
+}
+
+CWaterline::CWaterline( const CWaterline & rhs ) : CDepthOp(rhs)
+{
+	m_waterline_params = rhs.m_waterline_params;
+}
+
+CWaterline & CWaterline::operator= ( const CWaterline & rhs )
+{
+	if (this != &rhs)
+	{
+		CDepthOp::operator=(rhs);
+		m_waterline_params = rhs.m_waterline_params;
+	}
+
+	return(*this);
+}
+
+bool CWaterline::operator==(const CWaterline & rhs) const
+{
+	if (m_waterline_params != rhs.m_waterline_params) return(false);
+
+	return(CDepthOp::operator==(rhs));
+}
+
+const wxBitmap &CWaterline::GetIcon()
+{
+	if(!m_active)return GetInactiveIcon();
+	static wxBitmap* icon = NULL;
+	if(icon == NULL)icon = new wxBitmap(wxImage(theApp.GetResFolder() + _T("/icons/waterline.png")));
+	return *icon;
+}
+
+Python CWaterline::AppendTextToProgram()
+{
+	Python python;
+
+	CTool *pTool = CTool::Find( m_tool_number );
+	if (pTool == NULL)
+	{
+		wxMessageBox(_("Cannot generate G-Code for waterline without a tool assigned"));
+		return python;
+	} // End if - then
+
+	CSurface* surface = (CSurface*)heeksCAD->GetIDObject(SurfaceType, m_surface);
+	if(surface == NULL)
+	{
+		wxMessageBox(_("Waterline operation - Surface doesn't exist"));
+		return python;
+	}
+
+	CSurfaceMesh* mesh = CSurfaceMesh::Get(surface);
+	CBox box;
+	mesh->GetBox(box);
+	if(!box.m_valid)
+	{
+		wxMessageBox(wxString::Format(_("Waterline operation - Surface %d has no solids"), surface->m_id));
+		return python;
+	}
+
+	std::vector<double> depths;
+	m_depth_op_params.GetDepths(depths);
+	if(depths.size() == 0)
+	{
+		wxMessageBox(_("Waterline operation - There are no depths"));
+		return python;
+	}
+
+	python << CDepthOp::AppendTextToProgram();
+
+	// the cutter was made bigger by the material allowance, so it is dropped to the depths less that
+	// and it doesn't go below the lowest of them, so the cutter drops below all of them off the edges of the surface
+	Cutter cu = pTool->DropCutterDefinition(surface);
+	std::vector<double> heights(depths.size());
+	double minz = 0.0;
+	for(unsigned int i = 0; i < depths.size(); i++)
+	{
+		heights[i] = depths[i] - surface->m_material_allowance;
+		if(i == 0 || heights[i] < minz)minz = heights[i];
+	}
+
+	// the grid's points are half the cutter's radius apart, and go a point past where the cutter touches the solids
+	double tolerance = m_waterline_params.m_tolerance;
+	if(tolerance <= 0.0)tolerance = heeksCAD->GetTolerance();
+	double spacing = cu.R * 0.5;
+	minz -= spacing;
+	double grid_box[4] = {box.MinX() - cu.R - spacing, box.MinY() - cu.R - spacing, box.MaxX() + cu.R + spacing, box.MaxY() + cu.R + spacing};
+	std::vector<WaterlineLoops::Loop> loops;
+	DropCutterDiagnostics::Reset();
+	PointDropper* dropper = mesh->Dropper(cu, minz);
+	WaterlineLoops::Make(*dropper, grid_box, spacing, tolerance, &heights[0], (int)heights.size(), cu.R * 2.0, loops);
+	delete dropper;
+	std::string report = DropCutterDiagnostics::Report();
+	if(report.size() > 0)wxMessageBox(_("Waterline operation - Problems found while dropping the cutter") + _T("\n") + Ctt(report.c_str()));
+
+	// rapid moves go above the solids
+	double safe_z = m_depth_op_params.m_clearance_height;
+	if(box.MaxZ() + surface->m_material_allowance + m_depth_op_params.m_rapid_safety_space > safe_z)safe_z = box.MaxZ() + surface->m_material_allowance + m_depth_op_params.m_rapid_safety_space;
+
+	MoveWriter writer(python);
+	writer.RapidZ(safe_z);
+
+	bool down = false;
+	for(std::vector<WaterlineLoops::Loop>::iterator It = loops.begin(); It != loops.end(); It++)
+	{
+		WaterlineLoops::Loop &loop = *It;
+		int n = (int)(loop.m_xy.size() / 2);
+		double z = depths[loop.m_level];
+		double start[3] = {loop.m_xy[0], loop.m_xy[1], z};
+
+		if(down && loop.m_link_clear)
+		{
+			// stay down and feed across to the next loop
+			writer.Move(true, start);
+		}
+		else
+		{
+			writer.RapidZ(safe_z);
+			double above[3] = {start[0], start[1], safe_z};
+			writer.Move(false, above);
+			writer.RapidZ(z + m_depth_op_params.m_rapid_safety_space);
+			writer.FeedZ(z);
+			down = true;
+		}
+
+		for(int i = 1; i<n; i++)
+		{
+			double p[3] = {loop.m_xy[i * 2], loop.m_xy[i * 2 + 1], z};
+			writer.Move(true, p);
+		}
+		writer.Move(true, start);
+	}
+
+	writer.RapidZ(safe_z);
+
+	return python;
+}
+
+void CWaterline::WriteDefaultValues()
+{
+	CDepthOp::WriteDefaultValues();
+
+	CNCConfig config;
+	config.Write(_T("WaterlineTolerance"), m_waterline_params.m_tolerance);
+}
+
+void CWaterline::ReadDefaultValues()
+{
+	CDepthOp::ReadDefaultValues();
+
+	CNCConfig config;
+	config.Read(_T("WaterlineTolerance"), &m_waterline_params.m_tolerance, 0.01);
+}
+
+void CWaterline::GetProperties(std::list<Property *> *list)
+{
+	m_waterline_params.GetProperties(this, list);
+	CDepthOp::GetProperties(list);
+}
+
+HeeksObj *CWaterline::MakeACopy(void)const
+{
+	return new CWaterline(*this);
+}
+
+void CWaterline::CopyFrom(const HeeksObj* object)
+{
+	operator=(*((CWaterline*)object));
+}
+
+bool CWaterline::CanAddTo(HeeksObj* owner)
+{
+	return ((owner != NULL) && (owner->GetType() == OperationsType));
+}
+
+void CWaterline::WriteXML(TiXmlNode *root)
+{
+	TiXmlElement * element = heeksCAD->NewXMLElement( "Waterline" );
+	heeksCAD->LinkXMLEndChild( root,  element );
+	m_waterline_params.WriteXMLAttributes(element);
+
+	WriteBaseXML(element);
+}
+
+// static member function
+HeeksObj* CWaterline::ReadFromXMLElement(TiXmlElement* element)
+{
+	CWaterline* new_object = new CWaterline;
+
+	std::list<TiXmlElement *> elements_to_remove;
+
+	// read parameters
+	TiXmlElement* params = heeksCAD->FirstNamedXMLChildElement(element, "params");
+	if(params)
+	{
+		new_object->m_waterline_params.ReadFromXMLElement(params);
+		elements_to_remove.push_back(params);
+	}
+
+	for (std::list<TiXmlElement*>::iterator itElem = elements_to_remove.begin(); itElem != elements_to_remove.end(); itElem++)
+	{
+		heeksCAD->RemoveXMLChild( element, *itElem);
+	}
+
+	// read common parameters
+	new_object->ReadBaseXML(element);
+
+	return new_object;
+}
+
+void CWaterline::GetTools(std::list<Tool*>* t_list, const wxPoint* p)
+{
+	CDepthOp::GetTools( t_list, p );
+}
+
+static bool OnEdit(HeeksObj* object)
+{
+	return WaterlineDlg::Do((CWaterline*)object);
+}
+
+void CWaterline::GetOnEdit(bool(**callback)(HeeksObj*))
+{
+	*callback = OnEdit;
+}
@@ -0,0 +1,61 @@
+// Waterline.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+// finishes a surface level by level, at each of the depths, going round the surface where the cutter just touches it, in HeeksCNC, not in the python program
+// the loops are found by WaterlineLoops, which slices each level in its own task, and the python program gets them already in order,
+// each one starting near where the one before started, so its moves aren't attached to the surface again, see COp::AttachesToSurface
+
+#pragma once
+
+#include "HeeksCNCTypes.h"
+#include "DepthOp.h"
+
+class CWaterline;
+
+class CWaterlineParams{
+public:
+	double m_tolerance; // how far the moves can be from where the cutter touches the surface
+
+	CWaterlineParams();
+
+	void GetProperties(CWaterline* parent, std::list<Property *> *list);
+	void WriteXMLAttributes(TiXmlNode* pElem);
+	void ReadFromXMLElement(TiXmlElement* pElem);
+
+	bool operator== ( const CWaterlineParams & rhs ) const;
+	bool operator!= ( const CWaterlineParams & rhs ) const { return(! (*this == rhs)); }
+};
+
+class CWaterline: public CDepthOp{
+public:
+	CWaterlineParams m_waterline_params;
+
+	CWaterline():CDepthOp(0, WaterlineType){}
+	CWaterline(int surface, int tool_number);
+	CWaterline( const CWaterline & rhs );
+	CWaterline & operator= ( const CWaterline & rhs );
+
+	bool operator== ( const CWaterline & rhs ) const;
+	bool operator!= ( const CWaterline & rhs ) const { return(! (*this == rhs)); }
+	bool IsDifferent(HeeksObj *other) { return( *this != (*(CWaterline *)other) ); }
+
+	// HeeksObj's virtual functions
+	int GetType()const{return WaterlineType;}
+	const wxChar* GetTypeString(void) const { return _("Waterline"); }
+	const wxBitmap &GetIcon();
+	void GetProperties(std::list<Property *> *list);
+	HeeksObj *MakeACopy(void)const;
+	void CopyFrom(const HeeksObj* object);
+	void WriteXML(TiXmlNode *root);
+	bool CanAddTo(HeeksObj* owner);
+	void GetTools(std::list<Tool*>* t_list, const wxPoint* p);
+	void GetOnEdit(bool(**callback)(HeeksObj*));
+	void WriteDefaultValues();
+	void ReadDefaultValues();
+
+	// COp's virtual functions
+	Python AppendTextToProgram();
+	bool AttachesToSurface(){return false;}
+
+	static HeeksObj* ReadFromXMLElement(TiXmlElement* pElem);
+};
@@ -0,0 +1,75 @@
+// WaterlineDlg.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "stdafx.h"
+#include "WaterlineDlg.h"
+#include "interface/NiceTextCtrl.h"
+#include "Waterline.h"
+
+BEGIN_EVENT_TABLE(WaterlineDlg, DepthOpDlg)
+    EVT_BUTTON(wxID_HELP, WaterlineDlg::OnHelp)
+END_EVENT_TABLE()
+
+WaterlineDlg::WaterlineDlg(wxWindow *parent, CWaterline* object, const wxString& title, bool top_level)
+             : DepthOpDlg(parent, object, false, title, false)
+{
+	std::list<HControl> save_leftControls = leftControls;
+	leftControls.clear();
+
+	// add all the controls to the left side
+	leftControls.push_back(MakeLabelAndControl(_("Tolerance"), m_lgthTolerance = new CLengthCtrl(this)));
+
+	for(std::list<HControl>::iterator It = save_leftControls.begin(); It != save_leftControls.end(); It++)
+	{
+		leftControls.push_back(*It);
+	}
+
+	if(top_level)
+	{
+		HeeksObjDlg::AddControlsAndCreate();
+		m_cmbSurface->SetFocus();
+	}
+}
+
+void WaterlineDlg::GetDataRaw(HeeksObj* object)
+{
+	((CWaterline*)object)->m_waterline_params.m_tolerance = m_lgthTolerance->GetValue();
+
+	DepthOpDlg::GetDataRaw(object);
+}
+
+void WaterlineDlg::SetFromDataRaw(HeeksObj* object)
+{
+	m_lgthTolerance->SetValue(((CWaterline*)object)->m_waterline_params.m_tolerance);
+
+	DepthOpDlg::SetFromDataRaw(object);
+}
+
+void WaterlineDlg::SetPicture(const wxString& name)
+{
+	HeeksObjDlg::SetPicture(name, _T("waterline"));
+}
+
+void WaterlineDlg::SetPictureByWindow(wxWindow* w)
+{
+	if(w == m_lgthTolerance)SetPicture(_T("tolerance"));
+	else DepthOpDlg::SetPictureByWindow(w);
+}
+
+void WaterlineDlg::OnHelp( wxCommandEvent& event )
+{
+	::wxLaunchDefaultBrowser(_T("http://heeks.net/help/waterline"));
+}
+
+bool WaterlineDlg::Do(CWaterline* object)
+{
+	WaterlineDlg dlg(heeksCAD->GetMainFrame(), object);
+
+	if(dlg.ShowModal() == wxID_OK)
+	{
+		dlg.GetData(object);
+		return true;
+	}
+
+	return false;
+}
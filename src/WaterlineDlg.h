@@ -0,0 +1,27 @@
+// WaterlineDlg.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+class CWaterline;
+class CLengthCtrl;
+
+#include "DepthOpDlg.h"
+
+class WaterlineDlg : public DepthOpDlg
+{
+	CLengthCtrl *m_lgthTolerance;
+
+public:
+	WaterlineDlg(wxWindow *parent, CWaterline* object, const wxString& title = wxString(_("Waterline Operation")), bool top_level = true);
+
+	static bool Do(CWaterline* object);
+
+	// HeeksObjDlg virtual functions
+	void GetDataRaw(HeeksObj* object);
+	void SetFromDataRaw(HeeksObj* object);
+	void SetPictureByWindow(wxWindow* w);
+	void SetPicture(const wxString& name);
+
+	void OnHelp( wxCommandEvent& event );
+
+	DECLARE_EVENT_TABLE()
+};
@@ -0,0 +1,521 @@
+// WaterlineLoops.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "stdafx.h"
+#include "WaterlineLoops.h"
+#include "ThreadPool.h"
+
+// a point to be moved onto the surface, by halving the gap between a point where the cutter drops above the height, and one where it doesn't
+class Bracket
+{
+public:
+	double m_in[2]; // the cutter drops above the height here
+	double m_out[2]; // and not above it here, if m_out_known
+	double m_step[2]; // how far m_out moves on, if it turns out to be above the height as well
+	double m_height;
+	bool m_out_known;
+	bool m_failed; // m_out was still above the height after max_out_steps
+	int m_num_steps;
+};
+
+static const int max_out_steps = 4;
+
+// the most rounds of checking the loops' spans, and the points checked along each span, evenly spaced between its ends
+static const int max_span_rounds = 8;
+static const int span_checks = 3;
+
+// moves the brackets' out points to within tolerance of their in points, in rounds, each round one batch of drops
+static int refine(PointDropper &dropper, std::vector<Bracket> &brackets, double tolerance)
+{
+	int num_drops = 0;
+	std::vector<int> waiting;
+	std::vector<int> dropping;
+	std::vector<double> xy;
+	std::vector<double> z;
+	for(unsigned int i = 0; i < brackets.size(); i++)
+	{
+		brackets[i].m_failed = false;
+		brackets[i].m_num_steps = 0;
+		waiting.push_back(i);
+	}
+
+	while(waiting.size() > 0)
+	{
+		xy.clear();
+		dropping.clear();
+		for(std::vector<int>::iterator It = waiting.begin(); It != waiting.end(); It++)
+		{
+			Bracket &b = brackets[*It];
+			if(b.m_out_known)
+			{
+				double dx = b.m_out[0] - b.m_in[0];
+				double dy = b.m_out[1] - b.m_in[1];
+				if(dx * dx + dy * dy <= tolerance * tolerance)continue;
+				xy.push_back((b.m_in[0] + b.m_out[0]) * 0.5);
+				xy.push_back((b.m_in[1] + b.m_out[1]) * 0.5);
+			}
+			else
+			{
+				xy.push_back(b.m_out[0]);
+				xy.push_back(b.m_out[1]);
+			}
+			dropping.push_back(*It);
+		}
+		if(dropping.size() == 0)break;
+
+		z.resize(dropping.size());
+		dropper.Drop(&xy[0], (int)dropping.size(), &z[0]);
+		num_drops += (int)dropping.size();
+
+		waiting.clear();
+		for(unsigned int i = 0; i < dropping.size(); i++)
+		{
+			Bracket &b = brackets[dropping[i]];
+			bool above = z[i] > b.m_height;
+			if(b.m_out_known)
+			{
+				double* p = above ? b.m_in : b.m_out;
+				p[0] = xy[i * 2];
+				p[1] = xy[i * 2 + 1];
+			}
+			else if(above)
+			{
+				// still over the surface, so go further
+				if(b.m_num_steps == max_out_steps)
+				{
+					b.m_failed = true;
+					continue;
+				}
+				for(int j = 0; j<2; j++)
+				{
+					b.m_in[j] = b.m_out[j];
+					b.m_out[j] += b.m_step[j];
+					b.m_step[j] *= 2.0;
+				}
+				b.m_num_steps++;
+			}
+			else
+			{
+				b.m_out_known = true;
+			}
+			waiting.push_back(dropping[i]);
+		}
+	}
+
+	return num_drops;
+}
+
+// finds the loops where the grid crosses height, as the grid sides they cross, in order
+// the sides are numbered j * nx + i for the one from point i, j to i + 1, j, and nx * ny + j * nx + i for the one from i, j to i, j + 1
+static void slice(const double *grid_z, int nx, int ny, double height, std::vector<int> &sides, std::vector<int> &sizes)
+{
+	int num_points = nx * ny;
+	std::vector<int> next(num_points * 2, -1); // the side the loop goes to next
+
+	for(int j = 0; j < ny - 1; j++)
+	{
+		for(int i = 0; i < nx - 1; i++)
+		{
+			// the corners and sides of the cell, anti-clockwise from the bottom left, side k goes from corner k to corner k + 1
+			int c[4] = {j * nx + i, j * nx + i + 1, (j + 1) * nx + i + 1, (j + 1) * nx + i};
+			int s[4] = {j * nx + i, num_points + j * nx + i + 1, (j + 1) * nx + i, num_points + j * nx + i};
+			bool above[4];
+			int num_above = 0;
+			for(int k = 0; k<4; k++)
+			{
+				above[k] = grid_z[c[k]] > height;
+				if(above[k])num_above++;
+			}
+			if(num_above == 0 || num_above == 4)continue;
+
+			// for a saddle, the height in the middle decides whether the corners above it are joined
+			bool saddle = (above[0] == above[2]) && (above[1] == above[3]);
+			bool joined = saddle && (grid_z[c[0]] + grid_z[c[1]] + grid_z[c[2]] + grid_z[c[3]]) * 0.25 > height;
+
+			// the loop comes in across each side going from below to above, and goes out across a side going from above to below,
+			// the next one round anti-clockwise, or, for joined saddles, the one before, so the corners above are on its right
+			for(int k = 0; k<4; k++)
+			{
+				if(above[k] || !above[(k + 1) % 4])continue;
+				int t;
+				if(saddle)t = joined ? (k + 3) % 4 : (k + 1) % 4;
+				else
+				{
+					t = (k + 1) % 4;
+					while(!above[t] || above[(t + 1) % 4])t = (t + 1) % 4;
+				}
+				next[s[k]] = s[t];
+			}
+		}
+	}
+
+	// follow the sides round each loop
+	for(int first = 0; first < num_points * 2; first++)
+	{
+		if(next[first] == -1)continue;
+		int size = 0;
+		int side = first;
+		while(next[side] != -1)
+		{
+			sides.push_back(side);
+			size++;
+			int n = next[side];
+			next[side] = -1;
+			side = n;
+		}
+		if(side == first)sizes.push_back(size);
+		else sides.resize(sides.size() - size); // it ran off the edge of the grid
+	}
+}
+
+class SliceTask: public ParallelTask
+{
+	const double *m_grid_z;
+	int m_nx, m_ny;
+	const double *m_heights;
+	std::vector< std::vector<int> > &m_sides;
+	std::vector< std::vector<int> > &m_sizes;
+public:
+	SliceTask(const double *grid_z, int nx, int ny, const double *heights, std::vector< std::vector<int> > &sides, std::vector< std::vector<int> > &sizes):m_grid_z(grid_z), m_nx(nx), m_ny(ny), m_heights(heights), m_sides(sides), m_sizes(sizes){}
+	void Run(int first, int count)
+	{
+		for(int i = first; i < first + count; i++)slice(m_grid_z, m_nx, m_ny, m_heights[i], m_sides[i], m_sizes[i]);
+	}
+};
+
+// the distance from p to the line from p0 to p1, in the xy plane
+static double distance_to_line(const double *p0, const double *p1, const double *p)
+{
+	double v[2] = {p1[0] - p0[0], p1[1] - p0[1]};
+	double w[2] = {p[0] - p0[0], p[1] - p0[1]};
+	double vv = v[0] * v[0] + v[1] * v[1];
+	double t = (vv > 0.0) ? (v[0] * w[0] + v[1] * w[1]) / vv : 0.0;
+	if(t < 0.0)t = 0.0;
+	if(t > 1.0)t = 1.0;
+	double d[2] = {w[0] - v[0] * t, w[1] - v[1] * t};
+	return sqrt(d[0] * d[0] + d[1] * d[1]);
+}
+
+// leaves out the points of the loops which are within tolerance of the line from the last point kept to the next point
+class SimplifyTask: public ParallelTask
+{
+	std::vector<WaterlineLoops::Loop> &m_loops;
+	double m_tolerance;
+public:
+	SimplifyTask(std::vector<WaterlineLoops::Loop> &loops, double tolerance):m_loops(loops), m_tolerance(tolerance){}
+	void Run(int first, int count)
+	{
+		std::vector<double> kept;
+		std::vector<int> left_out;
+		for(int loop = first; loop < first + count; loop++)
+		{
+			const std::vector<double> &xy = m_loops[loop].m_xy;
+			int n = (int)(xy.size() / 2);
+			if(n < 4)continue;
+
+			kept.clear();
+			left_out.clear();
+			kept.push_back(xy[0]);
+			kept.push_back(xy[1]);
+			int last_kept = 0;
+			for(int i = 1; i<n; i++)
+			{
+				int next = (i + 1) % n; // the last point's next is the first
+				bool in_line = true;
+				left_out.push_back(i);
+				for(std::vector<int>::iterator It = left_out.begin(); It != left_out.end(); It++)
+				{
+					if(distance_to_line(&xy[last_kept * 2], &xy[next * 2], &xy[*It * 2]) > m_tolerance)
+					{
+						in_line = false;
+						break;
+					}
+				}
+
+				if(!in_line)
+				{
+					kept.push_back(xy[i * 2]);
+					kept.push_back(xy[i * 2 + 1]);
+					last_kept = i;
+					left_out.clear();
+				}
+			}
+
+			if(kept.size() >= 6)m_loops[loop].m_xy.swap(kept);
+		}
+	}
+};
+
+int WaterlineLoops::Make(PointDropper &dropper, const double *box, double spacing, double tolerance, const double *heights, int num_heights, double max_link, std::vector<Loop> &loops)
+{
+	if(num_heights <= 0)return 0;
+	if(tolerance <= 0.0)tolerance = 0.01;
+	if(spacing < tolerance * 2)spacing = tolerance * 2;
+
+	// drop the cutter on the grid, once for all the heights
+	int nx = (int)ceil((box[2] - box[0]) / spacing) + 1;
+	int ny = (int)ceil((box[3] - box[1]) / spacing) + 1;
+	if(nx < 2)nx = 2;
+	if(ny < 2)ny = 2;
+	double dx = (box[2] - box[0]) / (nx - 1);
+	double dy = (box[3] - box[1]) / (ny - 1);
+	std::vector<double> grid_xy(nx * ny * 2);
+	for(int j = 0; j<ny; j++)
+	{
+		for(int i = 0; i<nx; i++)
+		{
+			grid_xy[(j * nx + i) * 2] = box[0] + i * dx;
+			grid_xy[(j * nx + i) * 2 + 1] = box[1] + j * dy;
+		}
+	}
+	std::vector<double> grid_z(nx * ny);
+	dropper.Drop(&grid_xy[0], nx * ny, &grid_z[0]);
+	int num_drops = nx * ny;
+
+	// slice each height in its own task
+	std::vector< std::vector<int> > sides(num_heights);
+	std::vector< std::vector<int> > sizes(num_heights);
+	SliceTask slice_task(&grid_z[0], nx, ny, heights, sides, sizes);
+	ThreadPool::Get().Run(slice_task, num_heights, 1);
+
+	// move the crossings onto the surface, between the ends of the grid's sides, all the heights together
+	// they end up on the side where the cutter is below the height, so the loops leave material, rather than cut into it
+	std::vector<Bracket> brackets;
+	int num_points = nx * ny;
+	for(int level = 0; level < num_heights; level++)
+	{
+		for(std::vector<int>::iterator It = sides[level].begin(); It != sides[level].end(); It++)
+		{
+			int a = (*It < num_points) ? *It : *It - num_points;
+			int b = (*It < num_points) ? a + 1 : a + nx;
+			if(grid_z[a] <= heights[level])std::swap(a, b);
+			Bracket bracket;
+			bracket.m_in[0] = grid_xy[a * 2];
+			bracket.m_in[1] = grid_xy[a * 2 + 1];
+			bracket.m_out[0] = grid_xy[b * 2];
+			bracket.m_out[1] = grid_xy[b * 2 + 1];
+			bracket.m_height = heights[level];
+			bracket.m_out_known = true;
+			brackets.push_back(bracket);
+		}
+	}
+	num_drops += refine(dropper, brackets, tolerance);
+
+	loops.clear();
+	std::vector<Bracket>::iterator BracketIt = brackets.begin();
+	for(int level = 0; level < num_heights; level++)
+	{
+		for(std::vector<int>::iterator It = sizes[level].begin(); It != sizes[level].end(); It++)
+		{
+			loops.push_back(Loop());
+			Loop &loop = loops.back();
+			loop.m_level = level;
+			for(int i = 0; i < *It; i++, BracketIt++)
+			{
+				loop.m_xy.push_back(BracketIt->m_out[0]);
+				loop.m_xy.push_back(BracketIt->m_out[1]);
+			}
+		}
+	}
+
+	// where a loop bends, a span between crossings can cut across where the cutter is above the height, so points along the spans
+	// are checked, and points added on the surface, out to the left of the highest one, where they need them
+	std::vector< std::vector<char> > checked(loops.size());
+	for(unsigned int i = 0; i < loops.size(); i++)checked[i].resize(loops[i].m_xy.size() / 2, 0);
+	std::vector<double> mid_xy;
+	std::vector<double> mid_z;
+	std::vector< std::pair<int, int> > mid_spans;
+	std::vector< std::pair<int, int> > bracket_spans;
+	for(int round = 0; round < max_span_rounds; round++)
+	{
+		mid_xy.clear();
+		mid_spans.clear();
+		for(unsigned int loop = 0; loop < loops.size(); loop++)
+		{
+			const std::vector<double> &xy = loops[loop].m_xy;
+			int n = (int)(xy.size() / 2);
+			for(int i = 0; i<n; i++)
+			{
+				if(checked[loop][i])continue;
+				int next = (i + 1) % n;
+				double vx = xy[next * 2] - xy[i * 2];
+				double vy = xy[next * 2 + 1] - xy[i * 2 + 1];
+				if(vx * vx + vy * vy <= tolerance * tolerance * 4)
+				{
+					checked[loop][i] = 1;
+					continue;
+				}
+				for(int j = 1; j <= span_checks; j++)
+				{
+					double t = (double)j / (span_checks + 1);
+					mid_xy.push_back(xy[i * 2] + vx * t);
+					mid_xy.push_back(xy[i * 2 + 1] + vy * t);
+				}
+				mid_spans.push_back(std::make_pair(loop, i));
+			}
+		}
+		if(mid_spans.size() == 0)break;
+
+		int num_mids = (int)mid_spans.size() * span_checks;
+		mid_z.resize(num_mids);
+		dropper.Drop(&mid_xy[0], num_mids, &mid_z[0]);
+		num_drops += num_mids;
+
+		brackets.clear();
+		bracket_spans.clear();
+		for(unsigned int i = 0; i < mid_spans.size(); i++)
+		{
+			int loop = mid_spans[i].first;
+			int span = mid_spans[i].second;
+			double height = heights[loops[loop].m_level];
+
+			// the point furthest above the height
+			int highest = -1;
+			for(int j = 0; j < span_checks; j++)
+			{
+				int k = i * span_checks + j;
+				if(mid_z[k] > height && (highest == -1 || mid_z[k] > mid_z[highest]))highest = k;
+			}
+			if(highest == -1)
+			{
+				checked[loop][span] = 1;
+				continue;
+			}
+
+			const std::vector<double> &xy = loops[loop].m_xy;
+			int next = (span + 1) % (int)(xy.size() / 2);
+			double vx = xy[next * 2] - xy[span * 2];
+			double vy = xy[next * 2 + 1] - xy[span * 2 + 1];
+			Bracket bracket;
+			bracket.m_in[0] = mid_xy[highest * 2];
+			bracket.m_in[1] = mid_xy[highest * 2 + 1];
+			bracket.m_step[0] = -vy * 0.5;
+			bracket.m_step[1] = vx * 0.5;
+			bracket.m_out[0] = bracket.m_in[0] + bracket.m_step[0];
+			bracket.m_out[1] = bracket.m_in[1] + bracket.m_step[1];
+			bracket.m_height = height;
+			bracket.m_out_known = false;
+			brackets.push_back(bracket);
+			bracket_spans.push_back(mid_spans[i]);
+		}
+		if(brackets.size() == 0)break;
+
+		num_drops += refine(dropper, brackets, tolerance);
+
+		// put the new points in, the spans either side of them to be checked next round
+		std::vector<double> new_xy;
+		std::vector<char> new_checked;
+		unsigned int b = 0;
+		while(b < brackets.size())
+		{
+			int loop = bracket_spans[b].first;
+			const std::vector<double> &xy = loops[loop].m_xy;
+			int n = (int)(xy.size() / 2);
+			new_xy.clear();
+			new_checked.clear();
+			for(int i = 0; i<n; i++)
+			{
+				new_xy.push_back(xy[i * 2]);
+				new_xy.push_back(xy[i * 2 + 1]);
+				new_checked.push_back(checked[loop][i]);
+				if(b < brackets.size() && bracket_spans[b].first == loop && bracket_spans[b].second == i)
+				{
+					if(brackets[b].m_failed)new_checked.back() = 1;
+					else
+					{
+						new_xy.push_back(brackets[b].m_out[0]);
+						new_xy.push_back(brackets[b].m_out[1]);
+						new_checked.push_back(0);
+					}
+					b++;
+				}
+			}
+			loops[loop].m_xy.swap(new_xy);
+			checked[loop].swap(new_checked);
+		}
+	}
+
+	if(loops.size() == 0)return num_drops;
+
+	SimplifyTask simplify_task(loops, tolerance);
+	ThreadPool::Get().Run(simplify_task, (int)loops.size(), 1);
+
+	// order the loops level by level, each one starting at the point nearest to where the one before started and finished
+	std::vector<Loop> ordered;
+	ordered.reserve(loops.size());
+	std::vector<bool> done(loops.size(), false);
+	double pos[2] = {loops[0].m_xy[0], loops[0].m_xy[1]};
+	unsigned int first_of_level = 0;
+	for(int level = 0; level < num_heights; level++)
+	{
+		while(first_of_level < loops.size() && loops[first_of_level].m_level < level)first_of_level++;
+		while(true)
+		{
+			int best_loop = -1;
+			int best_point = 0;
+			double best_d2 = 0.0;
+			for(unsigned int loop = first_of_level; loop < loops.size() && loops[loop].m_level == level; loop++)
+			{
+				if(done[loop])continue;
+				const std::vector<double> &xy = loops[loop].m_xy;
+				for(unsigned int i = 0; i < xy.size(); i += 2)
+				{
+					double d2 = (xy[i] - pos[0]) * (xy[i] - pos[0]) + (xy[i + 1] - pos[1]) * (xy[i + 1] - pos[1]);
+					if(best_loop == -1 || d2 < best_d2)
+					{
+						best_loop = loop;
+						best_point = i;
+						best_d2 = d2;
+					}
+				}
+			}
+			if(best_loop == -1)break;
+
+			done[best_loop] = true;
+			ordered.push_back(Loop());
+			Loop &loop = ordered.back();
+			loop.m_level = level;
+			const std::vector<double> &xy = loops[best_loop].m_xy;
+			loop.m_xy.insert(loop.m_xy.end(), xy.begin() + best_point, xy.end());
+			loop.m_xy.insert(loop.m_xy.end(), xy.begin(), xy.begin() + best_point);
+			pos[0] = loop.m_xy[0];
+			pos[1] = loop.m_xy[1];
+		}
+	}
+	loops.swap(ordered);
+
+	// check the short links, at the height of the loop they go to, which is below the one they come from
+	std::vector<double> link_xy;
+	std::vector<int> link_loops;
+	for(unsigned int loop = 1; loop < loops.size(); loop++)
+	{
+		const double* p0 = &loops[loop - 1].m_xy[0];
+		const double* p1 = &loops[loop].m_xy[0];
+		double vx = p1[0] - p0[0];
+		double vy = p1[1] - p0[1];
+		double length = sqrt(vx * vx + vy * vy);
+		if(length > max_link)continue;
+		int steps = (int)ceil(length / spacing);
+		for(int i = 0; i <= steps; i++)
+		{
+			double t = (steps > 0) ? (double)i / steps : 0.0;
+			link_xy.push_back(p0[0] + vx * t);
+			link_xy.push_back(p0[1] + vy * t);
+			link_loops.push_back(loop);
+		}
+		loops[loop].m_link_clear = true;
+	}
+	if(link_loops.size() > 0)
+	{
+		std::vector<double> link_z(link_loops.size());
+		dropper.Drop(&link_xy[0], (int)link_loops.size(), &link_z[0]);
+		num_drops += (int)link_loops.size();
+		for(unsigned int i = 0; i < link_loops.size(); i++)
+		{
+			Loop &loop = loops[link_loops[i]];
+			if(link_z[i] > heights[loop.m_level])loop.m_link_clear = false;
+		}
+	}
+
+	return num_drops;
+}
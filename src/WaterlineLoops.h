@@ -0,0 +1,36 @@
+// WaterlineLoops.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+// the loops a cutter goes round, at each of a list of heights, to finish a surface level by level
+// the heights the cutter drops to, on a grid over the surface, are the surface offset by the cutter's shape, so where they cross one of
+// the heights is where the cutter touches the surface at that height; the grid is dropped once, for all the heights, then each height is
+// sliced by marching squares in its own task, shared out between the cores, and the crossings are moved onto the surface by halving
+// the sides of the grid they cross, with the drops for all the heights done together, a batch for each round of halving
+
+#pragma once
+
+#include <vector>
+
+#include "DropCutter.h"
+
+class WaterlineLoops
+{
+public:
+	class Loop
+	{
+	public:
+		int m_level; // which of the heights it is at
+		std::vector<double> m_xy; // x0 y0 x1 y1 ..., it closes back to the first point, which isn't repeated at the end
+		bool m_link_clear; // the cutter can feed straight from the start of the loop before, to the start of this one, at this one's height
+
+		Loop():m_level(0), m_link_clear(false){}
+	};
+
+	// box, minx miny maxx maxy, must go far enough past the surface that the cutter drops below all the heights all round its edge
+	// spacing is the most the grid's points are apart, and the loops' points are within tolerance of where the cutter touches the surface
+	// the loops go clockwise round the places where the cutter is higher than the height, so the cutter climb mills, and are in order,
+	// level by level from heights[0], each starting at the point nearest the start of the one before
+	// links between loops no longer than max_link are checked, with drops no more than spacing apart, and m_link_clear set
+	// returns the number of points dropped
+	static int Make(PointDropper &dropper, const double *box, double spacing, double tolerance, const double *heights, int num_heights, double max_link, std::vector<Loop> &loops);
+};
@@ -0,0 +1,169 @@
+// ZMap.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "stdafx.h"
+#include "ZMap.h"
+
+// the heights along a side of a block, at half spacing
+static const int row_size = ZMap::block_size * 2;
+
+ZMap::Block::Block():m_z(row_size * row_size), m_z_state(row_size * row_size, eNotDropped), m_cell_state(block_size * block_size, eNotDropped), m_cell_lift(block_size * block_size, 0.0)
+{
+}
+
+ZMap::ZMap(PointDropper* dropper, const double *box, double spacing, double tolerance):m_dropper(dropper), m_spacing(spacing), m_tolerance(tolerance), m_num_drops(0)
+{
+	memcpy(m_box, box, 4 * sizeof(double));
+}
+
+ZMap::~ZMap()
+{
+	for(std::map< std::pair<int, int>, Block* >::iterator It = m_blocks.begin(); It != m_blocks.end(); It++)delete It->second;
+	delete m_dropper;
+}
+
+// static
+double ZMap::Spacing(double R, double tolerance)
+{
+	// a curve of radius R is within h * h / (8 * R) of its chord of length h
+	if(R < tolerance)R = tolerance;
+	return sqrt(8.0 * R * tolerance) * 2.0;
+}
+
+ZMap::Block* ZMap::GetBlock(int bx, int by)
+{
+	std::map< std::pair<int, int>, Block* >::iterator FindIt = m_blocks.find(std::make_pair(bx, by));
+	if(FindIt != m_blocks.end())return FindIt->second;
+
+	Block* block = new Block;
+	m_blocks.insert(std::make_pair(std::make_pair(bx, by), block));
+	return block;
+}
+
+double& ZMap::Height(int i, int j, char** state)
+{
+	Block* block = GetBlock(i / row_size, j / row_size);
+	int index = (j % row_size) * row_size + (i % row_size);
+	*state = &block->m_z_state[index];
+	return block->m_z[index];
+}
+
+void ZMap::Drop(const double *xy, int n, double *z)
+{
+	// find the cells which aren't done yet, and the heights they need
+	std::vector< std::pair<int, int> > cells;
+	std::vector< std::pair<int, int> > heights;
+	std::vector<double> heights_xy;
+	double half = m_spacing * 0.5;
+	for(int i = 0; i<n; i++)
+	{
+		double x = xy[i * 2], y = xy[i * 2 + 1];
+		if(x < m_box[0] || y < m_box[1] || x > m_box[2] || y > m_box[3])continue;
+		int cx = (int)((x - m_box[0]) / m_spacing);
+		int cy = (int)((y - m_box[1]) / m_spacing);
+		Block* block = GetBlock(cx / block_size, cy / block_size);
+		char &cell_state = block->m_cell_state[(cy % block_size) * block_size + (cx % block_size)];
+		if(cell_state != eNotDropped)continue;
+		cell_state = eWaiting;
+		cells.push_back(std::make_pair(cx, cy));
+
+		for(int hj = cy * 2; hj <= cy * 2 + 2; hj++)
+		{
+			for(int hi = cx * 2; hi <= cx * 2 + 2; hi++)
+			{
+				char* state;
+				Height(hi, hj, &state);
+				if(*state != eNotDropped)continue;
+				*state = eWaiting;
+				heights.push_back(std::make_pair(hi, hj));
+				heights_xy.push_back(m_box[0] + hi * half);
+				heights_xy.push_back(m_box[1] + hj * half);
+			}
+		}
+	}
+
+	if(heights.size() > 0)
+	{
+		std::vector<double> heights_z(heights.size());
+		m_dropper->Drop(&heights_xy[0], (int)heights.size(), &heights_z[0]);
+		m_num_drops += (int)heights.size();
+		for(unsigned int i = 0; i < heights.size(); i++)
+		{
+			char* state;
+			Height(heights[i].first, heights[i].second, &state) = heights_z[i];
+			*state = eDropped;
+		}
+	}
+
+	double smooth_tolerance = m_tolerance * 0.25;
+	for(std::vector< std::pair<int, int> >::iterator It = cells.begin(); It != cells.end(); It++)
+	{
+		int cx = It->first, cy = It->second;
+		double p[3][3];
+		char* state;
+		for(int j = 0; j<3; j++)for(int i = 0; i<3; i++)p[j][i] = Height(cx * 2 + i, cy * 2 + j, &state);
+
+		// how far the heights are from the bilinear interpolation of the corners
+		double z00 = p[0][0], z10 = p[0][2], z01 = p[2][0], z11 = p[2][2];
+		double error = fabs(p[0][1] - (z00 + z10) * 0.5);
+		error = std::max(error, fabs(p[2][1] - (z01 + z11) * 0.5));
+		error = std::max(error, fabs(p[1][0] - (z00 + z01) * 0.5));
+		error = std::max(error, fabs(p[1][2] - (z10 + z11) * 0.5));
+		error = std::max(error, fabs(p[1][1] - (z00 + z10 + z01 + z11) * 0.25));
+
+		Block* block = GetBlock(cx / block_size, cy / block_size);
+		int index = (cy % block_size) * block_size + (cx % block_size);
+		block->m_cell_state[index] = (error <= smooth_tolerance) ? eSmooth : eSteep;
+		block->m_cell_lift[index] = error * 2.0;
+	}
+
+	// look up the points in smooth cells, and drop the rest
+	std::vector<double> exact_xy;
+	std::vector<int> exact_index;
+	for(int i = 0; i<n; i++)
+	{
+		double x = xy[i * 2], y = xy[i * 2 + 1];
+		bool found = false;
+		if(x >= m_box[0] && y >= m_box[1] && x <= m_box[2] && y <= m_box[3])
+		{
+			int cx = (int)((x - m_box[0]) / m_spacing);
+			int cy = (int)((y - m_box[1]) / m_spacing);
+			Block* block = GetBlock(cx / block_size, cy / block_size);
+			int index = (cy % block_size) * block_size + (cx % block_size);
+			if(block->m_cell_state[index] == eSmooth)
+			{
+				// bilinear interpolation between the four nearest heights
+				double u = (x - m_box[0]) / half;
+				double v = (y - m_box[1]) / half;
+				int hi = (int)u;
+				int hj = (int)v;
+				if(hi > cx * 2 + 1)hi = cx * 2 + 1;
+				if(hj > cy * 2 + 1)hj = cy * 2 + 1;
+				u -= hi;
+				v -= hj;
+				char* state;
+				double z00 = Height(hi, hj, &state);
+				double z10 = Height(hi + 1, hj, &state);
+				double z01 = Height(hi, hj + 1, &state);
+				double z11 = Height(hi + 1, hj + 1, &state);
+				z[i] = (z00 * (1.0 - u) + z10 * u) * (1.0 - v) + (z01 * (1.0 - u) + z11 * u) * v + block->m_cell_lift[index];
+				found = true;
+			}
+		}
+
+		if(!found)
+		{
+			exact_xy.push_back(x);
+			exact_xy.push_back(y);
+			exact_index.push_back(i);
+		}
+	}
+
+	if(exact_index.size() > 0)
+	{
+		std::vector<double> exact_z(exact_index.size());
+		m_dropper->Drop(&exact_xy[0], (int)exact_z.size(), &exact_z[0]);
+		m_num_drops += (int)exact_z.size();
+		for(unsigned int i = 0; i < exact_index.size(); i++)z[exact_index[i]] = exact_z[i];
+	}
+}
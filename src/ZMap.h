@@ -0,0 +1,76 @@
+// ZMap.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+// a cache of the heights a cutter is dropped to, on a regular grid, so later drops with the same cutter, onto the same surface,
+// can be looked up instead of tested against the triangles; see AttachSurface::Dropper, which keeps one for each cutter and material allowance
+// the cutter is dropped at the corners of the grid's cells, half way along their sides, and in their middles, the first time a point in the cell is asked for
+// a cell is smooth if the heights half way along its sides, and in its middle, are within a quarter of the tolerance of the heights got from
+// its corners, by bilinear interpolation; points in a smooth cell get the bilinear interpolation of the four nearest of its nine heights,
+// raised by twice the biggest of those differences, so that where the heights between them bend more than that, at the creases a flat
+// cutter makes going over edges, the cutter still errs on the side of leaving material
+// points in other cells, by steep walls and edges, are dropped onto the surface every time
+
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "DropCutter.h"
+
+class ZMap
+{
+	// the cells and heights are kept in blocks, which are made when a point in them is first asked for
+	class Block
+	{
+	public:
+		std::vector<double> m_z; // the heights, at half the spacing, block_size * 2 squared, a row of x at a time
+		std::vector<char> m_z_state; // eNotDropped, eWaiting or eDropped, for each height
+		std::vector<char> m_cell_state; // eNotDropped, eWaiting, eSmooth or eSteep, for each cell, block_size squared
+		std::vector<double> m_cell_lift; // for each cell, added to the heights looked up in it, if it is smooth
+
+		Block();
+	};
+
+	enum
+	{
+		eNotDropped,
+		eWaiting,
+		eDropped,
+		eSmooth,
+		eSteep
+	};
+
+	PointDropper* m_dropper;
+	double m_box[4]; // the grid covers this, minx miny maxx maxy
+	double m_spacing;
+	double m_tolerance;
+	std::map< std::pair<int, int>, Block* > m_blocks;
+	int m_num_drops;
+
+	ZMap(const ZMap &);
+	ZMap& operator=(const ZMap &);
+
+	Block* GetBlock(int bx, int by);
+
+	// the height at i, j, at half the spacing, and its state
+	double& Height(int i, int j, char** state);
+
+public:
+	static const int block_size = 16; // cells along each side of a block
+
+	// the dropper is deleted with this
+	// box is where the grid goes, minx miny maxx maxy; points outside it are always dropped onto the surface
+	ZMap(PointDropper* dropper, const double *box, double spacing, double tolerance);
+	~ZMap();
+
+	// as PointDropper::Drop
+	// the cells the points are in are done first, all together, then the points in cells which aren't smooth
+	void Drop(const double *xy, int n, double *z);
+
+	// the drops done onto the surface, for the grid and for points in cells which aren't smooth
+	int NumDrops()const{return m_num_drops;}
+
+	// a spacing for the grid, for a cutter of radius R; the bilinear interpolation of a ball's height over a
+	// plane, or a curved surface, at half this spacing, is within tolerance, so most cells are smooth
+	static double Spacing(double R, double tolerance);
+};
@@ -0,0 +1,734 @@
+// DropCutterBench.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+// times the DropCutter kernel, and checks its heights haven't changed, without wx or HeeksCAD; see CMakeLists.txt in this folder
+// each of the made up meshes is dropped onto by a flat, a ball, a bull nose and a cone cutter, on a grid of points over the mesh
+// the grids are dropped onto the mesh as a GTriMesh, a CompactMesh and a TiledMesh, whose tiles are made in the current folder, and removed after
+// some of the points are dropped onto the triangles one at a time too, and onto a mesh with each triangle's corners the other way round,
+// and the heights from the mesh are checked against those, returning 1 if any differ; the speeds of the list of triangles and of the mesh's tree are shown
+// the batch tests are checked against the tests of one triangle or edge at a time, which do the same sums, so must give the same heights
+// the mesh's heights, which only test the leaves down to the contact found, highest first, are checked against testing every leaf under the cutter
+// the CompactMesh's bytes per triangle are shown; its grids' heights must be within the tolerance of the GTriMesh's
+// the TiledMesh's heights must be the same as the GTriMesh's
+// the roughing levels of each mesh are made too, and checked to have no more triangles than the mesh, and to be nowhere below it
+// usage: heekscnc_bench [-n points along each side of the grids] [-write golden_file] [-check golden_file]
+// -write saves the heights, and -check compares them with heights saved before, returning 1 if any differ
+// golden.txt in this folder has the heights for -n 32, which ctest checks, see CMakeLists.txt
+
+#include "stdafx.h"
+#include "DropCutter.h"
+#include "GTri.h"
+#include "GTriMesh.h"
+#include "CompactMesh.h"
+#include "TiledMesh.h"
+#include "MeshPyramid.h"
+
+#include <stdlib.h>
+#include <time.h>
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+static const double PI = 3.14159265358979323846;
+
+// heights which differ by more than this, from the golden file, are reported
+static const double golden_tolerance = 0.000001;
+
+// heights from the mesh which differ by more than this, from the heights from the triangles one at a time, are reported
+static const double list_tolerance = 0.000001;
+
+// the TiledMesh's tiles are made for a few hundred triangles each, so the grids go over their sides, and they are mapped in and out
+static const size_t tiled_memory_budget = 1024 * 1024;
+
+// the levels are made with this first error, as the attach library does for triangles made with the tolerance
+static const double first_level_error = 0.004;
+static const int levels_checked = 6;
+
+// the levels are checked with a grid of this many points along each side, over the part of the meshes' square which the cutter doesn't go past
+// past it, the cutter only touches the square's sides side-on, where the tolerance lets the mesh's corners count from just past the cutter's radius
+static const int level_check_points = 60;
+
+// the tests are timed with this many of the grid's points, one at a time, and the mesh's heights are checked at them
+static const int max_points_for_test_timings = 2000;
+
+static double seconds()
+{
+#ifdef WIN32
+	LARGE_INTEGER count, frequency;
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return (double)count.QuadPart / (double)frequency.QuadPart;
+#else
+	timeval t;
+	gettimeofday(&t, NULL);
+	return t.tv_sec + t.tv_usec * 0.000001;
+#endif
+}
+
+static void add_triangle(std::vector<double> &p, double x0, double y0, double z0, double x1, double y1, double z1, double x2, double y2, double z2)
+{
+	double t[9] = {x0, y0, z0, x1, y1, z1, x2, y2, z2};
+	p.insert(p.end(), t, t + 9);
+}
+
+static void add_quad(std::vector<double> &p, const double *a, const double *b, const double *c, const double *d)
+{
+	add_triangle(p, a[0], a[1], a[2], b[0], b[1], b[2], c[0], c[1], c[2]);
+	add_triangle(p, a[0], a[1], a[2], c[0], c[1], c[2], d[0], d[1], d[2]);
+}
+
+// the top half of a sphere, of radius 40, on a 100 by 100 square
+static void make_sphere(std::vector<double> &p)
+{
+	const int segments = 64;
+	const int rings = 16;
+	const double radius = 40.0;
+	for(int j = 0; j<rings; j++)
+	{
+		double a0 = PI * 0.5 * j / rings;
+		double a1 = PI * 0.5 * (j + 1) / rings;
+		for(int i = 0; i<segments; i++)
+		{
+			double b0 = PI * 2.0 * i / segments;
+			double b1 = PI * 2.0 * (i + 1) / segments;
+			double v[4][3] = {
+				{50.0 + radius * cos(a0) * cos(b0), 50.0 + radius * cos(a0) * sin(b0), radius * sin(a0)},
+				{50.0 + radius * cos(a0) * cos(b1), 50.0 + radius * cos(a0) * sin(b1), radius * sin(a0)},
+				{50.0 + radius * cos(a1) * cos(b1), 50.0 + radius * cos(a1) * sin(b1), radius * sin(a1)},
+				{50.0 + radius * cos(a1) * cos(b0), 50.0 + radius * cos(a1) * sin(b0), radius * sin(a1)}};
+			add_quad(p, v[0], v[1], v[2], v[3]);
+		}
+	}
+	double corners[4][3] = {{0.0, 0.0, 0.0}, {100.0, 0.0, 0.0}, {100.0, 100.0, 0.0}, {0.0, 100.0, 0.0}};
+	add_quad(p, corners[0], corners[1], corners[2], corners[3]);
+}
+
+static double terrain_height(double x, double y)
+{
+	return 5.0 * sin(x * 0.11) * cos(y * 0.07) + 2.0 * sin(x * 0.37 + y * 0.23);
+}
+
+// a height field, on a 1mm grid
+static void make_terrain(std::vector<double> &p)
+{
+	for(int j = 0; j<100; j++)
+	{
+		for(int i = 0; i<100; i++)
+		{
+			double v[4][3] = {
+				{(double)i, (double)j, terrain_height(i, j)},
+				{(double)(i + 1), (double)j, terrain_height(i + 1, j)},
+				{(double)(i + 1), (double)(j + 1), terrain_height(i + 1, j + 1)},
+				{(double)i, (double)(j + 1), terrain_height(i, j + 1)}};
+			add_quad(p, v[0], v[1], v[2], v[3]);
+		}
+	}
+}
+
+// blocks of different heights standing on a floor, whose sides are vertical triangles
+static void make_walls(std::vector<double> &p)
+{
+	double corners[4][3] = {{0.0, 0.0, 0.0}, {100.0, 0.0, 0.0}, {100.0, 100.0, 0.0}, {0.0, 100.0, 0.0}};
+	add_quad(p, corners[0], corners[1], corners[2], corners[3]);
+
+	for(int j = 0; j<4; j++)
+	{
+		for(int i = 0; i<4; i++)
+		{
+			double x0 = 5.0 + i * 25.0, y0 = 5.0 + j * 25.0;
+			double x1 = x0 + 15.0 - i * 2.0, y1 = y0 + 15.0 - j * 2.0;
+			double h = 5.0 + (i * 4 + j) * 2.0;
+			double b[4][3] = {{x0, y0, 0.0}, {x1, y0, 0.0}, {x1, y1, 0.0}, {x0, y1, 0.0}};
+			double t[4][3] = {{x0, y0, h}, {x1, y0, h}, {x1, y1, h}, {x0, y1, h}};
+			add_quad(p, t[0], t[1], t[2], t[3]);
+			for(int k = 0; k<4; k++)add_quad(p, b[k], b[(k + 1) % 4], t[(k + 1) % 4], t[k]);
+		}
+	}
+}
+
+// long thin triangles, fans of needles meeting at a point, triangles whose corners are in a line, and triangles with repeated corners
+static void make_slivers(std::vector<double> &p)
+{
+	for(int i = 0; i<200; i++)
+	{
+		double y = i * 0.5;
+		add_triangle(p, 0.0, y, 1.0, 100.0, y + 0.001, 2.0, 100.0, y + 0.002, 2.0);
+	}
+
+	for(int i = 0; i<360; i++)
+	{
+		double a0 = PI * 2.0 * i / 360, a1 = PI * 2.0 * (i + 1) / 360;
+		add_triangle(p, 50.0, 50.0, 10.0, 50.0 + 45.0 * cos(a0), 50.0 + 45.0 * sin(a0), 3.0, 50.0 + 45.0 * cos(a1), 50.0 + 45.0 * sin(a1), 3.0);
+	}
+
+	for(int i = 0; i<100; i++)
+	{
+		double x = i * 1.0;
+		add_triangle(p, x, 10.0, 5.0, x + 0.5, 20.0, 6.0, x + 1.0, 30.0, 7.0); // in a line
+		add_triangle(p, x, 70.0, 4.0, x, 70.0, 4.0, x + 1.0, 80.0, 4.0); // two corners the same
+		add_triangle(p, x, 90.0, 8.0, x, 90.0, 8.0, x, 90.0, 8.0); // all three the same
+	}
+}
+
+// a closed solid, a dome on a short cylinder with a flat bottom, whose bottom is under its top
+static void make_solid(std::vector<double> &p)
+{
+	const int segments = 128;
+	const int rings = 32;
+	const double radius = 40.0;
+	const double height = 10.0;
+	double middle[3] = {50.0, 50.0, 0.0};
+	double top[3] = {50.0, 50.0, height + radius};
+	for(int i = 0; i<segments; i++)
+	{
+		double b0 = PI * 2.0 * i / segments;
+		double b1 = PI * 2.0 * (i + 1) / segments;
+		for(int j = 0; j<rings; j++)
+		{
+			double a0 = PI * 0.5 * j / rings;
+			double a1 = PI * 0.5 * (j + 1) / rings;
+			double v[4][3] = {
+				{50.0 + radius * cos(a0) * cos(b0), 50.0 + radius * cos(a0) * sin(b0), height + radius * sin(a0)},
+				{50.0 + radius * cos(a0) * cos(b1), 50.0 + radius * cos(a0) * sin(b1), height + radius * sin(a0)},
+				{50.0 + radius * cos(a1) * cos(b1), 50.0 + radius * cos(a1) * sin(b1), height + radius * sin(a1)},
+				{50.0 + radius * cos(a1) * cos(b0), 50.0 + radius * cos(a1) * sin(b0), height + radius * sin(a1)}};
+			if(j == rings - 1)add_triangle(p, v[0][0], v[0][1], v[0][2], v[1][0], v[1][1], v[1][2], top[0], top[1], top[2]);
+			else add_quad(p, v[0], v[1], v[2], v[3]);
+		}
+
+		double b[4][3] = {
+			{50.0 + radius * cos(b0), 50.0 + radius * sin(b0), 0.0},
+			{50.0 + radius * cos(b1), 50.0 + radius * sin(b1), 0.0},
+			{50.0 + radius * cos(b1), 50.0 + radius * sin(b1), height},
+			{50.0 + radius * cos(b0), 50.0 + radius * sin(b0), height}};
+		add_quad(p, b[0], b[1], b[2], b[3]);
+		add_triangle(p, middle[0], middle[1], middle[2], b[1][0], b[1][1], b[1][2], b[0][0], b[0][1], b[0][2]);
+	}
+}
+
+// the same triangles with their corners the other way round, so each edge is met going the other way
+static void reverse_triangles(const std::vector<double> &p, std::vector<double> &reversed)
+{
+	for(unsigned int i = 0; i + 9 <= p.size(); i += 9)add_triangle(reversed, p[i + 6], p[i + 7], p[i + 8], p[i + 3], p[i + 4], p[i + 5], p[i], p[i + 1], p[i + 2]);
+}
+
+// drops the cutter at the points onto the triangles, testing each one, and onto the mesh, and returns how many heights differ
+// list_time and tree_time get the seconds the drops took, one point at a time
+static int compare_with_list(const std::string &name, const Cutter &cu, const std::list<GTri> &triangles, const GTriMesh &mesh, const std::vector<double> &xy, double &list_time, double &tree_time)
+{
+	int n = (int)(xy.size() / 2);
+	std::vector<double> list_z(n), mesh_z(n);
+
+	double start = seconds();
+	for(int i = 0; i<n; i++)
+	{
+		double e[3] = {xy[i * 2], xy[i * 2 + 1], 0.0};
+		list_z[i] = DropCutter::TriTest(cu, e, triangles, -100.0);
+	}
+	list_time = seconds() - start;
+
+	start = seconds();
+	for(int i = 0; i<n; i++)
+	{
+		double e[3] = {xy[i * 2], xy[i * 2 + 1], 0.0};
+		mesh_z[i] = DropCutter::TriTest(cu, e, mesh, -100.0);
+	}
+	tree_time = seconds() - start;
+
+	int bad = 0;
+	for(int i = 0; i<n; i++)
+	{
+		if(fabs(mesh_z[i] - list_z[i]) > list_tolerance)
+		{
+			if(bad < 5)printf("%s: at %.9g, %.9g the mesh gives %.9g, the triangles %.9g\n", name.c_str(), xy[i * 2], xy[i * 2 + 1], mesh_z[i], list_z[i]);
+			bad++;
+		}
+	}
+	if(bad > 0)printf("%s: %d of %d mesh heights differ from the triangles'\n", name.c_str(), bad, (int)(xy.size() / 2));
+	return bad;
+}
+
+// makes the mesh's roughing levels, and returns how many have more triangles than the mesh, or have heights below it
+static int check_levels(const std::string &name, const std::vector<double> &p, const GTriMesh &mesh, const Cutter *cutters, int num_cutters)
+{
+	MeshPyramid::Sources sources;
+	sources.push_back(std::make_pair(&p[0], p.size() / 9));
+	MeshPyramid pyramid(sources, first_level_error);
+
+	int bad = 0;
+	printf("%s levels:", name.c_str());
+	for(int level = 0; level < levels_checked; level++)
+	{
+		int num_triangles = pyramid.Level(level).NumTriangles();
+		printf(" %d", num_triangles);
+		if(num_triangles > mesh.NumTriangles())
+		{
+			printf(" (more than the mesh)");
+			bad++;
+		}
+	}
+
+	std::vector<double> mesh_z(level_check_points * level_check_points);
+	for(int c = 0; c<num_cutters; c++)
+	{
+		const Cutter &cu = cutters[c];
+		double x0 = cu.R, d = (100.0 - cu.R * 2.0) / (level_check_points - 1);
+		DropCutter::DropGrid(cu, mesh, x0, x0, d, d, level_check_points, level_check_points, -100.0, &mesh_z[0]);
+
+		for(int level = 0; level < levels_checked; level++)
+		{
+			const GTriMesh &level_mesh = pyramid.Level(level);
+			int below = 0;
+			for(int k = 0; k < level_check_points * level_check_points; k++)
+			{
+				double e[3] = {x0 + (k % level_check_points) * d, x0 + (k / level_check_points) * d, 0.0};
+				double level_z = DropCutter::TriTest(cu, e, level_mesh, -100.0);
+				if(level_z < mesh_z[k] - list_tolerance)
+				{
+					if(below == 0)printf("\n%s level %d, cutter %d: at %.9g, %.9g the level gives %.9g, the mesh %.9g", name.c_str(), level, c, e[0], e[1], level_z, mesh_z[k]);
+					below++;
+				}
+			}
+			bad += below;
+		}
+	}
+	printf("\n");
+	return bad;
+}
+
+// collects the leaves under the cutter
+class LeafCollector
+{
+public:
+	std::vector<const GTriMesh::Node*> m_leaves;
+	void operator()(const GTriMesh::Node &node){m_leaves.push_back(&node);}
+};
+
+// does the batch tests on each leaf under the cutter at the points, and the tests of one triangle or edge at a time, and returns how many heights aren't the same
+static int check_batches(const std::string &name, const Cutter &cu, const GTriMesh &mesh, const std::vector<double> &xy)
+{
+	int bad = 0;
+	std::vector<double> z(GTriMesh::max_triangles_in_leaf * 3);
+	for(unsigned int i = 0; i + 1 < xy.size(); i += 2)
+	{
+		double e[3] = {xy[i], xy[i + 1], 0.0};
+		double box[4] = {e[0] - cu.R, e[1] - cu.R, e[0] + cu.R, e[1] + cu.R};
+		LeafCollector leaves;
+		mesh.VisitLeaves(box, leaves);
+		for(std::vector<const GTriMesh::Node*>::iterator It = leaves.m_leaves.begin(); It != leaves.m_leaves.end(); It++)
+		{
+			const GTriMesh::Node &node = **It;
+			for(int type = 0; type < 3; type++)
+			{
+				int count = (type == 2) ? node.m_edge_count : node.m_count;
+				int first = (type == 2) ? node.m_first_edge : node.m_first;
+				for(int k = 0; k<count; k++)z[k] = -10000000.0;
+				switch(type)
+				{
+				case 0:
+					DropCutter::VertexTests(cu, e, mesh, first, count, &z[0]);
+					break;
+				case 1:
+					DropCutter::FacetTests(cu, e, mesh, first, count, &z[0]);
+					break;
+				default:
+					DropCutter::EdgeTests(cu, e, mesh, first, count, &z[0]);
+					break;
+				}
+
+				for(int k = 0; k<count; k++)
+				{
+					double single_z = -10000000.0;
+					double p[9];
+					if(type == 2)
+					{
+						double p1[3] = {mesh.m_edge_p[0][first + k], mesh.m_edge_p[1][first + k], mesh.m_edge_p[2][first + k]};
+						double p2[3] = {mesh.m_edge_p[3][first + k], mesh.m_edge_p[4][first + k], mesh.m_edge_p[5][first + k]};
+						double h = DropCutter::EdgeTest(cu, e, p1, p2);
+						if(h > single_z)single_z = h;
+					}
+					else
+					{
+						mesh.GetTriangle(first + k, p);
+						if(type == 0)
+						{
+							for(int v = 0; v<3; v++)
+							{
+								double h = DropCutter::VertexTest(cu, e, &p[v * 3]);
+								if(h > single_z)single_z = h;
+							}
+						}
+						else
+						{
+							double h = DropCutter::FacetTest(cu, e, GTri(p));
+							if(h > single_z)single_z = h;
+						}
+					}
+
+					if(z[k] != single_z)
+					{
+						const char* type_names[] = {"vertex", "facet", "edge"};
+						if(bad < 5)printf("%s: at %.9g, %.9g the %s batch gives %.17g for %d, one at a time gives %.17g\n", name.c_str(), e[0], e[1], type_names[type], first + k, z[k], single_z);
+						bad++;
+					}
+				}
+			}
+		}
+	}
+	if(bad > 0)printf("%s: %d batch heights aren't the same as one at a time\n", name.c_str(), bad);
+	return bad;
+}
+
+// drops the cutter at the points onto every leaf under it, and returns how many heights aren't the same as the mesh's, which visits the leaves highest first
+// and stops when the leaves left can't be higher than the contact found
+static int check_best_first(const std::string &name, const Cutter &cu, const GTriMesh &mesh, const std::vector<double> &xy)
+{
+	int bad = 0;
+	std::vector<double> z(GTriMesh::max_triangles_in_leaf * 3);
+	for(unsigned int i = 0; i + 1 < xy.size(); i += 2)
+	{
+		double e[3] = {xy[i], xy[i + 1], 0.0};
+		double box[4] = {e[0] - cu.R, e[1] - cu.R, e[0] + cu.R, e[1] + cu.R};
+		LeafCollector leaves;
+		mesh.VisitLeaves(box, leaves);
+
+		// as DropCutter does for each leaf, leaving out the triangles and edges whose boxes are outside the cutter's
+		double all_z = -100.0;
+		for(std::vector<const GTriMesh::Node*>::iterator It = leaves.m_leaves.begin(); It != leaves.m_leaves.end(); It++)
+		{
+			const GTriMesh::Node &node = **It;
+			for(int k = 0; k<node.m_count; k++)z[k] = -100.0;
+			DropCutter::FacetTests(cu, e, mesh, node.m_first, node.m_count, &z[0]);
+			DropCutter::VertexTests(cu, e, mesh, node.m_first, node.m_count, &z[0]);
+			for(int k = 0; k<node.m_count; k++)
+			{
+				if(z[k] > all_z && mesh.TriangleOverlaps(node.m_first + k, box))all_z = z[k];
+			}
+
+			for(int k = 0; k<node.m_edge_count; k++)z[k] = -100.0;
+			DropCutter::EdgeTests(cu, e, mesh, node.m_first_edge, node.m_edge_count, &z[0]);
+			for(int k = 0; k<node.m_edge_count; k++)
+			{
+				if(z[k] > all_z && mesh.EdgeOverlaps(node.m_first_edge + k, box))all_z = z[k];
+			}
+		}
+
+		double mesh_z = DropCutter::TriTest(cu, e, mesh, -100.0);
+		if(mesh_z != all_z)
+		{
+			if(bad < 5)printf("%s: at %.9g, %.9g the mesh gives %.17g, every leaf gives %.17g\n", name.c_str(), e[0], e[1], mesh_z, all_z);
+			bad++;
+		}
+	}
+	if(bad > 0)printf("%s: %d heights from the leaves visited highest first aren't the same as from every leaf\n", name.c_str(), bad);
+	return bad;
+}
+
+class BenchResult
+{
+public:
+	std::string m_name;
+	int m_nx, m_ny;
+	std::vector<double> m_z;
+};
+
+static void time_tests(const Cutter &cu, const GTriMesh &mesh, const std::vector<double> &xy, double &vertex_time, double &facet_time, double &edge_time, double &total)
+{
+	// the leaves under each point are found first, so only the tests themselves are timed
+	std::vector<LeafCollector> leaves(xy.size() / 2);
+	for(unsigned int i = 0; i < leaves.size(); i++)
+	{
+		double box[4] = {xy[i * 2] - cu.R, xy[i * 2 + 1] - cu.R, xy[i * 2] + cu.R, xy[i * 2 + 1] + cu.R};
+		mesh.VisitLeaves(box, leaves[i]);
+	}
+
+	// the heights are added up, so the tests can't be left out by the optimizer
+	std::vector<double> z(1024);
+	total = 0.0;
+
+	for(int type = 0; type < 3; type++)
+	{
+		double start = seconds();
+		for(unsigned int i = 0; i < leaves.size(); i++)
+		{
+			double e[3] = {xy[i * 2], xy[i * 2 + 1], 0.0};
+			for(std::vector<const GTriMesh::Node*>::iterator It = leaves[i].m_leaves.begin(); It != leaves[i].m_leaves.end(); It++)
+			{
+				const GTriMesh::Node &node = **It;
+				int count = (type == 2) ? node.m_edge_count : node.m_count;
+				if(count > (int)z.size())z.resize(count);
+				for(int k = 0; k<count; k++)z[k] = -10000000.0;
+				switch(type)
+				{
+				case 0:
+					DropCutter::VertexTests(cu, e, mesh, node.m_first, count, &z[0]);
+					break;
+				case 1:
+					DropCutter::FacetTests(cu, e, mesh, node.m_first, count, &z[0]);
+					break;
+				default:
+					DropCutter::EdgeTests(cu, e, mesh, node.m_first_edge, count, &z[0]);
+					break;
+				}
+				for(int k = 0; k<count; k++)total += z[k];
+			}
+		}
+		double t = seconds() - start;
+		switch(type)
+		{
+		case 0: vertex_time = t; break;
+		case 1: facet_time = t; break;
+		default: edge_time = t; break;
+		}
+	}
+}
+
+static bool write_golden(const char* path, const std::vector<BenchResult> &results)
+{
+	FILE* fp = fopen(path, "w");
+	if(fp == NULL)return false;
+	for(std::vector<BenchResult>::const_iterator It = results.begin(); It != results.end(); It++)
+	{
+		fprintf(fp, "%s %d %d\n", It->m_name.c_str(), It->m_nx, It->m_ny);
+		for(std::vector<double>::const_iterator ZIt = It->m_z.begin(); ZIt != It->m_z.end(); ZIt++)fprintf(fp, "%.12g\n", *ZIt);
+	}
+	fclose(fp);
+	return true;
+}
+
+// returns how many heights differ, or -1 if the file can't be read or was made with different grids
+static int check_golden(const char* path, const std::vector<BenchResult> &results)
+{
+	FILE* fp = fopen(path, "r");
+	if(fp == NULL)return -1;
+
+	int differences = 0;
+	for(std::vector<BenchResult>::const_iterator It = results.begin(); It != results.end(); It++)
+	{
+		char name[256];
+		int nx, ny;
+		if(fscanf(fp, "%255s %d %d", name, &nx, &ny) != 3 || It->m_name != name || nx != It->m_nx || ny != It->m_ny)
+		{
+			fclose(fp);
+			return -1;
+		}
+
+		int bad = 0;
+		for(unsigned int i = 0; i < It->m_z.size(); i++)
+		{
+			double z;
+			if(fscanf(fp, "%lf", &z) != 1)
+			{
+				fclose(fp);
+				return -1;
+			}
+			if(fabs(z - It->m_z[i]) > golden_tolerance)
+			{
+				if(bad < 5)printf("%s: point %d, %d is %.9g, was %.9g\n", name, i % nx, i / nx, It->m_z[i], z);
+				bad++;
+			}
+		}
+		if(bad > 0)printf("%s: %d of %d heights differ\n", name, bad, (int)It->m_z.size());
+		differences += bad;
+	}
+
+	fclose(fp);
+	return differences;
+}
+
+int main(int argc, char* argv[])
+{
+	int n = 200;
+	const char* write_path = NULL;
+	const char* check_path = NULL;
+	for(int i = 1; i < argc; i++)
+	{
+		std::string arg(argv[i]);
+		if(arg == "-n" && i + 1 < argc)n = atoi(argv[++i]);
+		else if(arg == "-write" && i + 1 < argc)write_path = argv[++i];
+		else if(arg == "-check" && i + 1 < argc)check_path = argv[++i];
+		else
+		{
+			printf("usage: %s [-n points along each side of the grids] [-write golden_file] [-check golden_file]\n", argv[0]);
+			return 2;
+		}
+	}
+	if(n < 2)n = 2;
+
+	DropCutter::SetTolerance(0.001);
+
+	const char* mesh_names[] = {"sphere", "terrain", "walls", "slivers", "solid"};
+	void (*mesh_makers[])(std::vector<double> &) = {make_sphere, make_terrain, make_walls, make_slivers, make_solid};
+	const int num_meshes = sizeof(mesh_names) / sizeof(mesh_names[0]);
+	const char* cutter_names[] = {"flat", "ball", "bull", "cone"};
+	Cutter cutters[] = {Cutter(3.0, 0.0), Cutter(3.0, 3.0), Cutter(3.0, 1.0), Cutter(3.0, 0.5, PI / 4)};
+	const int num_cutters = sizeof(cutter_names) / sizeof(cutter_names[0]);
+	double max_cutter_radius = 3.0;
+
+	printf("%-16s %9s %12s %10s %10s %10s %12s %12s\n", "", "triangles", "points/s", "vertex s", "facet s", "edge s", "list pts/s", "tree pts/s");
+
+	std::vector<BenchResult> results;
+	int list_differences = 0;
+	int level_problems = 0;
+	int batch_differences = 0;
+	int compact_problems = 0;
+	int tiled_differences = 0;
+	for(int m = 0; m<num_meshes; m++)
+	{
+		std::vector<double> p;
+		mesh_makers[m](p);
+		std::list<GTri> triangles;
+		for(unsigned int i = 0; i < p.size(); i += 9)triangles.push_back(GTri(&p[i]));
+		GTriMesh mesh(triangles);
+
+		std::vector<double> reversed_p;
+		reverse_triangles(p, reversed_p);
+		std::list<GTri> reversed_triangles;
+		for(unsigned int i = 0; i < reversed_p.size(); i += 9)reversed_triangles.push_back(GTri(&reversed_p[i]));
+		GTriMesh reversed_mesh(reversed_triangles);
+
+		CompactMesh compact_mesh(&p[0], p.size() / 9);
+		double compact_max_difference = 0.0;
+		double compact_time = 0.0;
+
+		TiledMesh::Sources sources;
+		sources.push_back(std::make_pair(&p[0], p.size() / 9));
+		TiledMesh* tiled_mesh = TiledMesh::Make(std::string("heekscnc_bench_") + mesh_names[m], sources, max_cutter_radius, DropCutter::Tolerance(), tiled_memory_budget, TiledMesh::SourceKey(sources));
+		if(tiled_mesh == NULL)
+		{
+			printf("couldn't make the tiles for %s in the current folder\n", mesh_names[m]);
+			return 2;
+		}
+		double tiled_time = 0.0;
+
+		for(int c = 0; c<num_cutters; c++)
+		{
+			const Cutter &cu = cutters[c];
+
+			// the grid goes a little past the mesh's square, so the cutter comes off its sides
+			double x0 = -cu.R, y0 = -cu.R;
+			double d = (100.0 + cu.R * 2.0) / (n - 1);
+
+			BenchResult result;
+			result.m_name = std::string(mesh_names[m]) + "_" + cutter_names[c];
+			result.m_nx = n;
+			result.m_ny = n;
+			result.m_z.resize(n * n);
+
+			DropCutterDiagnostics::Reset();
+			double start = seconds();
+			DropCutter::DropGrid(cu, mesh, x0, y0, d, d, n, n, -100.0, &result.m_z[0]);
+			double grid_time = seconds() - start;
+
+			// the same grid on the CompactMesh, whose single precision points are a little different
+			std::vector<double> compact_z(n * n);
+			start = seconds();
+			DropCutter::DropGrid(cu, compact_mesh, x0, y0, d, d, n, n, -100.0, &compact_z[0]);
+			compact_time += seconds() - start;
+			for(int k = 0; k < n * n; k++)
+			{
+				double difference = fabs(compact_z[k] - result.m_z[k]);
+				if(difference > compact_max_difference)compact_max_difference = difference;
+			}
+
+			// and on the tiles
+			std::vector<double> tiled_z(n * n);
+			start = seconds();
+			tiled_mesh->DropGrid(cu, x0, y0, d, d, n, n, -100.0, &tiled_z[0]);
+			tiled_time += seconds() - start;
+			int tiled_bad = 0;
+			for(int k = 0; k < n * n; k++)
+			{
+				if(fabs(tiled_z[k] - result.m_z[k]) > list_tolerance)
+				{
+					if(tiled_bad < 5)printf("%s: at %.9g, %.9g the tiles give %.9g, the mesh %.9g\n", result.m_name.c_str(), x0 + (k % n) * d, y0 + (k / n) * d, tiled_z[k], result.m_z[k]);
+					tiled_bad++;
+				}
+			}
+			if(tiled_bad > 0)printf("%s: %d of %d heights from the tiles differ from the mesh's\n", result.m_name.c_str(), tiled_bad, n * n);
+			tiled_differences += tiled_bad;
+
+			std::vector<double> xy;
+			int step = (n * n + max_points_for_test_timings - 1) / max_points_for_test_timings;
+			for(int k = 0; k < n * n; k += step)
+			{
+				xy.push_back(x0 + (k % n) * d);
+				xy.push_back(y0 + (k / n) * d);
+			}
+
+			// where a ball cutter on the sphere used to miss an edge which was only just further from the axis than R - r
+			xy.push_back(36.616);
+			xy.push_back(36.616);
+			double vertex_time, facet_time, edge_time, total;
+			time_tests(cu, mesh, xy, vertex_time, facet_time, edge_time, total);
+
+			// the same points, one at a time, onto the list of triangles, testing each one, and onto the mesh, using its tree
+			double list_time, tree_time, reversed_list_time, reversed_tree_time;
+			list_differences += compare_with_list(result.m_name, cu, triangles, mesh, xy, list_time, tree_time);
+			list_differences += compare_with_list(result.m_name + "_reversed", cu, reversed_triangles, reversed_mesh, xy, reversed_list_time, reversed_tree_time);
+			int num_points = (int)(xy.size() / 2);
+			batch_differences += check_batches(result.m_name, cu, mesh, xy);
+			batch_differences += check_best_first(result.m_name, cu, mesh, xy);
+
+			printf("%-16s %9d %12.0f %10.4f %10.4f %10.4f %12.0f %12.0f\n", result.m_name.c_str(), (int)(p.size() / 9), (grid_time > 0.0) ? n * n / grid_time : 0.0, vertex_time, facet_time, edge_time,
+				(list_time > 0.0) ? num_points / list_time : 0.0, (tree_time > 0.0) ? num_points / tree_time : 0.0);
+			std::string report = DropCutterDiagnostics::Report();
+			if(report.size() > 0)printf("%s", report.c_str());
+
+			results.push_back(result);
+
+			BenchResult compact_result = result;
+			compact_result.m_name += "_compact";
+			compact_result.m_z = compact_z;
+			results.push_back(compact_result);
+
+			BenchResult tiled_result = result;
+			tiled_result.m_name += "_tiled";
+			tiled_result.m_z = tiled_z;
+			results.push_back(tiled_result);
+		}
+
+		printf("%s compact: %.1f bytes per triangle, against %.1f for the GTriMesh, %.0f points/s, heights within %.3g of the GTriMesh's\n", mesh_names[m],
+			(double)compact_mesh.MemoryUsed() / (p.size() / 9), (double)mesh.MemoryUsed() / (p.size() / 9), (compact_time > 0.0) ? n * n * num_cutters / compact_time : 0.0, compact_max_difference);
+		printf("%s tiled: %d by %d tiles, %.0f points/s\n", mesh_names[m], tiled_mesh->NumTilesX(), tiled_mesh->NumTilesY(), (tiled_time > 0.0) ? n * n * num_cutters / tiled_time : 0.0);
+		std::vector<std::string> tile_paths;
+		for(int i = 0; i < tiled_mesh->NumTilesX() * tiled_mesh->NumTilesY(); i++)tile_paths.push_back(tiled_mesh->TilePath(i));
+		tile_paths.push_back(tiled_mesh->IndexPath());
+		delete tiled_mesh;
+		for(std::vector<std::string>::iterator It = tile_paths.begin(); It != tile_paths.end(); It++)remove(It->c_str());
+		if(compact_max_difference > DropCutter::Tolerance())
+		{
+			printf("%s compact: heights differ from the GTriMesh's by more than the tolerance, %g\n", mesh_names[m], DropCutter::Tolerance());
+			compact_problems++;
+		}
+
+		level_problems += check_levels(mesh_names[m], p, mesh, cutters, num_cutters);
+	}
+
+	if(write_path)
+	{
+		if(!write_golden(write_path, results))
+		{
+			printf("couldn't write %s\n", write_path);
+			return 2;
+		}
+		printf("wrote %s\n", write_path);
+	}
+
+	if(check_path)
+	{
+		int differences = check_golden(check_path, results);
+		if(differences < 0)
+		{
+			printf("couldn't read %s, or it was written with a different -n\n", check_path);
+			return 2;
+		}
+		if(differences > 0)return 1;
+		printf("all heights match %s\n", check_path);
+	}
+
+	if(list_differences > 0 || level_problems > 0 || batch_differences > 0 || compact_problems > 0 || tiled_differences > 0)return 1;
+	return 0;
+}
@@ -14,6 +14,14 @@
 #include <map>
 #include <set>
 
+#ifdef DROPCUTTER_ONLY
+// just the DropCutter kernel, for the attach library which nc/attach.py loads; no wx, OpenCASCADE or HeeksCAD
+#include <string>
+#include <math.h>
+#include <string.h>
+#include <stdio.h>
+#else
+
 #include <wx/wx.h>
 #include <wx/textfile.h>
 
@@ -49,4 +57,6 @@ extern "C" {
 
 #if _MSC_VER == 1600
 	#include <iterator>
-#endif
\ No newline at end of file
+#endif
+
+#endif // DROPCUTTER_ONLY
\ No newline at end of file